@@ -0,0 +1,147 @@
+#include "AsyncFrameReader.h"
+#include "PlayerMetrics.h"
+#include <mfapi.h>
+#include <algorithm>
+
+// Timeout for the reader to acknowledge a flush before giving up
+constexpr DWORD kFlushTimeoutMs = 2000;
+
+AsyncFrameReader::AsyncFrameReader(UINT32 queueDepth)
+    : m_queue(queueDepth)
+{
+    m_hFlushEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+}
+
+AsyncFrameReader::~AsyncFrameReader()
+{
+    m_queue.Clear();
+    if (m_hFlushEvent) CloseHandle(m_hFlushEvent);
+}
+
+STDMETHODIMP AsyncFrameReader::QueryInterface(REFIID riid, void** ppv)
+{
+    if (!ppv) return E_POINTER;
+    if (riid == __uuidof(IUnknown) || riid == __uuidof(IMFSourceReaderCallback)) {
+        *ppv = static_cast<IMFSourceReaderCallback*>(this);
+        AddRef();
+        return S_OK;
+    }
+    *ppv = nullptr;
+    return E_NOINTERFACE;
+}
+
+STDMETHODIMP_(ULONG) AsyncFrameReader::AddRef()
+{
+    return ++m_refCount;
+}
+
+STDMETHODIMP_(ULONG) AsyncFrameReader::Release()
+{
+    ULONG count = --m_refCount;
+    if (count == 0) delete this;
+    return count;
+}
+
+STDMETHODIMP AsyncFrameReader::OnReadSample(HRESULT hrStatus, DWORD /*dwStreamIndex*/, DWORD dwStreamFlags,
+                                            LONGLONG llTimestamp, IMFSample* pSample)
+{
+    if (FAILED(hrStatus)) {
+        m_hrStatus.store(hrStatus, std::memory_order_release);
+        m_bRequestPending.store(false, std::memory_order_release);
+        return S_OK;
+    }
+
+    // A type change reported without a sample applies to the next frame queued
+    m_pendingFlags |= dwStreamFlags & MF_SOURCE_READERF_CURRENTMEDIATYPECHANGED;
+    if (pSample) {
+        QueuedFrame frame;
+        frame.pSample = pSample;
+        frame.timestamp = llTimestamp;
+        frame.flags = m_pendingFlags;
+        frame.decodeUs = static_cast<UINT32>(std::min<UINT64>(
+            PlayerMetrics::MicrosecondsSince(m_requestStart.load(std::memory_order_relaxed)), UINT32_MAX));
+        pSample->GetSampleDuration(&frame.duration);
+        pSample->AddRef();
+        // Only one request is outstanding and it is only issued with room left, so this cannot fail
+        if (m_queue.Push(frame))
+            m_pendingFlags = 0;
+        else
+            pSample->Release();
+    }
+
+    if (dwStreamFlags & MF_SOURCE_READERF_ENDOFSTREAM)
+        m_bEndOfStream.store(true, std::memory_order_release);
+
+    // Clear the pending flag before checking for space so a concurrent consumer cannot miss a wakeup
+    // (the store is ordered before the loads in TryRequest by its fence)
+    m_bRequestPending.store(false, std::memory_order_seq_cst);
+    TryRequest();
+    return S_OK;
+}
+
+STDMETHODIMP AsyncFrameReader::OnFlush(DWORD /*dwStreamIndex*/)
+{
+    if (m_hFlushEvent) SetEvent(m_hFlushEvent);
+    return S_OK;
+}
+
+STDMETHODIMP AsyncFrameReader::OnEvent(DWORD /*dwStreamIndex*/, IMFMediaEvent* /*pEvent*/)
+{
+    return S_OK;
+}
+
+void AsyncFrameReader::TryRequest()
+{
+    // Both callers store before they get here: the consumer its pop, the callback the pending flag.
+    // Release/acquire does not order a store before a later load, so without a full fence each side
+    // could see the other's old value and neither issue the next request.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!m_pReader || m_bStopped.load(std::memory_order_acquire) ||
+        m_bEndOfStream.load(std::memory_order_acquire) || m_queue.IsFull())
+        return;
+
+    bool expected = false;
+    if (!m_bRequestPending.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+        return;
+
+    m_requestStart.store(PlayerMetrics::Now(), std::memory_order_relaxed);
+    HRESULT hr = m_pReader->ReadSample(MF_SOURCE_READER_FIRST_VIDEO_STREAM, 0,
+                                       nullptr, nullptr, nullptr, nullptr);
+    if (FAILED(hr)) {
+        m_hrStatus.store(hr, std::memory_order_release);
+        m_bRequestPending.store(false, std::memory_order_release);
+    }
+}
+
+HRESULT AsyncFrameReader::Start()
+{
+    if (!m_pReader) return E_UNEXPECTED;
+    m_hrStatus.store(S_OK, std::memory_order_release);
+    m_bEndOfStream.store(false, std::memory_order_release);
+    m_bStopped.store(false, std::memory_order_release);
+    TryRequest();
+    return m_hrStatus.load(std::memory_order_acquire);
+}
+
+HRESULT AsyncFrameReader::Flush()
+{
+    m_bStopped.store(true, std::memory_order_release);
+    if (!m_pReader) return E_UNEXPECTED;
+
+    if (m_hFlushEvent) ResetEvent(m_hFlushEvent);
+    HRESULT hr = m_pReader->Flush(MF_SOURCE_READER_FIRST_VIDEO_STREAM);
+    if (SUCCEEDED(hr) && m_hFlushEvent &&
+        WaitForSingleObject(m_hFlushEvent, kFlushTimeoutMs) != WAIT_OBJECT_0)
+        hr = HRESULT_FROM_WIN32(WAIT_TIMEOUT);
+
+    // Cancelled requests never complete, so nothing can be pending any more
+    m_bRequestPending.store(false, std::memory_order_release);
+    m_queue.Clear();
+    return hr;
+}
+
+void AsyncFrameReader::Shutdown()
+{
+    Flush();
+    m_pReader = nullptr;
+}
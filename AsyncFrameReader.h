@@ -0,0 +1,77 @@
+#pragma once
+
+#include <windows.h>
+#include <mfidl.h>
+#include <mfreadwrite.h>
+#include <atomic>
+#include "FrameProducer.h"
+
+/**
+ * @brief Source reader callback that keeps a FrameQueue filled ahead of the presentation clock.
+ *
+ * The reader must be created with MF_SOURCE_READER_ASYNC_CALLBACK set to this object. At most one
+ * ReadSample request is outstanding at a time, and requests stop while the queue is full; a
+ * consumer that pops a frame calls NotifyConsumed to resume decoding.
+ */
+class AsyncFrameReader : public IMFSourceReaderCallback, public FrameProducer {
+public:
+    explicit AsyncFrameReader(UINT32 queueDepth);
+
+    // IUnknown
+    STDMETHODIMP QueryInterface(REFIID riid, void** ppv) override;
+    STDMETHODIMP_(ULONG) AddRef() override;
+    STDMETHODIMP_(ULONG) Release() override;
+
+    // IMFSourceReaderCallback
+    STDMETHODIMP OnReadSample(HRESULT hrStatus, DWORD dwStreamIndex, DWORD dwStreamFlags,
+                              LONGLONG llTimestamp, IMFSample* pSample) override;
+    STDMETHODIMP OnFlush(DWORD dwStreamIndex) override;
+    STDMETHODIMP OnEvent(DWORD dwStreamIndex, IMFMediaEvent* pEvent) override;
+
+    /**
+     * @brief Attaches the source reader (not referenced, the reader owns this callback).
+     */
+    void SetReader(IMFSourceReader* pReader) { m_pReader = pReader; }
+
+    /**
+     * @brief Starts filling the queue.
+     * @return S_OK on success, or an error code from ReadSample.
+     */
+    HRESULT Start() override;
+
+    /**
+     * @brief Cancels pending requests, waits for the reader to flush and empties the queue.
+     * @return S_OK on success, or an error code.
+     */
+    HRESULT Flush() override;
+
+    /**
+     * @brief Stops issuing requests and flushes; the reader can then be released safely.
+     */
+    void Shutdown() override;
+
+    /**
+     * @brief Must be called by the consumer after popping a frame from Queue().
+     */
+    void NotifyConsumed() override { TryRequest(); }
+
+    FrameQueue& Queue() override { return m_queue; }
+    bool IsEndOfStream() const override { return m_bEndOfStream.load(std::memory_order_acquire); }
+    HRESULT GetStatus() const override { return m_hrStatus.load(std::memory_order_acquire); }
+
+private:
+    ~AsyncFrameReader();
+
+    void TryRequest();
+
+    std::atomic<ULONG> m_refCount{1};
+    IMFSourceReader* m_pReader = nullptr;
+    FrameQueue m_queue;
+    HANDLE m_hFlushEvent = nullptr;
+    std::atomic<bool> m_bRequestPending{false};
+    std::atomic<bool> m_bStopped{true};
+    std::atomic<bool> m_bEndOfStream{false};
+    std::atomic<HRESULT> m_hrStatus{S_OK};
+    DWORD m_pendingFlags = 0;          // Flags not delivered with a frame yet (callbacks are serialised)
+    std::atomic<LONGLONG> m_requestStart{0};    // When the outstanding request was issued (PlayerMetrics::Now)
+};
@@ -0,0 +1,410 @@
+#include "AudioKernels.h"
+#include <ksmedia.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__)
+#define AUDIO_KERNELS_AVX2 1
+#include <immintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define AUDIO_KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace AudioKernels {
+
+constexpr float kPcm16Scale = 1.0f / 32768.0f;
+constexpr float kMinus3dB = 0.70710678f;   // Centre and surround fold-down coefficient
+
+static inline int16_t SaturatePcm16(float value)
+{
+    return static_cast<int16_t>(std::lrintf(std::clamp(value, -32768.0f, 32767.0f)));
+}
+
+static inline float LoadSample(const int16_t* pSrc, size_t index) { return pSrc[index] * kPcm16Scale; }
+static inline float LoadSample(const float* pSrc, size_t index) { return pSrc[index]; }
+
+// Per-lane peak and sum of squares; lane l holds channel l % channels when the width is a multiple of it
+#if defined(AUDIO_KERNELS_AVX2)
+struct VectorMeter {
+    static constexpr UINT32 kWidth = 8;
+    __m256 peak = _mm256_setzero_ps();
+    __m256 squares = _mm256_setzero_ps();
+    void Add(__m256 v) {
+        peak = _mm256_max_ps(peak, _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v));
+        squares = _mm256_fmadd_ps(v, v, squares);
+    }
+    void Store(float* pPeak, float* pSquares) const {
+        _mm256_storeu_ps(pPeak, peak);
+        _mm256_storeu_ps(pSquares, squares);
+    }
+};
+#elif defined(AUDIO_KERNELS_NEON)
+struct VectorMeter {
+    static constexpr UINT32 kWidth = 4;
+    float32x4_t peak = vdupq_n_f32(0.0f);
+    float32x4_t squares = vdupq_n_f32(0.0f);
+    void Add(float32x4_t v) {
+        peak = vmaxq_f32(peak, vabsq_f32(v));
+        squares = vfmaq_f32(squares, v, v);
+    }
+    void Store(float* pPeak, float* pSquares) const {
+        vst1q_f32(pPeak, peak);
+        vst1q_f32(pSquares, squares);
+    }
+};
+#else
+struct VectorMeter {
+    static constexpr UINT32 kWidth = 1;
+    float peak = 0.0f;
+    float squares = 0.0f;
+    void Store(float* pPeak, float* pSquares) const { *pPeak = peak; *pSquares = squares; }
+};
+#endif
+
+static inline bool CanMeterVectors(const Levels* pLevels)
+{
+    return pLevels && pLevels->channels && VectorMeter::kWidth % pLevels->channels == 0;
+}
+
+static inline void MeterSample(Levels* pLevels, size_t index, float value)
+{
+    const size_t channel = index % pLevels->channels;
+    if (channel < 2) {
+        pLevels->peak[channel] = std::max(pLevels->peak[channel], std::fabs(value));
+        pLevels->sumSquares[channel] += value * value;
+    }
+}
+
+// Adds a block metered by a kernel to the caller's levels; scale brings the values to full scale 1.0
+static void MergeLevels(Levels* pLevels, Levels& block, const VectorMeter* pMeter, float scale, size_t samples)
+{
+    if (pMeter) {
+        float peak[VectorMeter::kWidth], squares[VectorMeter::kWidth];
+        pMeter->Store(peak, squares);
+        for (UINT32 lane = 0; lane < VectorMeter::kWidth; ++lane) {
+            const UINT32 channel = lane % block.channels;
+            if (channel < 2) {
+                block.peak[channel] = std::max(block.peak[channel], peak[lane]);
+                block.sumSquares[channel] += squares[lane];
+            }
+        }
+    }
+    for (int c = 0; c < 2; ++c) {
+        pLevels->peak[c] = std::max(pLevels->peak[c], block.peak[c] * scale);
+        pLevels->sumSquares[c] += block.sumSquares[c] * scale * scale;
+    }
+    pLevels->frames += static_cast<UINT32>(samples / block.channels);
+}
+
+// Separate pass over the output, for channel counts the vector lanes cannot follow
+template <typename T>
+static void MeterOutput(Levels* pLevels, const T* pOut, size_t samples, float scale)
+{
+    Levels block;
+    block.channels = pLevels->channels;
+    for (size_t i = 0; i < samples; ++i)
+        MeterSample(&block, i, static_cast<float>(pOut[i]));
+    MergeLevels(pLevels, block, nullptr, scale, samples);
+}
+
+SampleFormat GetSampleFormat(const WAVEFORMATEX* pFormat)
+{
+    if (!pFormat) return SampleFormat::Unsupported;
+
+    WORD tag = pFormat->wFormatTag;
+    if (tag == WAVE_FORMAT_EXTENSIBLE && pFormat->cbSize >= sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX)) {
+        const auto* pExt = reinterpret_cast<const WAVEFORMATEXTENSIBLE*>(pFormat);
+        if (pExt->SubFormat == KSDATAFORMAT_SUBTYPE_PCM) tag = WAVE_FORMAT_PCM;
+        else if (pExt->SubFormat == KSDATAFORMAT_SUBTYPE_IEEE_FLOAT) tag = WAVE_FORMAT_IEEE_FLOAT;
+    }
+    if (tag == WAVE_FORMAT_PCM && pFormat->wBitsPerSample == 16) return SampleFormat::Pcm16;
+    if (tag == WAVE_FORMAT_IEEE_FLOAT && pFormat->wBitsPerSample == 32) return SampleFormat::Float32;
+    return SampleFormat::Unsupported;
+}
+
+void CopyWithGainPcm16(int16_t* pDst, const int16_t* pSrc, size_t samples, float gainStart, float gainEnd,
+                       Levels* pLevels)
+{
+    if (gainStart == 1.0f && gainEnd == 1.0f && !pLevels) {
+        memcpy(pDst, pSrc, samples * sizeof(int16_t));
+        return;
+    }
+
+    const bool meterVectors = CanMeterVectors(pLevels);
+    VectorMeter meter;
+    Levels block;
+    if (pLevels) block.channels = pLevels->channels;
+
+    const float step = samples ? (gainEnd - gainStart) / static_cast<float>(samples) : 0.0f;
+    size_t i = 0;
+#if defined(AUDIO_KERNELS_AVX2)
+    const __m256 lanes = _mm256_mul_ps(_mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_ps(step));
+    const __m256 halfStep = _mm256_set1_ps(8.0f * step);
+    for (; i + 16 <= samples; i += 16) {
+        const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSrc + i));
+        const __m256 gLo = _mm256_add_ps(_mm256_set1_ps(gainStart + step * static_cast<float>(i)), lanes);
+        const __m256 gHi = _mm256_add_ps(gLo, halfStep);
+        const __m256 lo = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(s))), gLo);
+        const __m256 hi = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(s, 1))), gHi);
+        if (meterVectors) {
+            meter.Add(lo);
+            meter.Add(hi);
+        }
+        // packs works per 128-bit lane; the permute restores the sample order
+        const __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(lo), _mm256_cvtps_epi32(hi));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(pDst + i), _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+#elif defined(AUDIO_KERNELS_NEON)
+    static const float kLanes[4] = {0, 1, 2, 3};
+    const float32x4_t lanes = vld1q_f32(kLanes);
+    for (; i + 8 <= samples; i += 8) {
+        const int16x8_t s = vld1q_s16(pSrc + i);
+        const float32x4_t gLo = vmlaq_n_f32(vdupq_n_f32(gainStart + step * static_cast<float>(i)), lanes, step);
+        const float32x4_t gHi = vaddq_f32(gLo, vdupq_n_f32(4.0f * step));
+        const float32x4_t lo = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s))), gLo);
+        const float32x4_t hi = vmulq_f32(vcvtq_f32_s32(vmovl_high_s16(s)), gHi);
+        if (meterVectors) {
+            meter.Add(lo);
+            meter.Add(hi);
+        }
+        vst1q_s16(pDst + i, vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(lo)), vqmovn_s32(vcvtnq_s32_f32(hi))));
+    }
+#endif
+    for (; i < samples; ++i) {
+        const float value = pSrc[i] * (gainStart + step * static_cast<float>(i));
+        if (meterVectors) MeterSample(&block, i, value);
+        pDst[i] = SaturatePcm16(value);
+    }
+
+    if (meterVectors) MergeLevels(pLevels, block, &meter, kPcm16Scale, samples);
+    else if (pLevels) MeterOutput(pLevels, pDst, samples, kPcm16Scale);
+}
+
+void CopyWithGainFloat(float* pDst, const float* pSrc, size_t samples, float gainStart, float gainEnd, Levels* pLevels)
+{
+    if (gainStart == 1.0f && gainEnd == 1.0f && !pLevels) {
+        memcpy(pDst, pSrc, samples * sizeof(float));
+        return;
+    }
+
+    const bool meterVectors = CanMeterVectors(pLevels);
+    VectorMeter meter;
+    Levels block;
+    if (pLevels) block.channels = pLevels->channels;
+
+    const float step = samples ? (gainEnd - gainStart) / static_cast<float>(samples) : 0.0f;
+    size_t i = 0;
+#if defined(AUDIO_KERNELS_AVX2)
+    const __m256 lanes = _mm256_mul_ps(_mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_ps(step));
+    for (; i + 8 <= samples; i += 8) {
+        const __m256 g = _mm256_add_ps(_mm256_set1_ps(gainStart + step * static_cast<float>(i)), lanes);
+        const __m256 v = _mm256_mul_ps(_mm256_loadu_ps(pSrc + i), g);
+        if (meterVectors) meter.Add(v);
+        _mm256_storeu_ps(pDst + i, v);
+    }
+#elif defined(AUDIO_KERNELS_NEON)
+    static const float kLanes[4] = {0, 1, 2, 3};
+    const float32x4_t lanes = vld1q_f32(kLanes);
+    for (; i + 4 <= samples; i += 4) {
+        const float32x4_t g = vmlaq_n_f32(vdupq_n_f32(gainStart + step * static_cast<float>(i)), lanes, step);
+        const float32x4_t v = vmulq_f32(vld1q_f32(pSrc + i), g);
+        if (meterVectors) meter.Add(v);
+        vst1q_f32(pDst + i, v);
+    }
+#endif
+    for (; i < samples; ++i) {
+        pDst[i] = pSrc[i] * (gainStart + step * static_cast<float>(i));
+        if (meterVectors) MeterSample(&block, i, pDst[i]);
+    }
+
+    if (meterVectors) MergeLevels(pLevels, block, &meter, 1.0f, samples);
+    else if (pLevels) MeterOutput(pLevels, pDst, samples, 1.0f);
+}
+
+void CopyWithGainFloatToPcm16(int16_t* pDst, const float* pSrc, size_t samples, float gainStart, float gainEnd,
+                              Levels* pLevels)
+{
+    const bool meterVectors = CanMeterVectors(pLevels);
+    VectorMeter meter;
+    Levels block;
+    if (pLevels) block.channels = pLevels->channels;
+
+    const float step = samples ? (gainEnd - gainStart) / static_cast<float>(samples) : 0.0f;
+    const float startScaled = gainStart * 32768.0f;
+    const float stepScaled = step * 32768.0f;
+    size_t i = 0;
+#if defined(AUDIO_KERNELS_AVX2)
+    const __m256 lanes = _mm256_mul_ps(_mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_ps(stepScaled));
+    const __m256 halfStep = _mm256_set1_ps(8.0f * stepScaled);
+    // Clamp before converting: out-of-range floats convert to INT_MIN, which packs to -32768
+    const __m256 lo16 = _mm256_set1_ps(-32768.0f), hi16 = _mm256_set1_ps(32767.0f);
+    for (; i + 16 <= samples; i += 16) {
+        const __m256 gLo = _mm256_add_ps(_mm256_set1_ps(startScaled + stepScaled * static_cast<float>(i)), lanes);
+        const __m256 gHi = _mm256_add_ps(gLo, halfStep);
+        const __m256 lo = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(pSrc + i), gLo), lo16), hi16);
+        const __m256 hi = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(pSrc + i + 8), gHi), lo16), hi16);
+        if (meterVectors) {
+            meter.Add(lo);
+            meter.Add(hi);
+        }
+        const __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(lo), _mm256_cvtps_epi32(hi));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(pDst + i), _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+#elif defined(AUDIO_KERNELS_NEON)
+    static const float kLanes[4] = {0, 1, 2, 3};
+    const float32x4_t lanes = vld1q_f32(kLanes);
+    for (; i + 8 <= samples; i += 8) {
+        const float32x4_t gLo = vmlaq_n_f32(vdupq_n_f32(startScaled + stepScaled * static_cast<float>(i)), lanes, stepScaled);
+        const float32x4_t gHi = vaddq_f32(gLo, vdupq_n_f32(4.0f * stepScaled));
+        const float32x4_t lo = vmulq_f32(vld1q_f32(pSrc + i), gLo);
+        const float32x4_t hi = vmulq_f32(vld1q_f32(pSrc + i + 4), gHi);
+        if (meterVectors) {
+            meter.Add(lo);
+            meter.Add(hi);
+        }
+        vst1q_s16(pDst + i, vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(lo)), vqmovn_s32(vcvtnq_s32_f32(hi))));
+    }
+#endif
+    for (; i < samples; ++i) {
+        const float value = pSrc[i] * (startScaled + stepScaled * static_cast<float>(i));
+        if (meterVectors) MeterSample(&block, i, value);
+        pDst[i] = SaturatePcm16(value);
+    }
+
+    if (meterVectors) MergeLevels(pLevels, block, &meter, kPcm16Scale, samples);
+    else if (pLevels) MeterOutput(pLevels, pDst, samples, kPcm16Scale);
+}
+
+void Pcm16ToFloat(float* pDst, const int16_t* pSrc, size_t samples)
+{
+    size_t i = 0;
+#if defined(AUDIO_KERNELS_AVX2)
+    const __m256 scale = _mm256_set1_ps(kPcm16Scale);
+    for (; i + 8 <= samples; i += 8) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i));
+        _mm256_storeu_ps(pDst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(s)), scale));
+    }
+#elif defined(AUDIO_KERNELS_NEON)
+    for (; i + 8 <= samples; i += 8) {
+        const int16x8_t s = vld1q_s16(pSrc + i);
+        vst1q_f32(pDst + i,     vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s))), kPcm16Scale));
+        vst1q_f32(pDst + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_high_s16(s)), kPcm16Scale));
+    }
+#endif
+    for (; i < samples; ++i)
+        pDst[i] = pSrc[i] * kPcm16Scale;
+}
+
+template <typename T>
+static void FoldToStereo(float* pDst, const T* pSrc, UINT32 channels, size_t frames)
+{
+    for (size_t f = 0; f < frames; ++f) {
+        const size_t s = f * channels;
+        float left = LoadSample(pSrc, s);
+        float right = channels > 1 ? LoadSample(pSrc, s + 1) : left;
+        if (channels == 6 || channels == 8) {
+            // FL FR C LFE BL BR [SL SR]
+            const float centre = LoadSample(pSrc, s + 2) * kMinus3dB;
+            left += centre + LoadSample(pSrc, s + 4) * kMinus3dB;
+            right += centre + LoadSample(pSrc, s + 5) * kMinus3dB;
+            if (channels == 8) {
+                left += LoadSample(pSrc, s + 6) * kMinus3dB;
+                right += LoadSample(pSrc, s + 7) * kMinus3dB;
+            }
+        }
+        pDst[f * 2] = left;
+        pDst[f * 2 + 1] = right;
+    }
+}
+
+void ToStereoFloat(float* pDst, const void* pSrc, SampleFormat format, UINT32 channels, size_t frames)
+{
+    if (channels == 0 || format == SampleFormat::Unsupported) return;
+
+    if (channels == 2) {
+        if (format == SampleFormat::Float32)
+            memcpy(pDst, pSrc, frames * 2 * sizeof(float));
+        else
+            Pcm16ToFloat(pDst, static_cast<const int16_t*>(pSrc), frames * 2);
+        return;
+    }
+    if (format == SampleFormat::Float32)
+        FoldToStereo(pDst, static_cast<const float*>(pSrc), channels, frames);
+    else
+        FoldToStereo(pDst, static_cast<const int16_t*>(pSrc), channels, frames);
+}
+
+void AccumulateWithGain(float* pDst, const float* pSrc, size_t samples, float gainStart, float gainEnd, Levels* pLevels)
+{
+    const bool meterVectors = CanMeterVectors(pLevels);
+    VectorMeter meter;
+    Levels block;
+    if (pLevels) block.channels = pLevels->channels;
+
+    const float step = samples ? (gainEnd - gainStart) / static_cast<float>(samples) : 0.0f;
+    size_t i = 0;
+#if defined(AUDIO_KERNELS_AVX2)
+    const __m256 lanes = _mm256_mul_ps(_mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_ps(step));
+    for (; i + 8 <= samples; i += 8) {
+        const __m256 g = _mm256_add_ps(_mm256_set1_ps(gainStart + step * static_cast<float>(i)), lanes);
+        const __m256 v = _mm256_mul_ps(_mm256_loadu_ps(pSrc + i), g);
+        if (meterVectors) meter.Add(v);
+        _mm256_storeu_ps(pDst + i, _mm256_add_ps(_mm256_loadu_ps(pDst + i), v));
+    }
+#elif defined(AUDIO_KERNELS_NEON)
+    static const float kLanes[4] = {0, 1, 2, 3};
+    const float32x4_t lanes = vld1q_f32(kLanes);
+    for (; i + 4 <= samples; i += 4) {
+        const float32x4_t g = vmlaq_n_f32(vdupq_n_f32(gainStart + step * static_cast<float>(i)), lanes, step);
+        const float32x4_t v = vmulq_f32(vld1q_f32(pSrc + i), g);
+        if (meterVectors) meter.Add(v);
+        vst1q_f32(pDst + i, vaddq_f32(vld1q_f32(pDst + i), v));
+    }
+#endif
+    for (; i < samples; ++i) {
+        const float value = pSrc[i] * (gainStart + step * static_cast<float>(i));
+        if (meterVectors) MeterSample(&block, i, value);
+        pDst[i] += value;
+    }
+
+    if (meterVectors) {
+        MergeLevels(pLevels, block, &meter, 1.0f, samples);
+    } else if (pLevels) {
+        // The output also holds the other inputs: meter this one's contribution from the source
+        Levels scalar;
+        scalar.channels = pLevels->channels;
+        for (size_t j = 0; j < samples; ++j)
+            MeterSample(&scalar, j, pSrc[j] * (gainStart + step * static_cast<float>(j)));
+        MergeLevels(pLevels, scalar, nullptr, 1.0f, samples);
+    }
+}
+
+float DotProduct(const float* pA, const float* pB, size_t samples)
+{
+    float sum = 0.0f;
+    size_t i = 0;
+#if defined(AUDIO_KERNELS_AVX2)
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    for (; i + 16 <= samples; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(pA + i), _mm256_loadu_ps(pB + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(pA + i + 8), _mm256_loadu_ps(pB + i + 8), acc1);
+    }
+    const __m256 acc = _mm256_add_ps(acc0, acc1);
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+    sum = _mm_cvtss_f32(half);
+#elif defined(AUDIO_KERNELS_NEON)
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    for (; i + 4 <= samples; i += 4)
+        acc = vfmaq_f32(acc, vld1q_f32(pA + i), vld1q_f32(pB + i));
+    sum = vaddvq_f32(acc);
+#endif
+    for (; i < samples; ++i)
+        sum += pA[i] * pB[i];
+    return sum;
+}
+
+} // namespace AudioKernels
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <windows.h>
+#include <mmreg.h>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Sample processing kernels of the audio threads (AVX2 on x64, NEON on ARM64, scalar otherwise).
+ *
+ * Every kernel reads its source and writes the result in a single pass, so the audio thread can process
+ * straight into the render or mixer buffer. Gains are ramped linearly from gainStart to gainEnd across the
+ * buffer to avoid zipper noise when the volume changes; pass the same value twice for a constant gain.
+ * The output kernels can meter what they write in the same pass (see Levels).
+ */
+namespace AudioKernels {
+
+enum class SampleFormat {
+    Unsupported,
+    Pcm16,      // Signed 16-bit integer
+    Float32     // IEEE float
+};
+
+/**
+ * @brief Peak and energy of the first two channels, accumulated by the kernels that take a Levels pointer.
+ *
+ * Values are at full scale 1.0 after the gain. Mono input meters the single channel as the left one.
+ */
+struct Levels {
+    UINT32 channels = 2;            // Interleaved channel count of the metered samples (set by the caller)
+    float peak[2] = {};
+    float sumSquares[2] = {};
+    UINT32 frames = 0;
+};
+
+/**
+ * @brief Resolves the sample type of a format, including WAVE_FORMAT_EXTENSIBLE.
+ */
+SampleFormat GetSampleFormat(const WAVEFORMATEX* pFormat);
+
+/**
+ * @brief Copies 16-bit samples with gain, saturating to the 16-bit range.
+ * @param samples Number of samples (frames times channels).
+ */
+void CopyWithGainPcm16(int16_t* pDst, const int16_t* pSrc, size_t samples, float gainStart, float gainEnd,
+                       Levels* pLevels = nullptr);
+
+/**
+ * @brief Copies float samples with gain.
+ * @param samples Number of samples (frames times channels).
+ */
+void CopyWithGainFloat(float* pDst, const float* pSrc, size_t samples, float gainStart, float gainEnd,
+                       Levels* pLevels = nullptr);
+
+/**
+ * @brief Converts float samples to 16-bit with gain, saturating to the 16-bit range.
+ * @param samples Number of samples (frames times channels).
+ */
+void CopyWithGainFloatToPcm16(int16_t* pDst, const float* pSrc, size_t samples, float gainStart, float gainEnd,
+                              Levels* pLevels = nullptr);
+
+/**
+ * @brief Converts 16-bit samples to float in [-1, 1).
+ * @param samples Number of samples (frames times channels).
+ */
+void Pcm16ToFloat(float* pDst, const int16_t* pSrc, size_t samples);
+
+/**
+ * @brief Converts interleaved frames of any channel count to interleaved stereo float.
+ *
+ * Mono is duplicated to both channels; 5.1 and 7.1 (WAVE_FORMAT_EXTENSIBLE default order) are folded down
+ * with the ITU coefficients, LFE dropped. Other layouts keep their first two channels.
+ */
+void ToStereoFloat(float* pDst, const void* pSrc, SampleFormat format, UINT32 channels, size_t frames);
+
+/**
+ * @brief Adds gain-scaled samples to pDst (mixing).
+ * @param samples Number of samples (frames times channels).
+ */
+void AccumulateWithGain(float* pDst, const float* pSrc, size_t samples, float gainStart, float gainEnd,
+                        Levels* pLevels = nullptr);
+
+/**
+ * @brief Returns the sum of the products of two sample arrays (cross-correlation at one lag).
+ */
+float DotProduct(const float* pA, const float* pB, size_t samples);
+
+} // namespace AudioKernels
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <windows.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include "AudioKernels.h"
+
+/**
+ * @brief Peak and RMS levels of one instance, updated by its audio path and read wait-free by any thread.
+ *
+ * The writer feeds the levels the output kernels metered for each block it writes; peaks fall back at
+ * kPeakFallDbPerSecond and the RMS is averaged over kRmsTimeConstantSeconds, so a reader polling at
+ * display rate sees every peak. Values are linear, full scale 1.0, after the instance volume.
+ */
+class AudioLevelMeter {
+public:
+    static constexpr float kPeakFallDbPerSecond = 20.0f;
+    static constexpr double kRmsTimeConstantSeconds = 0.3;
+
+    /**
+     * @brief Folds a metered block into the published levels (writer thread only).
+     */
+    void Update(const AudioKernels::Levels& block, UINT32 sampleRate) {
+        if (!block.frames || !sampleRate) return;
+        if (m_bReset.exchange(false, std::memory_order_acquire)) {
+            m_heldPeak[0] = m_heldPeak[1] = 0.0f;
+            m_meanSquare[0] = m_meanSquare[1] = 0.0;
+        }
+
+        const double seconds = static_cast<double>(block.frames) / sampleRate;
+        const float peakFall = std::pow(10.0f, -kPeakFallDbPerSecond * static_cast<float>(seconds) / 20.0f);
+        const double rmsWeight = 1.0 - std::exp(-seconds / kRmsTimeConstantSeconds);
+        const int metered = block.channels == 1 ? 1 : 2;
+        for (int c = 0; c < 2; ++c) {
+            const int source = c < metered ? c : 0;     // Mono shows on both sides
+            m_heldPeak[c] = std::max(block.peak[source], m_heldPeak[c] * peakFall);
+            m_meanSquare[c] += rmsWeight * (block.sumSquares[source] / block.frames - m_meanSquare[c]);
+            m_peak[c].store(m_heldPeak[c], std::memory_order_relaxed);
+            m_rms[c].store(static_cast<float>(std::sqrt(std::max(m_meanSquare[c], 0.0))), std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Drops the levels to silence (pause, seek, close); safe from any thread.
+     */
+    void Reset() {
+        for (int c = 0; c < 2; ++c) {
+            m_peak[c].store(0.0f, std::memory_order_relaxed);
+            m_rms[c].store(0.0f, std::memory_order_relaxed);
+        }
+        m_bReset.store(true, std::memory_order_release);
+    }
+
+    float Peak(int channel) const { return m_peak[channel].load(std::memory_order_relaxed); }
+    float Rms(int channel) const { return m_rms[channel].load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<float> m_peak[2] = {0.0f, 0.0f};
+    std::atomic<float> m_rms[2] = {0.0f, 0.0f};
+    std::atomic<bool> m_bReset{false};
+
+    // Writer state
+    float m_heldPeak[2] = {};
+    double m_meanSquare[2] = {};
+};
@@ -3,19 +3,26 @@
 //  * Keeps the original public API so that existing call‑sites still compile.
 //  * Uses an event‑driven render loop instead of busy‑wait polling where possible.
 //  * Measures drift between the WASAPI render clock and the Media Foundation
-//    presentation clock and corrects it gradually to avoid audible glitches.
+//    presentation clock and corrects it gradually (±0.5 % resampling) to avoid
+//    audible glitches; playback speeds other than 1x are time‑stretched (WSOLA).
 //  * All sleeps are clamped to a minimum of 1 ms to keep the thread responsive.
-//  * Volume scaling is done in place only when necessary and supports both
-//    16‑bit and 32‑bit (float) PCM formats.
+//  * Volume scaling is fused with the copy into the render buffer (SIMD kernels,
+//    ramped per buffer) and supports both 16‑bit and 32‑bit (float) PCM formats.
 // -----------------------------------------------------------------------------
 
 #include "AudioManager.h"
 #include "VideoPlayerInstance.h"
 #include "Utils.h"
 #include "MediaFoundationManager.h"
+#include "StreamDemuxer.h"
+#include "AudioMixer.h"
+#include "AudioKernels.h"
+#include "AudioResampler.h"
 #include <algorithm>
 #include <cmath>
-#include <array>
+#include <utility>
+#include <vector>
+#include <avrt.h>
 
 using namespace VideoPlayerUtils;
 
@@ -23,9 +30,91 @@ namespace AudioManager {
 
 // ‑‑‑‑‑‑‑‑‑‑‑‑‑‑‑‑‑‑‑‑‑‑ Helper constants ‑‑‑‑‑‑‑‑‑‑‑‑‑‑‑‑‑‑‑‑‑‑‑‑‑‑
 constexpr REFERENCE_TIME kTargetBufferDuration100ns = 2'000'000; // 200 ms
+constexpr REFERENCE_TIME kLowLatencyBufferDuration100ns = 200'000; // 20 ms
 constexpr REFERENCE_TIME kMinSleepUs              = 1'000;       // 1 ms
-constexpr double         kDriftPositiveThresholdMs =  15.0;      // audio ahead  → wait
+constexpr double         kDriftPositiveThresholdMs = 100.0;      // audio ahead  → wait
 constexpr double         kDriftNegativeThresholdMs = -50.0;      // audio behind → drop
+constexpr double         kDriftCorrectionStartMs   =  10.0;      // rate correction on above this drift
+constexpr double         kDriftCorrectionStopMs    =   2.0;      // ... and off below this one
+constexpr double         kDriftFullCorrectionMs    =  50.0;      // drift corrected at the maximum rate
+constexpr UINT32         kStretchChunkFrames       = 1024;       // resampler output per render write
+constexpr DWORD          kDemuxReadTimeoutMs       = 50;         // longest wait for a demuxed audio packet
+
+// ------------------------------------------------------------------------------------
+//  ReactivateClient – a client whose Initialize failed cannot be initialised again
+// ------------------------------------------------------------------------------------
+static HRESULT ReactivateClient(IMMDevice* device, IAudioClient** client)
+{
+    if (*client) {
+        (*client)->Release();
+        *client = nullptr;
+    }
+    return device->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr, reinterpret_cast<void**>(client));
+}
+
+// ------------------------------------------------------------------------------------
+//  InitializeClient – event‑driven stream with the buffer of the requested latency mode
+// ------------------------------------------------------------------------------------
+static HRESULT InitializeClient(IMMDevice* device, IAudioClient** client, const WAVEFORMATEX* fmt,
+                                AudioLatencyMode mode, BOOL* pExclusive)
+{
+    HRESULT hr = E_FAIL;
+    *pExclusive = FALSE;
+
+    if (mode == AUDIO_LATENCY_EXCLUSIVE) {
+        // Exclusive mode: the device's minimum period, both as buffer and period
+        REFERENCE_TIME defaultPeriod = 0, minPeriod = 0;
+        hr = (*client)->IsFormatSupported(AUDCLNT_SHAREMODE_EXCLUSIVE, fmt, nullptr);
+        if (SUCCEEDED(hr))
+            hr = (*client)->GetDevicePeriod(&defaultPeriod, &minPeriod);
+        if (SUCCEEDED(hr))
+            hr = (*client)->Initialize(AUDCLNT_SHAREMODE_EXCLUSIVE, AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+                                       minPeriod, minPeriod, fmt, nullptr);
+        if (hr == AUDCLNT_E_BUFFER_SIZE_NOT_ALIGNED) {
+            // Retry with the period rounded to the aligned buffer size reported by the device
+            UINT32 alignedFrames = 0;
+            hr = (*client)->GetBufferSize(&alignedFrames);
+            if (SUCCEEDED(hr))
+                hr = ReactivateClient(device, client);
+            if (SUCCEEDED(hr)) {
+                minPeriod = static_cast<REFERENCE_TIME>(10'000'000.0 * alignedFrames / fmt->nSamplesPerSec + 0.5);
+                hr = (*client)->Initialize(AUDCLNT_SHAREMODE_EXCLUSIVE, AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+                                           minPeriod, minPeriod, fmt, nullptr);
+            }
+        }
+        if (SUCCEEDED(hr)) {
+            *pExclusive = TRUE;
+            return hr;
+        }
+        if (FAILED(ReactivateClient(device, client))) return hr;
+    }
+
+    if (mode == AUDIO_LATENCY_LOW) {
+        // Shared mode at the engine's minimum period (Windows 10 and later)
+        IAudioClient3* client3 = nullptr;
+        if (SUCCEEDED((*client)->QueryInterface(IID_PPV_ARGS(&client3)))) {
+            UINT32 defaultFrames = 0, fundamentalFrames = 0, minFrames = 0, maxFrames = 0;
+            hr = client3->GetSharedModeEnginePeriod(fmt, &defaultFrames, &fundamentalFrames, &minFrames, &maxFrames);
+            if (SUCCEEDED(hr))
+                hr = client3->InitializeSharedAudioStream(AUDCLNT_STREAMFLAGS_EVENTCALLBACK, minFrames, fmt, nullptr);
+            client3->Release();
+            if (SUCCEEDED(hr)) return hr;
+            if (FAILED(ReactivateClient(device, client))) return hr;
+        }
+        hr = (*client)->Initialize(AUDCLNT_SHAREMODE_SHARED, AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+                                   kLowLatencyBufferDuration100ns, 0, fmt, nullptr);
+        if (SUCCEEDED(hr)) return hr;
+        if (FAILED(ReactivateClient(device, client))) return hr;
+    }
+
+    // Default: shared mode with a large buffer, periodicity left to the system
+    return (*client)->Initialize(AUDCLNT_SHAREMODE_SHARED,
+                                 AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+                                 kTargetBufferDuration100ns, // buffer dur
+                                 0,                          // periodicity → let system decide
+                                 fmt,
+                                 nullptr);
+}
 
 // ------------------------------------------------------------------------------------
 //  InitWASAPI  –  initialises the shared WASAPI client for the default render endpoint
@@ -40,6 +129,26 @@ HRESULT InitWASAPI(VideoPlayerInstance* inst, const WAVEFORMATEX* srcFmt)
         return S_OK;
     }
 
+    // Feed the process-wide mixer instead of opening a render stream, when the format allows it
+    if (inst->bUseAudioMixer && AudioMixer::IsSupportedFormat(srcFmt)) {
+        if (inst->pMixerSource) {
+            inst->bAudioInitialized = TRUE;
+            return S_OK;
+        }
+        if (!inst->hAudioSamplesReadyEvent)
+            inst->hAudioSamplesReadyEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        AudioMixer* mixer = MediaFoundation::GetAudioMixer();
+        if (mixer && inst->hAudioSamplesReadyEvent &&
+            SUCCEEDED(mixer->AddSource(srcFmt, inst->hAudioSamplesReadyEvent, &inst->audioLevels, &inst->pMixerSource))) {
+            inst->pMixerSource->gain = inst->instanceVolume.load();
+            inst->pSourceAudioFormat = reinterpret_cast<WAVEFORMATEX*>(CoTaskMemAlloc(srcFmt->cbSize + sizeof(WAVEFORMATEX)));
+            memcpy(inst->pSourceAudioFormat, srcFmt, srcFmt->cbSize + sizeof(WAVEFORMATEX));
+            inst->bAudioInitialized = TRUE;
+            return S_OK;
+        }
+        // Fall back to a dedicated render stream
+    }
+
     HRESULT hr = S_OK;
     WAVEFORMATEX* deviceMixFmt = nullptr;
 
@@ -77,13 +186,11 @@ HRESULT InitWASAPI(VideoPlayerInstance* inst, const WAVEFORMATEX* srcFmt)
         }
     }
 
-    // 5. Initialise the audio client in shared, event‑callback mode
-    hr = inst->pAudioClient->Initialize(AUDCLNT_SHAREMODE_SHARED,
-                                        AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
-                                        kTargetBufferDuration100ns, // buffer dur
-                                        0,                          // periodicity → let system decide
-                                        srcFmt,
-                                        nullptr);
+    // 5. Initialise the audio client in event‑callback mode, falling back to the default latency
+    hr = InitializeClient(inst->pDevice, &inst->pAudioClient, srcFmt, inst->audioLatencyMode, &inst->bExclusiveAudio);
+    if (FAILED(hr) && inst->audioLatencyMode != AUDIO_LATENCY_DEFAULT &&
+        SUCCEEDED(ReactivateClient(inst->pDevice, &inst->pAudioClient)))
+        hr = InitializeClient(inst->pDevice, &inst->pAudioClient, srcFmt, AUDIO_LATENCY_DEFAULT, &inst->bExclusiveAudio);
     if (FAILED(hr)) goto cleanup;
 
     hr = inst->pAudioClient->SetEventHandle(inst->hAudioSamplesReadyEvent);
@@ -94,6 +201,13 @@ HRESULT InitWASAPI(VideoPlayerInstance* inst, const WAVEFORMATEX* srcFmt)
                                         reinterpret_cast<void**>(&inst->pRenderClient));
     if (FAILED(hr)) goto cleanup;
 
+    // 7. Played‑position clock for CLOCK_MODE_AUDIO (optional)
+    if (SUCCEEDED(inst->pAudioClient->GetService(__uuidof(IAudioClock), reinterpret_cast<void**>(&inst->pAudioClock))) &&
+        FAILED(inst->pAudioClock->GetFrequency(&inst->audioClockFrequency))) {
+        inst->pAudioClock->Release();
+        inst->pAudioClock = nullptr;
+    }
+
     inst->bAudioInitialized = TRUE;
 
 cleanup:
@@ -101,81 +215,319 @@ cleanup:
     return hr;
 }
 
+// ----------------------------------------------------------------------------
+//  ReadAudioSample – pulls the next decoded sample from the demuxer or the audio reader
+// ----------------------------------------------------------------------------
+static HRESULT ReadAudioSample(VideoPlayerInstance* inst, DWORD* flags, LONGLONG* ts100n, IMFSample** sample)
+{
+    // Bounded, so that a pause, a seek or a stop is seen while the demuxer is busy with video
+    if (inst->pDemuxer)
+        return inst->pDemuxer->Read(StreamDemuxer::kAudio, flags, ts100n, sample, kDemuxReadTimeoutMs);
+    return inst->pSourceReaderAudio->ReadSample(MF_SOURCE_READER_FIRST_AUDIO_STREAM,
+                                                0, nullptr, flags, ts100n, sample);
+}
+
+// ----------------------------------------------------------------------------
+//  DetachAudioClock – ends audio-master pacing once nothing more will be played
+// ----------------------------------------------------------------------------
+static void DetachAudioClock(VideoPlayerInstance* inst, bool endOfStream)
+{
+    // The played position freezes once the output stops, which would hold video back for good
+    MFTIME audioTime = 0;
+    const bool anchored = GetAudioClockTime(inst, &audioTime);
+    AcquireSRWLockExclusive(&inst->audioClockLock);
+    inst->llAudioClockWrittenEnd = -1;
+    ReleaseSRWLockExclusive(&inst->audioClockLock);
+
+    // At the end of the audio the video plays on against the presentation clock, re-based where the audio
+    // was so the master time does not jump
+    MFCLOCK_STATE state = MFCLOCK_STATE_INVALID;
+    if (endOfStream && anchored && inst->clockMode == CLOCK_MODE_AUDIO && inst->pPresentationClock &&
+        SUCCEEDED(inst->pPresentationClock->GetState(0, &state)) && state == MFCLOCK_STATE_RUNNING)
+        inst->pPresentationClock->Start(audioTime);
+}
+
 // ----------------------------------------------------------------------------
 //  AudioThreadProc – feeds decoded audio samples into the WASAPI render client
 // ----------------------------------------------------------------------------
 DWORD WINAPI AudioThreadProc(LPVOID lpParam)
 {
     auto* inst = static_cast<VideoPlayerInstance*>(lpParam);
-    if (!inst || !inst->pAudioClient || !inst->pRenderClient || !inst->pSourceReaderAudio)
+    if (!inst || !HasAudioOutput(inst) || (!inst->pSourceReaderAudio && !inst->pDemuxer))
         return 0;
+    AudioMixerSource* mixerSource = inst->pMixerSource;
 
     // Pre‑warm the audio engine so that GetBufferSize() is valid
     UINT32 engineBufferFrames = 0;
-    if (FAILED(inst->pAudioClient->GetBufferSize(&engineBufferFrames)))
+    if (mixerSource)
+        engineBufferFrames = mixerSource->bufferFrames;
+    else if (FAILED(inst->pAudioClient->GetBufferSize(&engineBufferFrames)))
         return 0;
 
+    // An exclusive stream takes one whole period (its buffer size) per event: frames are staged in periodBuffer
+    // until a period is complete, then copied in one GetBuffer
+    const bool exclusive = !mixerSource && inst->bExclusiveAudio;
+    UINT32 periodFrames = 0;
+
+    // Frames that can be queued right now, in the render stream, the staged period or the mixer input
+    auto getFreeFrames = [&](UINT32* framesFree) -> HRESULT {
+        if (mixerSource) {
+            *framesFree = engineBufferFrames - std::min(engineBufferFrames, mixerSource->ring.Size());
+            return S_OK;
+        }
+        if (exclusive) {
+            *framesFree = engineBufferFrames - periodFrames;
+            return S_OK;
+        }
+        UINT32 framesPadding = 0;
+        HRESULT hrPad = inst->pAudioClient->GetCurrentPadding(&framesPadding);
+        *framesFree = engineBufferFrames - framesPadding;
+        return hrPad;
+    };
+
     if (inst->hAudioReadyEvent)
         WaitForSingleObject(inst->hAudioReadyEvent, INFINITE);
 
+    // Let MMCSS schedule the feed ahead of normal threads; small buffers leave no slack for preemption
+    DWORD mmcssTaskIndex = 0;
+    HANDLE mmcssTask = AvSetMmThreadCharacteristicsW(
+        inst->audioLatencyMode == AUDIO_LATENCY_DEFAULT ? L"Audio" : L"Pro Audio", &mmcssTaskIndex);
+
     const UINT32 blockAlign = inst->pSourceAudioFormat ? inst->pSourceAudioFormat->nBlockAlign : 4;
-    const double invPlaybackSpeed =
-        1.0 / std::max(0.0001, static_cast<double>(inst->playbackSpeed));
+    std::vector<BYTE> periodBuffer(exclusive ? static_cast<size_t>(engineBufferFrames) * blockAlign : 0);
+    const UINT32 channels = inst->pSourceAudioFormat ? inst->pSourceAudioFormat->nChannels : 2;
+    const UINT32 sampleRate = inst->pSourceAudioFormat ? inst->pSourceAudioFormat->nSamplesPerSec : 48000;
+    const AudioKernels::SampleFormat sampleFormat = AudioKernels::GetSampleFormat(inst->pSourceAudioFormat);
+    float appliedGain = inst->instanceVolume;
+
+    // Time‑stretch and drift‑correction stage, bypassed at normal speed while in sync
+    const bool canResample = sampleFormat != AudioKernels::SampleFormat::Unsupported;
+    AudioResampler resampler(channels, sampleRate);
+    std::vector<float> stretchInput;
+    std::vector<float> stretchOutput(static_cast<size_t>(kStretchChunkFrames) * channels);
+    bool correctingDrift = false;
+    LONG seekCount = inst->seekCount;
+
+    // Set once audio was queued; finding the output drained afterwards while playing is an underrun
+    bool primed = false;
+    bool endOfStream = false;
+
+    // Frames written to the render stream since the last seek, the origin of its played position
+    // (including those of the previous media when the stream was kept across a switch)
+    UINT64 writtenFrames = std::exchange(inst->audioContinuedFrames, 0);
+    auto framesTo100ns = [sampleRate](double frames) {
+        return static_cast<LONGLONG>(frames * 10'000'000.0 / sampleRate);
+    };
+    auto publishClock = [&](LONGLONG writtenEnd100ns, double frameTempo) {
+        if (!inst->pAudioClock || inst->seekCount != seekCount) return;
+        // Frames still staged for an exclusive stream have not reached it yet
+        writtenEnd100ns -= framesTo100ns(periodFrames * frameTempo);
+        AcquireSRWLockExclusive(&inst->audioClockLock);
+        inst->audioClockWrittenFrames = writtenFrames;
+        inst->llAudioClockWrittenEnd = writtenEnd100ns;
+        inst->audioClockTempo = frameTempo;
+        ReleaseSRWLockExclusive(&inst->audioClockLock);
+    };
 
-    // Main render loop – wait for "ready" event, then push as many frames as possible
-    while (inst->bAudioThreadRunning) {
-        DWORD signalled = WaitForSingleObject(inst->hAudioSamplesReadyEvent, 10);
-        if (signalled != WAIT_OBJECT_0) continue; // timeout ⇒ loop back
+    // Hands a complete staged period to an exclusive stream
+    auto submitPeriod = [&]() {
+        AcquireSRWLockShared(&inst->audioOutputLock);
+        BYTE* dstData = nullptr;
+        if (inst->seekCount == seekCount &&
+            SUCCEEDED(inst->pRenderClient->GetBuffer(engineBufferFrames, &dstData)) && dstData) {
+            memcpy(dstData, periodBuffer.data(), periodBuffer.size());
+            inst->pRenderClient->ReleaseBuffer(engineBufferFrames, 0);
+            writtenFrames += engineBufferFrames;
+        }
+        ReleaseSRWLockShared(&inst->audioOutputLock);
+        periodFrames = 0;
+    };
+
+    // Blocks until the output has consumed frames or the pause, seek or stop state changes.
+    // A stopped stream never signals, so a paused player sleeps here without waking up.
+    auto waitForSpace = [&]() {
+        HANDLE events[] = { inst->hAudioSamplesReadyEvent, inst->hAudioStateEvent };
+        const DWORD signalled = WaitForMultipleObjects(ARRAYSIZE(events), events, FALSE, INFINITE);
+        if (exclusive && signalled == WAIT_OBJECT_0 && periodFrames == engineBufferFrames)
+            submitPeriod();
+    };
+
+    // Writes frames to the render stream or the mixer input, waiting for room as needed.
+    // Frames are either the decoded ones or the float output of the resampler.
+    UINT32 framesFree = 0;
+    auto render = [&](const BYTE* srcData, AudioKernels::SampleFormat srcFormat, UINT32 totalFrames) -> bool {
+        const UINT32 srcBlockAlign = srcFormat == sampleFormat ? blockAlign : channels * static_cast<UINT32>(sizeof(float));
+        UINT32 offsetFrames = 0;
+        while (offsetFrames < totalFrames) {
+            UINT32 framesWanted = std::min(totalFrames - offsetFrames, framesFree);
+            if (framesWanted == 0) {
+                // Renderer is full → wait for next event; a seek meanwhile makes the rest stale
+                waitForSpace();
+                if (!inst->bAudioThreadRunning || inst->seekCount != seekCount) return false;
+                if (FAILED(getFreeFrames(&framesFree))) return false;
+                continue;
+            }
+
+            const BYTE* chunkStart = srcData + (offsetFrames * srcBlockAlign);
+
+            // A seek resets the output under the exclusive lock; chunks of the old position stop here
+            AcquireSRWLockShared(&inst->audioOutputLock);
+            if (inst->seekCount != seekCount) {
+                ReleaseSRWLockShared(&inst->audioOutputLock);
+                return false;
+            }
+
+            if (mixerSource) {
+                // The mixer applies the instance volume while summing
+                mixerSource->ring.Write(chunkStart, framesWanted, srcFormat, mixerSource->inputChannels);
+            } else {
+                BYTE* dstData = nullptr;
+                if (exclusive) {
+                    dstData = periodBuffer.data() + static_cast<size_t>(periodFrames) * blockAlign;
+                } else if (FAILED(inst->pRenderClient->GetBuffer(framesWanted, &dstData)) || !dstData) {
+                    ReleaseSRWLockShared(&inst->audioOutputLock);
+                    return false;
+                }
+
+                // Copy with the per‑instance volume, ramped from the gain the previous chunk ended at,
+                // metering the result in the same pass
+                const float gain = inst->instanceVolume;
+                const size_t samples = static_cast<size_t>(framesWanted) * channels;
+                AudioKernels::Levels levels;
+                levels.channels = channels;
+                if (sampleFormat == AudioKernels::SampleFormat::Pcm16 && srcFormat == AudioKernels::SampleFormat::Float32)
+                    AudioKernels::CopyWithGainFloatToPcm16(reinterpret_cast<int16_t*>(dstData),
+                                                           reinterpret_cast<const float*>(chunkStart), samples, appliedGain, gain, &levels);
+                else if (sampleFormat == AudioKernels::SampleFormat::Pcm16)
+                    AudioKernels::CopyWithGainPcm16(reinterpret_cast<int16_t*>(dstData),
+                                                    reinterpret_cast<const int16_t*>(chunkStart), samples, appliedGain, gain, &levels);
+                else if (sampleFormat == AudioKernels::SampleFormat::Float32)
+                    AudioKernels::CopyWithGainFloat(reinterpret_cast<float*>(dstData),
+                                                    reinterpret_cast<const float*>(chunkStart), samples, appliedGain, gain, &levels);
+                else
+                    memcpy(dstData, chunkStart, framesWanted * blockAlign);
+                appliedGain = gain;
+                inst->audioLevels.Update(levels, sampleRate);
+
+                if (exclusive) {
+                    periodFrames += framesWanted;
+                } else {
+                    inst->pRenderClient->ReleaseBuffer(framesWanted, 0);
+                    writtenFrames += framesWanted;
+                }
+            }
+            ReleaseSRWLockShared(&inst->audioOutputLock);
+            offsetFrames += framesWanted;
+
+            // Recompute free frames for potential second iteration in this loop
+            if (FAILED(getFreeFrames(&framesFree))) return false;
+        }
+        return true;
+    };
 
+    auto renderResampled = [&]() {
+        UINT32 frames = 0;
+        while ((frames = resampler.Pull(stretchOutput.data(), kStretchChunkFrames)) != 0)
+            if (!render(reinterpret_cast<const BYTE*>(stretchOutput.data()), AudioKernels::SampleFormat::Float32, frames))
+                return;
+    };
+
+    // Main render loop – push as many frames as possible, blocking only while the output is full
+    // or playback is paused or seeking
+    while (inst->bAudioThreadRunning) {
         // Handle seek / pause concurrently with the decoder thread
         {
-            EnterCriticalSection(&inst->csClockSync);
-            bool suspended = inst->bSeekInProgress || inst->llPauseStart != 0;
-            LeaveCriticalSection(&inst->csClockSync);
+            // Wait-free: the count is loaded before the flag a seek raises ahead of incrementing it
+            const LONG currentSeekCount = inst->seekCount.load(std::memory_order_acquire);
+            bool suspended = inst->bSeekInProgress.load(std::memory_order_acquire) ||
+                             inst->llPauseStart.load(std::memory_order_acquire) != 0;
+            bool seeked = currentSeekCount != seekCount;
+            seekCount = currentSeekCount;
+            if (seeked) {
+                // Audio buffered for the old position must not be played
+                resampler.Reset();
+                correctingDrift = false;
+                writtenFrames = 0;
+                periodFrames = 0;
+            }
             if (suspended) {
-                PreciseSleepHighRes(5);
+                primed = false;
+                // Resume, the end of the seek and stop all signal the state event
+                WaitForSingleObject(inst->hAudioStateEvent, INFINITE);
                 continue;
             }
         }
 
         // How many frames are currently available for writing?
-        UINT32 framesPadding = 0;
-        if (FAILED(inst->pAudioClient->GetCurrentPadding(&framesPadding)))
+        if (FAILED(getFreeFrames(&framesFree)))
             break;
-        UINT32 framesFree = engineBufferFrames - framesPadding;
-        if (framesFree == 0) continue; // buffer full – wait for next event
+        // (an exclusive stream double-buffers in the device, so an empty staged period is not an underrun)
+        if (primed && !exclusive && framesFree >= engineBufferFrames) {
+            inst->metrics.Increment(PlayerMetrics::kAudioUnderruns);
+            primed = false;
+        }
+        if (framesFree == 0) {
+            // Buffer full – wait for the renderer or the mixer to consume
+            waitForSpace();
+            continue;
+        }
 
         // Read one decoded sample from MF (non‑blocking)
         IMFSample* sample = nullptr;
         DWORD      flags  = 0;
         LONGLONG   ts100n = 0;
-        HRESULT hr = inst->pSourceReaderAudio->ReadSample(MF_SOURCE_READER_FIRST_AUDIO_STREAM,
-                                                          0, nullptr, &flags, &ts100n, &sample);
+        const LONGLONG decodeStart = PlayerMetrics::Now();
+        HRESULT hr = ReadAudioSample(inst, &flags, &ts100n, &sample);
         if (FAILED(hr)) break;
-        if (!sample)     continue; // decoder starved – wait for more data
+        // The end of stream usually comes without a sample
         if (flags & MF_SOURCE_READERF_ENDOFSTREAM) {
-            sample->Release();
+            if (sample) sample->Release();
+            endOfStream = true;
             break;
         }
-
-        // Measure drift between sample PTS and presentation clock
+        if (!sample)     continue; // decoder starved – wait for more data
+        inst->metrics.Record(PlayerMetrics::kAudioDecode, PlayerMetrics::MicrosecondsSince(decodeStart));
+
+        // Measure drift between the audio being heard and the presentation clock: the sample starts
+        // after everything still queued in the render buffer and the resampler
+        const double tempo = std::clamp(static_cast<double>(inst->playbackSpeed),
+                                        AudioResampler::kMinTempo, AudioResampler::kMaxTempo);
+        // With the audio clock as master time the video follows the audio, so there is nothing to correct
+        const bool audioMaster = inst->clockMode == CLOCK_MODE_AUDIO && inst->pAudioClock && !mixerSource;
         double driftMs = 0.0;
-        if (inst->pPresentationClock && ts100n > 0) {
+        if (inst->pPresentationClock && ts100n > 0 && !audioMaster) {
             MFTIME clockTime = 0;
-            if (SUCCEEDED(inst->pPresentationClock->GetTime(&clockTime)))
-                driftMs = static_cast<double>(ts100n - clockTime) / 10'000.0;
+            if (SUCCEEDED(inst->pPresentationClock->GetTime(&clockTime))) {
+                const UINT32 queuedFrames = exclusive ? engineBufferFrames + periodFrames
+                                                      : engineBufferFrames - std::min(engineBufferFrames, framesFree);
+                const double queuedMs = (queuedFrames * tempo + resampler.PendingInputFrames()) * 1000.0 / sampleRate;
+                driftMs = static_cast<double>(ts100n - clockTime) / 10'000.0 - queuedMs;
+                inst->metrics.Record(PlayerMetrics::kAudioDrift, static_cast<UINT64>(std::abs(driftMs) * 1000.0));
+            }
         }
 
         if (driftMs > kDriftPositiveThresholdMs) {
-            // Audio ahead → delay feed to renderer (scaled by playback rate)
-            PreciseSleepHighRes(std::min(driftMs, 100.0) * invPlaybackSpeed);
+            // Audio far ahead → delay feed to renderer (scaled by playback rate)
+            inst->metrics.Increment(PlayerMetrics::kAudioSamplesDelayed);
+            PreciseSleepHighRes(std::min(driftMs, 100.0) / tempo);
         } else if (driftMs < kDriftNegativeThresholdMs) {
-            // Audio too late → drop sample completely (skip)
+            // Audio far behind → drop sample completely (skip)
+            inst->metrics.Increment(PlayerMetrics::kAudioSamplesDropped);
             sample->Release();
             continue;
         }
 
-        // Copy contiguous audio buffer into render buffer – may span multiple GetBuffer() calls
+        // Smaller drift is absorbed by playing slightly faster or slower, with hysteresis so that
+        // measurement jitter does not toggle the resampler
+        if (std::abs(driftMs) > kDriftCorrectionStartMs)
+            correctingDrift = true;
+        else if (std::abs(driftMs) < kDriftCorrectionStopMs)
+            correctingDrift = false;
+        const double rateAdjust = correctingDrift
+            ? -AudioResampler::kMaxRateAdjust * std::clamp(driftMs / kDriftFullCorrectionMs, -1.0, 1.0)
+            : 0.0;
+        const bool stretch = canResample && (tempo != 1.0 || correctingDrift);
+
         IMFMediaBuffer* mediaBuf = nullptr;
         if (FAILED(sample->ConvertToContiguousBuffer(&mediaBuf)) || !mediaBuf) {
             sample->Release();
@@ -190,46 +542,31 @@ DWORD WINAPI AudioThreadProc(LPVOID lpParam)
             continue;
         }
 
-        UINT32 totalFrames = srcSize / blockAlign;
-        UINT32 offsetFrames = 0;
-
-        while (offsetFrames < totalFrames) {
-            UINT32 framesWanted = std::min(totalFrames - offsetFrames, framesFree);
-            if (framesWanted == 0) {
-                // Renderer is full → wait for next event
-                WaitForSingleObject(inst->hAudioSamplesReadyEvent, 5);
-                if (FAILED(inst->pAudioClient->GetCurrentPadding(&framesPadding))) break;
-                framesFree = engineBufferFrames - framesPadding;
-                continue;
+        const UINT32 totalFrames = srcSize / blockAlign;
+        if (stretch) {
+            resampler.SetTempo(tempo);
+            resampler.SetRateAdjust(rateAdjust);
+            const float* frames = reinterpret_cast<const float*>(srcData);
+            if (sampleFormat == AudioKernels::SampleFormat::Pcm16) {
+                stretchInput.resize(static_cast<size_t>(totalFrames) * channels);
+                AudioKernels::Pcm16ToFloat(stretchInput.data(), reinterpret_cast<const int16_t*>(srcData), stretchInput.size());
+                frames = stretchInput.data();
             }
-
-            BYTE* dstData = nullptr;
-            if (FAILED(inst->pRenderClient->GetBuffer(framesWanted, &dstData)) || !dstData) break;
-
-            const BYTE* chunkStart = srcData + (offsetFrames * blockAlign);
-            memcpy(dstData, chunkStart, framesWanted * blockAlign);
-
-            // Apply per‑instance volume in‑place (16‑bit PCM or IEEE‑float)
-            if (inst->instanceVolume < 0.999f) {
-                if (inst->pSourceAudioFormat->wFormatTag == WAVE_FORMAT_PCM &&
-                    inst->pSourceAudioFormat->wBitsPerSample == 16) {
-                    auto* s = reinterpret_cast<int16_t*>(dstData);
-                    size_t n = (framesWanted * blockAlign) / sizeof(int16_t);
-                    for (size_t i = 0; i < n; ++i) s[i] = static_cast<int16_t>(s[i] * inst->instanceVolume);
-                } else if (inst->pSourceAudioFormat->wFormatTag == WAVE_FORMAT_IEEE_FLOAT &&
-                           inst->pSourceAudioFormat->wBitsPerSample == 32) {
-                    auto* s = reinterpret_cast<float*>(dstData);
-                    size_t n = (framesWanted * blockAlign) / sizeof(float);
-                    for (size_t i = 0; i < n; ++i) s[i] *= inst->instanceVolume;
-                }
+            resampler.Push(frames, totalFrames);
+            renderResampled();
+            publishClock(ts100n + framesTo100ns(totalFrames - resampler.PendingInputFrames()), tempo);
+            primed = true;
+        } else {
+            // Back to the direct path: play out what the resampler still holds first
+            if (resampler.HasPending()) {
+                resampler.Drain();
+                renderResampled();
+                resampler.Reset();
+            }
+            if (render(srcData, sampleFormat, totalFrames)) {
+                publishClock(ts100n + framesTo100ns(totalFrames), 1.0);
+                primed = true;
             }
-
-            inst->pRenderClient->ReleaseBuffer(framesWanted, 0);
-            offsetFrames += framesWanted;
-
-            // Recompute free frames for potential second iteration in this loop
-            if (FAILED(inst->pAudioClient->GetCurrentPadding(&framesPadding))) break;
-            framesFree = engineBufferFrames - framesPadding;
         }
 
         mediaBuf->Unlock();
@@ -237,7 +574,9 @@ DWORD WINAPI AudioThreadProc(LPVOID lpParam)
         sample->Release();
     }
 
-    inst->pAudioClient->Stop();
+    DetachAudioClock(inst, endOfStream);
+    StopAudioOutput(inst);
+    if (mmcssTask) AvRevertMmThreadCharacteristics(mmcssTask);
     return 0;
 }
 
@@ -272,6 +611,7 @@ void StopAudioThread(VideoPlayerInstance* inst)
     if (!inst) return;
 
     inst->bAudioThreadRunning = FALSE;
+    WakeAudioThread(inst);
     if (inst->hAudioThread) {
         if (WaitForSingleObject(inst->hAudioThread, 1000) == WAIT_TIMEOUT)
             TerminateThread(inst->hAudioThread, 0);
@@ -279,7 +619,116 @@ void StopAudioThread(VideoPlayerInstance* inst)
         inst->hAudioThread = nullptr;
     }
 
-    if (inst->pAudioClient) inst->pAudioClient->Stop();
+    StopAudioOutput(inst);
+}
+
+void WakeAudioThread(VideoPlayerInstance* inst)
+{
+    if (inst && inst->hAudioStateEvent) SetEvent(inst->hAudioStateEvent);
+}
+
+// -----------------------------------------------------------------
+//  Output control – dedicated render stream or shared mixer input
+// -----------------------------------------------------------------
+bool HasAudioOutput(const VideoPlayerInstance* inst)
+{
+    return inst && (inst->pMixerSource || (inst->pAudioClient && inst->pRenderClient));
+}
+
+void StartAudioOutput(VideoPlayerInstance* inst)
+{
+    if (!inst) return;
+    if (inst->pMixerSource) inst->pMixerSource->bActive = true;
+    else if (inst->pAudioClient) inst->pAudioClient->Start();
+}
+
+void StopAudioOutput(VideoPlayerInstance* inst)
+{
+    if (!inst) return;
+    if (inst->pMixerSource) inst->pMixerSource->bActive = false;
+    else if (inst->pAudioClient) inst->pAudioClient->Stop();
+    inst->audioLevels.Reset();
+}
+
+void ResetAudioOutput(VideoPlayerInstance* inst)
+{
+    if (!inst) return;
+
+    // Waits for a chunk being written to finish; IAudioClient::Reset fails while a buffer is held
+    AcquireSRWLockExclusive(&inst->audioOutputLock);
+    if (inst->pMixerSource) inst->pMixerSource->bDiscard = true;
+    else if (inst->pAudioClient) inst->pAudioClient->Reset();
+    ReleaseSRWLockExclusive(&inst->audioOutputLock);
+    inst->audioLevels.Reset();
+
+    // The played position restarts from zero; no master time until new audio is written
+    AcquireSRWLockExclusive(&inst->audioClockLock);
+    inst->audioClockWrittenFrames = 0;
+    inst->audioContinuedFrames = 0;
+    inst->llAudioClockWrittenEnd = -1;
+    ReleaseSRWLockExclusive(&inst->audioClockLock);
+}
+
+LONGLONG ContinueAudioOutput(VideoPlayerInstance* inst)
+{
+    if (!inst || !inst->pSourceAudioFormat) return 0;
+
+    UINT32 queuedFrames = 0;
+    AcquireSRWLockExclusive(&inst->audioOutputLock);
+    if (inst->pMixerSource) queuedFrames = inst->pMixerSource->ring.Size();
+    else if (inst->pAudioClient) inst->pAudioClient->GetCurrentPadding(&queuedFrames);
+    ReleaseSRWLockExclusive(&inst->audioOutputLock);
+
+    // The played position keeps counting from the previous media's frames; no master time until the
+    // next media's audio is written
+    AcquireSRWLockExclusive(&inst->audioClockLock);
+    inst->audioContinuedFrames = inst->audioClockWrittenFrames;
+    inst->llAudioClockWrittenEnd = -1;
+    ReleaseSRWLockExclusive(&inst->audioClockLock);
+
+    return static_cast<LONGLONG>(queuedFrames) * 10'000'000 / inst->pSourceAudioFormat->nSamplesPerSec;
+}
+
+bool GetAudioClockTime(VideoPlayerInstance* inst, MFTIME* time)
+{
+    if (!inst || !time || !inst->pAudioClock || !inst->pSourceAudioFormat || !inst->audioClockFrequency)
+        return false;
+
+    AcquireSRWLockShared(&inst->audioClockLock);
+    const UINT64 written = inst->audioClockWrittenFrames;
+    const LONGLONG writtenEnd = inst->llAudioClockWrittenEnd;
+    const double tempo = inst->audioClockTempo;
+    ReleaseSRWLockShared(&inst->audioClockLock);
+    if (writtenEnd < 0) return false;
+
+    UINT64 position = 0;
+    if (FAILED(inst->pAudioClock->GetPosition(&position, nullptr))) return false;
+
+    // Frames still queued behind the one being played, each covering tempo frames of media
+    const double sampleRate = inst->pSourceAudioFormat->nSamplesPerSec;
+    const double played = static_cast<double>(position) * sampleRate / static_cast<double>(inst->audioClockFrequency);
+    const double queued = std::max(0.0, static_cast<double>(written) - played);
+    *time = writtenEnd - static_cast<MFTIME>(queued * tempo * 10'000'000.0 / sampleRate);
+    return true;
+}
+
+// -----------------------------------------
+//  Output latency (buffer + stream latency)
+// -----------------------------------------
+HRESULT GetOutputLatency(const VideoPlayerInstance* inst, LONGLONG* latency100ns)
+{
+    if (!inst || !latency100ns) return E_INVALIDARG;
+    if (!inst->pAudioClient || !inst->pSourceAudioFormat) return OP_E_NOT_INITIALIZED;
+
+    UINT32 bufferFrames = 0;
+    REFERENCE_TIME streamLatency = 0;
+    HRESULT hr = inst->pAudioClient->GetBufferSize(&bufferFrames);
+    if (SUCCEEDED(hr))
+        hr = inst->pAudioClient->GetStreamLatency(&streamLatency);
+    if (FAILED(hr)) return hr;
+
+    *latency100ns = streamLatency + static_cast<LONGLONG>(bufferFrames) * 10'000'000 / inst->pSourceAudioFormat->nSamplesPerSec;
+    return S_OK;
 }
 
 // -----------------------------------------
@@ -288,7 +737,12 @@ void StopAudioThread(VideoPlayerInstance* inst)
 HRESULT SetVolume(VideoPlayerInstance* inst, float vol)
 {
     if (!inst) return E_INVALIDARG;
-    inst->instanceVolume = std::clamp(vol, 0.0f, 1.0f);
+    const float volume = std::clamp(vol, 0.0f, 1.0f);
+    inst->instanceVolume = volume;
+    // A deferred open may be publishing the mixer input; it applies the volume stored above
+    EnterCriticalSection(&inst->csClockSync);
+    if (inst->pMixerSource) inst->pMixerSource->gain = volume;
+    LeaveCriticalSection(&inst->csClockSync);
     return S_OK;
 }
 
@@ -305,18 +759,9 @@ HRESULT GetVolume(const VideoPlayerInstance* inst, float* out)
 HRESULT GetAudioLevels(const VideoPlayerInstance* inst, float* left, float* right)
 {
     if (!inst || !left || !right) return E_INVALIDARG;
-    if (!inst->pDevice)            return E_FAIL;
-
-    IAudioMeterInformation* meter = nullptr;
-    HRESULT hr = inst->pDevice->Activate(__uuidof(IAudioMeterInformation), CLSCTX_ALL, nullptr,
-                                         reinterpret_cast<void**>(&meter));
-    if (FAILED(hr)) return hr;
-
-    std::array<float, 2> peaks = {0.f, 0.f};
-    hr = meter->GetChannelsPeakValues(2, peaks.data());
-    meter->Release();
-    if (FAILED(hr)) return hr;
+    if (!HasAudioOutput(inst))     return E_FAIL;
 
+    // Peaks of this instance's own output, metered by its audio path
     auto toPercent = [](float level) {
         if (level <= 0.f) return 0.f;
         float db = 20.f * log10(level);
@@ -324,8 +769,20 @@ HRESULT GetAudioLevels(const VideoPlayerInstance* inst, float* left, float* righ
         return pct * 100.f;
     };
 
-    *left  = toPercent(peaks[0]);
-    *right = toPercent(peaks[1]);
+    *left  = toPercent(inst->audioLevels.Peak(0));
+    *right = toPercent(inst->audioLevels.Peak(1));
+    return S_OK;
+}
+
+HRESULT GetAudioLevelsEx(const VideoPlayerInstance* inst, AudioLevels* levels)
+{
+    if (!inst || !levels) return E_INVALIDARG;
+    if (!HasAudioOutput(inst)) return E_FAIL;
+
+    levels->peakLeft  = inst->audioLevels.Peak(0);
+    levels->peakRight = inst->audioLevels.Peak(1);
+    levels->rmsLeft   = inst->audioLevels.Rms(0);
+    levels->rmsRight  = inst->audioLevels.Rms(1);
     return S_OK;
 }
 
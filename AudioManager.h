@@ -13,6 +13,7 @@
 
 // Forward declarations
 struct VideoPlayerInstance;
+struct AudioLevels;
 
 namespace AudioManager {
 
@@ -44,6 +45,60 @@ HRESULT StartAudioThread(VideoPlayerInstance* pInstance);
  */
 void StopAudioThread(VideoPlayerInstance* pInstance);
 
+/**
+ * @brief Makes the audio thread re-check the pause, seek and stop state it blocks on.
+ * @param pInstance Pointer to the video player instance.
+ */
+void WakeAudioThread(VideoPlayerInstance* pInstance);
+
+/**
+ * @brief Tells whether the instance has an audio output (its own render stream or a mixer input).
+ */
+bool HasAudioOutput(const VideoPlayerInstance* pInstance);
+
+/**
+ * @brief Starts rendering the instance's audio.
+ * @param pInstance Pointer to the video player instance.
+ */
+void StartAudioOutput(VideoPlayerInstance* pInstance);
+
+/**
+ * @brief Stops rendering the instance's audio, keeping what is queued.
+ * @param pInstance Pointer to the video player instance.
+ */
+void StopAudioOutput(VideoPlayerInstance* pInstance);
+
+/**
+ * @brief Drops the audio queued for rendering (after a seek).
+ * @param pInstance Pointer to the video player instance.
+ */
+void ResetAudioOutput(VideoPlayerInstance* pInstance);
+
+/**
+ * @brief Keeps the audio queued by the previous media playing, for a switch to media in the same format:
+ *        the next audio thread writes after it. Call with the audio thread stopped.
+ * @param pInstance Pointer to the video player instance.
+ * @return Duration of the queued audio in 100-ns units.
+ */
+LONGLONG ContinueAudioOutput(VideoPlayerInstance* pInstance);
+
+/**
+ * @brief Gets the media time of the audio being played, from the render stream's played position.
+ * @param pInstance Pointer to the video player instance.
+ * @param pTime Receives the media time in 100-ns units.
+ * @return False without a dedicated render stream, before audio has been written since the last seek, or once
+ *         the audio thread has stopped.
+ */
+bool GetAudioClockTime(VideoPlayerInstance* pInstance, MFTIME* pTime);
+
+/**
+ * @brief Gets the output latency of the instance's render stream (buffer plus stream latency).
+ * @param pInstance Pointer to the video player instance.
+ * @param pLatency Receives the latency in 100-ns units.
+ * @return S_OK on success, OP_E_NOT_INITIALIZED without a dedicated render stream, or an error code.
+ */
+HRESULT GetOutputLatency(const VideoPlayerInstance* pInstance, LONGLONG* pLatency);
+
 /**
  * @brief Sets the audio volume for a video player instance.
  * @param pInstance Pointer to the video player instance.
@@ -69,4 +124,12 @@ HRESULT GetVolume(const VideoPlayerInstance* pInstance, float* volume);
  */
 HRESULT GetAudioLevels(const VideoPlayerInstance* pInstance, float* pLeftLevel, float* pRightLevel);
 
+/**
+ * @brief Gets the linear peak and RMS levels of a video player instance's own output.
+ * @param pInstance Pointer to the video player instance.
+ * @param pLevels Receives the levels.
+ * @return S_OK on success, or an error code.
+ */
+HRESULT GetAudioLevelsEx(const VideoPlayerInstance* pInstance, AudioLevels* pLevels);
+
 } // namespace AudioManager
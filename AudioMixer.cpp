@@ -0,0 +1,266 @@
+#include "AudioMixer.h"
+#include "MediaFoundationManager.h"
+#include <avrt.h>
+#include <algorithm>
+
+// Render stream buffer and per-input queue; the inputs add to the latency of the stream itself
+constexpr REFERENCE_TIME kStreamBufferDuration100ns = 400'000;  // 40 ms
+constexpr UINT32         kInputBufferFrames = AudioMixer::kSampleRate / 10; // 100 ms
+constexpr DWORD          kRenderWaitMs = 100;
+constexpr ULONGLONG      kDeviceCheckMs = 1000;    // How often the default endpoint is compared with the open one
+
+AudioMixer::AudioMixer()
+{
+}
+
+AudioMixer::~AudioMixer()
+{
+    CloseStream();
+    for (AudioMixerSource* pSource : m_sources)
+        delete pSource;
+    m_sources.clear();
+}
+
+bool AudioMixer::IsSupportedFormat(const WAVEFORMATEX* pFormat)
+{
+    return pFormat && pFormat->nChannels >= 1 && pFormat->nChannels <= kMaxInputChannels &&
+           pFormat->nSamplesPerSec == kSampleRate &&
+           AudioKernels::GetSampleFormat(pFormat) != AudioKernels::SampleFormat::Unsupported;
+}
+
+HRESULT AudioMixer::AddSource(const WAVEFORMATEX* pFormat, HANDLE hSpaceEvent, AudioLevelMeter* pMeter,
+                              AudioMixerSource** ppSource)
+{
+    if (!ppSource || !IsSupportedFormat(pFormat)) return E_INVALIDARG;
+    *ppSource = nullptr;
+
+    auto* pSource = new (std::nothrow) AudioMixerSource(kInputBufferFrames, pFormat->nChannels, hSpaceEvent, pMeter);
+    if (!pSource) return E_OUTOFMEMORY;
+
+    AcquireSRWLockExclusive(&m_lock);
+    HRESULT hr = !m_hThread ? OpenStream() : m_pAudioClient ? S_OK : OpenClient();
+    if (SUCCEEDED(hr)) {
+        m_sources.push_back(pSource);
+        if (m_sources.size() == 1)
+            hr = m_pAudioClient->Start();
+    }
+    ReleaseSRWLockExclusive(&m_lock);
+
+    if (FAILED(hr)) {
+        RemoveSource(pSource);
+        return hr;
+    }
+    *ppSource = pSource;
+    return S_OK;
+}
+
+void AudioMixer::RemoveSource(AudioMixerSource* pSource)
+{
+    if (!pSource) return;
+
+    AcquireSRWLockExclusive(&m_lock);
+    auto it = std::find(m_sources.begin(), m_sources.end(), pSource);
+    if (it != m_sources.end()) {
+        m_sources.erase(it);
+        // Nothing left to play: stop the stream so the render thread goes idle
+        if (m_sources.empty() && m_pAudioClient)
+            m_pAudioClient->Stop();
+    }
+    ReleaseSRWLockExclusive(&m_lock);
+    delete pSource;
+}
+
+HRESULT AudioMixer::OpenStream()
+{
+    m_hRenderEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    HRESULT hr = m_hRenderEvent ? OpenClient() : HRESULT_FROM_WIN32(GetLastError());
+    if (SUCCEEDED(hr)) {
+        m_bRunning = true;
+        m_hThread = CreateThread(nullptr, 0, RenderThreadProc, this, 0, nullptr);
+        if (!m_hThread) {
+            m_bRunning = false;
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+    }
+
+    if (FAILED(hr))
+        CloseStream();
+    return hr;
+}
+
+void AudioMixer::CloseStream()
+{
+    // The render thread wakes at least every kRenderWaitMs, so the join is bounded
+    m_bRunning = false;
+    if (m_hThread) {
+        SetEvent(m_hRenderEvent);
+        WaitForSingleObject(m_hThread, INFINITE);
+        CloseHandle(m_hThread);
+        m_hThread = nullptr;
+    }
+    ReleaseClient();
+    if (m_hRenderEvent) { CloseHandle(m_hRenderEvent); m_hRenderEvent = nullptr; }
+}
+
+HRESULT AudioMixer::OpenClient()
+{
+    IMMDeviceEnumerator* pEnumerator = MediaFoundation::GetDeviceEnumerator();
+    if (!pEnumerator) return E_FAIL;
+
+    HRESULT hr = pEnumerator->GetDefaultAudioEndpoint(eRender, eConsole, &m_pDevice);
+    LPWSTR deviceId = nullptr;
+    if (SUCCEEDED(hr) && SUCCEEDED(m_pDevice->GetId(&deviceId))) {
+        m_deviceId = deviceId;
+        CoTaskMemFree(deviceId);
+    }
+    if (SUCCEEDED(hr))
+        hr = m_pDevice->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr,
+                                 reinterpret_cast<void**>(&m_pAudioClient));
+
+    // Float stereo at kSampleRate; the engine converts to the mix format of the device
+    WAVEFORMATEX format = {};
+    format.wFormatTag = WAVE_FORMAT_IEEE_FLOAT;
+    format.nChannels = kChannels;
+    format.nSamplesPerSec = kSampleRate;
+    format.wBitsPerSample = 32;
+    format.nBlockAlign = format.nChannels * format.wBitsPerSample / 8;
+    format.nAvgBytesPerSec = format.nSamplesPerSec * format.nBlockAlign;
+
+    if (SUCCEEDED(hr))
+        hr = m_pAudioClient->Initialize(AUDCLNT_SHAREMODE_SHARED,
+                                        AUDCLNT_STREAMFLAGS_EVENTCALLBACK | AUDCLNT_STREAMFLAGS_AUTOCONVERTPCM |
+                                        AUDCLNT_STREAMFLAGS_SRC_DEFAULT_QUALITY,
+                                        kStreamBufferDuration100ns, 0, &format, nullptr);
+    if (SUCCEEDED(hr))
+        hr = m_pAudioClient->GetBufferSize(&m_bufferFrames);
+    if (SUCCEEDED(hr))
+        hr = m_pAudioClient->SetEventHandle(m_hRenderEvent);
+    if (SUCCEEDED(hr))
+        hr = m_pAudioClient->GetService(__uuidof(IAudioRenderClient), reinterpret_cast<void**>(&m_pRenderClient));
+
+    if (FAILED(hr))
+        ReleaseClient();
+    return hr;
+}
+
+void AudioMixer::ReleaseClient()
+{
+    if (m_pAudioClient) m_pAudioClient->Stop();
+
+    if (m_pRenderClient) { m_pRenderClient->Release(); m_pRenderClient = nullptr; }
+    if (m_pAudioClient)  { m_pAudioClient->Release();  m_pAudioClient = nullptr; }
+    if (m_pDevice)       { m_pDevice->Release();       m_pDevice = nullptr; }
+    m_deviceId.clear();
+    m_bufferFrames = 0;
+}
+
+void AudioMixer::RebuildStream()
+{
+    AcquireSRWLockExclusive(&m_lock);
+    ReleaseClient();
+    // Without an endpoint the client stays closed; the next device check tries again
+    if (SUCCEEDED(OpenClient()) && !m_sources.empty())
+        m_pAudioClient->Start();
+    ReleaseSRWLockExclusive(&m_lock);
+}
+
+bool AudioMixer::IsDefaultDeviceChanged() const
+{
+    IMMDeviceEnumerator* pEnumerator = MediaFoundation::GetDeviceEnumerator();
+    IMMDevice* pDevice = nullptr;
+    if (!pEnumerator || FAILED(pEnumerator->GetDefaultAudioEndpoint(eRender, eConsole, &pDevice)))
+        return false;
+
+    bool bChanged = !m_pAudioClient;
+    LPWSTR deviceId = nullptr;
+    if (SUCCEEDED(pDevice->GetId(&deviceId))) {
+        bChanged = bChanged || m_deviceId != deviceId;
+        CoTaskMemFree(deviceId);
+    }
+    pDevice->Release();
+    return bChanged;
+}
+
+DWORD WINAPI AudioMixer::RenderThreadProc(LPVOID lpParam)
+{
+    HRESULT hrCom = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    DWORD mmcssTaskIndex = 0;
+    HANDLE mmcssTask = AvSetMmThreadCharacteristicsW(L"Audio", &mmcssTaskIndex);
+    static_cast<AudioMixer*>(lpParam)->Render();
+    if (mmcssTask) AvRevertMmThreadCharacteristics(mmcssTask);
+    if (SUCCEEDED(hrCom)) CoUninitialize();
+    return 0;
+}
+
+void AudioMixer::Render()
+{
+    ULONGLONG lastDeviceCheck = GetTickCount64();
+    while (m_bRunning) {
+        const DWORD wait = WaitForSingleObject(m_hRenderEvent, kRenderWaitMs);
+        if (!m_bRunning)
+            break;
+
+        // Follow the default endpoint, and come back once one is plugged in again after the last one was removed
+        const ULONGLONG now = GetTickCount64();
+        if (now - lastDeviceCheck >= kDeviceCheckMs) {
+            lastDeviceCheck = now;
+            AcquireSRWLockShared(&m_lock);
+            const bool bChanged = IsDefaultDeviceChanged();
+            ReleaseSRWLockShared(&m_lock);
+            if (bChanged) {
+                RebuildStream();
+                continue;
+            }
+        }
+        if (wait != WAIT_OBJECT_0)
+            continue;
+
+        AcquireSRWLockShared(&m_lock);
+        const HRESULT hr = RenderPass();
+        ReleaseSRWLockShared(&m_lock);
+        // The endpoint was unplugged or reconfigured: reopen the stream on the current default one
+        if (hr == AUDCLNT_E_DEVICE_INVALIDATED)
+            RebuildStream();
+    }
+}
+
+HRESULT AudioMixer::RenderPass()
+{
+    if (!m_pAudioClient)
+        return S_OK;
+
+    UINT32 padding = 0;
+    HRESULT hr = m_pAudioClient->GetCurrentPadding(&padding);
+    if (FAILED(hr))
+        return hr;
+    const UINT32 frames = m_bufferFrames - padding;
+    if (frames == 0)
+        return S_OK;
+
+    BYTE* pData = nullptr;
+    hr = m_pRenderClient->GetBuffer(frames, &pData);
+    if (FAILED(hr) || !pData)
+        return hr;
+
+    // Sum every playing input into the endpoint buffer
+    auto* pOut = reinterpret_cast<float*>(pData);
+    memset(pOut, 0, static_cast<size_t>(frames) * kChannels * sizeof(float));
+
+    for (AudioMixerSource* pSource : m_sources) {
+        if (pSource->bDiscard.exchange(false, std::memory_order_acq_rel))
+            pSource->ring.Discard();
+        if (!pSource->bActive.load(std::memory_order_acquire))
+            continue;
+        const float gain = pSource->gain.load(std::memory_order_relaxed);
+        AudioKernels::Levels levels;
+        const UINT32 mixed = pSource->ring.MixInto(pOut, frames, pSource->appliedGain, gain,
+                                                   pSource->pMeter ? &levels : nullptr);
+        if (mixed) {
+            pSource->appliedGain = gain;
+            if (pSource->pMeter) pSource->pMeter->Update(levels, kSampleRate);
+            if (pSource->hSpaceEvent) SetEvent(pSource->hSpaceEvent);
+        }
+    }
+
+    return m_pRenderClient->ReleaseBuffer(frames, 0);
+}
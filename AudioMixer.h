@@ -0,0 +1,97 @@
+#pragma once
+
+#include <windows.h>
+#include <audioclient.h>
+#include <mmdeviceapi.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include "AudioLevelMeter.h"
+#include "AudioRing.h"
+
+/**
+ * @brief Input of one instance into the AudioMixer.
+ *
+ * The instance's audio thread writes decoded PCM into the ring; the mixer render thread consumes it and
+ * signals hSpaceEvent once room has been made.
+ */
+struct AudioMixerSource {
+    AudioMixerSource(UINT32 frames, UINT32 channels, HANDLE hEvent, AudioLevelMeter* pLevelMeter)
+        : ring(frames), bufferFrames(frames), inputChannels(channels), hSpaceEvent(hEvent), pMeter(pLevelMeter) {}
+
+    AudioRing ring;
+    const UINT32 bufferFrames;          // Frames the producer keeps queued at most
+    const UINT32 inputChannels;         // Folded to stereo when written to the ring
+    const HANDLE hSpaceEvent;           // Not owned
+    AudioLevelMeter* const pMeter;      // Levels of this input in the mix, not owned (may be null)
+    std::atomic<float> gain{1.0f};
+    float appliedGain = 1.0f;           // Gain the last mixed frame ended at (render thread only)
+    std::atomic<bool> bActive{false};   // Mixed only while playing
+    std::atomic<bool> bDiscard{false};  // Set to drop the queued frames (seek)
+};
+
+/**
+ * @brief Process-wide audio mixer owning a single event-driven WASAPI render stream.
+ *
+ * Instances using the mixer do not open an audio session of their own; their decoded audio is summed with
+ * per-instance gain in a single pass on the mixer thread. Inputs must be at kSampleRate with up to kMaxInputChannels
+ * channels, folded to stereo; the engine converts the float output to the device mix format. The stream follows the
+ * default endpoint: it is reopened when its device is invalidated (unplugged) or another endpoint becomes the default.
+ */
+class AudioMixer {
+public:
+    static constexpr UINT32 kSampleRate = 48000;
+    static constexpr UINT32 kChannels = AudioRing::kChannels;
+    static constexpr UINT32 kMaxInputChannels = 8;
+
+    AudioMixer();
+    ~AudioMixer();
+
+    AudioMixer(const AudioMixer&) = delete;
+    AudioMixer& operator=(const AudioMixer&) = delete;
+
+    /**
+     * @brief Tells whether the mixer can take input in the given format.
+     */
+    static bool IsSupportedFormat(const WAVEFORMATEX* pFormat);
+
+    /**
+     * @brief Creates an input, opening the render stream first if needed.
+     * @param pFormat Input format (see IsSupportedFormat).
+     * @param hSpaceEvent Event signalled when the mixer has consumed input.
+     * @param pMeter Optional, receives the levels of the input after its gain.
+     * @param ppSource Receives the input, owned by the mixer until RemoveSource.
+     * @return S_OK on success, or an error code.
+     */
+    HRESULT AddSource(const WAVEFORMATEX* pFormat, HANDLE hSpaceEvent, AudioLevelMeter* pMeter, AudioMixerSource** ppSource);
+
+    /**
+     * @brief Removes and deletes an input; the render stream is stopped when no input is left.
+     */
+    void RemoveSource(AudioMixerSource* pSource);
+
+private:
+    static DWORD WINAPI RenderThreadProc(LPVOID lpParam);
+    HRESULT OpenStream();
+    void CloseStream();
+    void Render();
+
+    // Called with m_lock held (shared for RenderPass and IsDefaultDeviceChanged)
+    HRESULT OpenClient();
+    void ReleaseClient();
+    HRESULT RenderPass();
+    bool IsDefaultDeviceChanged() const;
+    void RebuildStream();   // Takes m_lock
+
+    IMMDevice* m_pDevice = nullptr;
+    std::wstring m_deviceId;            // Endpoint the stream was opened on
+    IAudioClient* m_pAudioClient = nullptr;
+    IAudioRenderClient* m_pRenderClient = nullptr;
+    UINT32 m_bufferFrames = 0;
+    HANDLE m_hRenderEvent = nullptr;
+    HANDLE m_hThread = nullptr;
+    std::atomic<bool> m_bRunning{false};
+
+    SRWLOCK m_lock = SRWLOCK_INIT;      // Guards m_sources and the client; shared by the render thread
+    std::vector<AudioMixerSource*> m_sources;
+};
@@ -0,0 +1,209 @@
+#include "AudioResampler.h"
+#include "AudioKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// WSOLA segment geometry; longer sequences suit music, shorter ones speech
+constexpr UINT32 kSequenceMs = 40;
+constexpr UINT32 kSeekMs = 15;
+constexpr UINT32 kOverlapMs = 8;
+
+AudioResampler::AudioResampler(UINT32 channels, UINT32 sampleRate)
+    : m_channels(std::max<UINT32>(channels, 1)),
+      m_sequenceFrames(sampleRate * kSequenceMs / 1000),
+      m_seekFrames(sampleRate * kSeekMs / 1000),
+      m_overlapFrames(std::max<UINT32>(sampleRate * kOverlapMs / 1000, 1))
+{
+}
+
+void AudioResampler::SetTempo(double tempo)
+{
+    m_tempo = std::clamp(tempo, kMinTempo, kMaxTempo);
+}
+
+void AudioResampler::SetRateAdjust(double adjust)
+{
+    m_rateStep = 1.0 + std::clamp(adjust, -kMaxRateAdjust, kMaxRateAdjust);
+}
+
+void AudioResampler::Push(const float* pFrames, UINT32 frames)
+{
+    m_input.insert(m_input.end(), pFrames, pFrames + static_cast<size_t>(frames) * m_channels);
+
+    if (m_tempo != 1.0) {
+        Stretch();
+    } else {
+        // No stretch: the input goes straight to the rate stage
+        EndStretch();
+        m_stretched.insert(m_stretched.end(), m_input.begin() + m_inputPos * m_channels, m_input.end());
+        m_input.clear();
+        m_inputPos = 0;
+    }
+}
+
+void AudioResampler::Stretch()
+{
+    const size_t C = m_channels;
+    const UINT32 O = m_overlapFrames;
+    const double nominalSkip = m_tempo * (m_sequenceFrames - O);
+    const size_t required = std::max<size_t>(static_cast<size_t>(std::ceil(nominalSkip)) + O, m_sequenceFrames) + m_seekFrames;
+
+    // Input that EndStretch could not skip yet belongs to the segment already output
+    if (!m_bHaveOverlap && m_overlapEndSkip > 0) {
+        const size_t skip = std::min<size_t>(m_overlapEndSkip, m_input.size() / C - m_inputPos);
+        m_inputPos += skip;
+        m_overlapEndSkip -= static_cast<LONG>(skip);
+    }
+
+    while (m_input.size() / C - m_inputPos >= required) {
+        const float* pIn = m_input.data() + m_inputPos * C;
+        const size_t base = m_stretched.size();
+
+        UINT32 offset = 0;
+        if (m_bHaveOverlap) {
+            // Cross-fade the previous tail into the best matching position of the input
+            offset = SeekBestOverlap(pIn);
+            const float* pSeg = pIn + offset * C;
+            m_stretched.resize(base + O * C);
+            float* pOut = m_stretched.data() + base;
+            for (UINT32 f = 0; f < O; ++f) {
+                const float w = static_cast<float>(f) / static_cast<float>(O);
+                for (size_t c = 0; c < C; ++c)
+                    pOut[f * C + c] = m_overlap[f * C + c] * (1.0f - w) + pSeg[f * C + c] * w;
+            }
+        } else {
+            m_stretched.insert(m_stretched.end(), pIn, pIn + O * C);
+        }
+
+        // Middle of the segment as is, its tail kept for the next cross-fade
+        m_stretched.insert(m_stretched.end(), pIn + (offset + O) * C, pIn + (offset + m_sequenceFrames - O) * C);
+        m_overlap.assign(pIn + (offset + m_sequenceFrames - O) * C, pIn + (offset + m_sequenceFrames) * C);
+        m_bHaveOverlap = true;
+
+        m_skipFraction += nominalSkip;
+        const size_t skip = static_cast<size_t>(m_skipFraction);
+        m_skipFraction -= static_cast<double>(skip);
+        m_overlapEndSkip = static_cast<LONG>(offset + m_sequenceFrames) - static_cast<LONG>(skip);
+        m_inputPos += skip;
+    }
+
+    m_input.erase(m_input.begin(), m_input.begin() + m_inputPos * C);
+    m_inputPos = 0;
+}
+
+void AudioResampler::EndStretch()
+{
+    // Emit the pending tail and resume the input right where it ends
+    if (m_bHaveOverlap) {
+        m_stretched.insert(m_stretched.end(), m_overlap.begin(), m_overlap.end());
+        m_bHaveOverlap = false;
+    }
+    if (m_overlapEndSkip > 0) {
+        const size_t skip = std::min<size_t>(m_overlapEndSkip, m_input.size() / m_channels - m_inputPos);
+        m_inputPos += skip;
+        m_overlapEndSkip -= static_cast<LONG>(skip);
+    }
+    m_skipFraction = 0.0;
+}
+
+UINT32 AudioResampler::SeekBestOverlap(const float* pInput) const
+{
+    const size_t C = m_channels;
+    const size_t samples = static_cast<size_t>(m_overlapFrames) * C;
+
+    // Normalised cross-correlation; the energy of the input window slides with the offset
+    float energy = AudioKernels::DotProduct(pInput, pInput, samples);
+    UINT32 best = 0;
+    float bestScore = -INFINITY;
+    for (UINT32 offset = 0; offset < m_seekFrames; ++offset) {
+        const float* pSeg = pInput + offset * C;
+        const float score = AudioKernels::DotProduct(m_overlap.data(), pSeg, samples) /
+                            std::sqrt(std::max(energy, 1e-9f));
+        if (score > bestScore) {
+            bestScore = score;
+            best = offset;
+        }
+        for (size_t c = 0; c < C; ++c)
+            energy += pSeg[samples + c] * pSeg[samples + c] - pSeg[c] * pSeg[c];
+    }
+    return best;
+}
+
+UINT32 AudioResampler::Pull(float* pFrames, UINT32 maxFrames)
+{
+    const size_t C = m_channels;
+    const size_t available = m_stretched.size() / C - m_stretchedPos;
+    const float* pSrc = m_stretched.data() + m_stretchedPos * C;
+
+    // Interpolation needs the frame after the read position, except when draining
+    const size_t lookahead = m_bDraining ? 0 : 1;
+    UINT32 produced = 0;
+    if (m_rateStep == 1.0 && m_phase == 0.0) {
+        produced = static_cast<UINT32>(std::min<size_t>(maxFrames, available > lookahead ? available - lookahead : 0));
+        memcpy(pFrames, pSrc, produced * C * sizeof(float));
+        m_phase = produced;
+    } else {
+        while (produced < maxFrames) {
+            const size_t i = static_cast<size_t>(m_phase);
+            float* pOut = pFrames + produced * C;
+            if (i + 1 < available) {
+                const float frac = static_cast<float>(m_phase - static_cast<double>(i));
+                for (size_t c = 0; c < C; ++c)
+                    pOut[c] = pSrc[i * C + c] + (pSrc[(i + 1) * C + c] - pSrc[i * C + c]) * frac;
+            } else if (m_bDraining && i < available) {
+                memcpy(pOut, pSrc + i * C, C * sizeof(float));
+            } else {
+                break;
+            }
+            m_phase += m_rateStep;
+            ++produced;
+        }
+    }
+
+    const size_t consumed = std::min(static_cast<size_t>(m_phase), available);
+    m_stretchedPos += consumed;
+    m_phase -= static_cast<double>(consumed);
+    if (m_stretchedPos * 2 * C > m_stretched.size()) {
+        m_stretched.erase(m_stretched.begin(), m_stretched.begin() + m_stretchedPos * C);
+        m_stretchedPos = 0;
+    }
+    return produced;
+}
+
+void AudioResampler::Drain()
+{
+    EndStretch();
+    m_stretched.insert(m_stretched.end(), m_input.begin() + m_inputPos * m_channels, m_input.end());
+    m_input.clear();
+    m_inputPos = 0;
+    m_bDraining = true;
+}
+
+void AudioResampler::Reset()
+{
+    m_input.clear();
+    m_inputPos = 0;
+    m_skipFraction = 0.0;
+    m_overlap.clear();
+    m_bHaveOverlap = false;
+    m_overlapEndSkip = 0;
+    m_stretched.clear();
+    m_stretchedPos = 0;
+    m_phase = 0.0;
+    m_bDraining = false;
+}
+
+bool AudioResampler::HasPending() const
+{
+    return m_input.size() > m_inputPos * m_channels || m_bHaveOverlap ||
+           m_stretched.size() > m_stretchedPos * m_channels;
+}
+
+double AudioResampler::PendingInputFrames() const
+{
+    const double input = static_cast<double>(m_input.size() / m_channels - m_inputPos);
+    const double overlap = m_bHaveOverlap ? m_overlapFrames : 0.0;
+    const double stretched = static_cast<double>(m_stretched.size() / m_channels - m_stretchedPos) - m_phase;
+    return input + (overlap + std::max(stretched, 0.0)) * m_tempo;
+}
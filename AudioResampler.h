@@ -0,0 +1,95 @@
+#pragma once
+
+#include <windows.h>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Streaming time-stretch and rate-adjust stage between the decoder and the render buffer.
+ *
+ * Two stages run on interleaved float frames:
+ *  - WSOLA time-stretch: changes the tempo (0.5x to 2x) without changing the pitch, by overlapping
+ *    input segments at the offset that best matches the previous output;
+ *  - rate adjust: linear resampling by at most kMaxRateAdjust, used to absorb clock drift continuously
+ *    (a 0.5 % pitch change is inaudible).
+ * Used by a single thread; Push input, then Pull output until it returns 0.
+ */
+class AudioResampler {
+public:
+    static constexpr double kMinTempo = 0.5;
+    static constexpr double kMaxTempo = 2.0;
+    static constexpr double kMaxRateAdjust = 0.005;
+
+    AudioResampler(UINT32 channels, UINT32 sampleRate);
+
+    AudioResampler(const AudioResampler&) = delete;
+    AudioResampler& operator=(const AudioResampler&) = delete;
+
+    /**
+     * @brief Sets the tempo (media time per output time), clamped to [kMinTempo, kMaxTempo]; 1 disables the stretch.
+     */
+    void SetTempo(double tempo);
+    double Tempo() const { return m_tempo; }
+
+    /**
+     * @brief Sets the rate adjustment, clamped to ±kMaxRateAdjust; positive values consume input faster.
+     */
+    void SetRateAdjust(double adjust);
+
+    /**
+     * @brief Appends input frames.
+     */
+    void Push(const float* pFrames, UINT32 frames);
+
+    /**
+     * @brief Retrieves up to maxFrames output frames.
+     * @return Number of frames written to pFrames.
+     */
+    UINT32 Pull(float* pFrames, UINT32 maxFrames);
+
+    /**
+     * @brief Makes every pending frame available to Pull without waiting for more input (end of a stretch).
+     */
+    void Drain();
+
+    /**
+     * @brief Drops every pending frame (seek).
+     */
+    void Reset();
+
+    bool HasPending() const;
+
+    /**
+     * @brief Input frames pushed but not output yet, in media time (input frames).
+     */
+    double PendingInputFrames() const;
+
+private:
+    void Stretch();
+    void EndStretch();
+    UINT32 SeekBestOverlap(const float* pInput) const;
+
+    const UINT32 m_channels;
+    const UINT32 m_sequenceFrames;   // Length of the segments copied from the input
+    const UINT32 m_seekFrames;       // Offsets searched for the best overlap
+    const UINT32 m_overlapFrames;    // Cross-fade between consecutive segments
+
+    double m_tempo = 1.0;
+    double m_rateStep = 1.0;         // Stretched frames consumed per output frame
+
+    // Input not yet stretched
+    std::vector<float> m_input;
+    size_t m_inputPos = 0;           // In frames
+    double m_skipFraction = 0.0;
+
+    // Tail of the last segment, cross-faded into the next one
+    std::vector<float> m_overlap;
+    bool m_bHaveOverlap = false;
+    LONG m_overlapEndSkip = 0;       // Input frames to skip after the overlap when the stretch ends
+
+    // Stretched frames waiting for the rate stage
+    std::vector<float> m_stretched;
+    size_t m_stretchedPos = 0;       // In frames
+    double m_phase = 0.0;            // Fractional read position past m_stretchedPos
+    bool m_bDraining = false;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <windows.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include "AudioKernels.h"
+
+/**
+ * @brief Bounded lock-free ring of interleaved stereo float frames with one producer and one consumer.
+ *
+ * The producer (an instance's audio thread) only calls Write; the consumer (the mixer
+ * render thread) only calls MixInto and Discard. The capacity is rounded up to a power of two so the
+ * free-running indices stay valid when they wrap.
+ */
+class AudioRing {
+public:
+    static constexpr UINT32 kChannels = 2;
+
+    explicit AudioRing(UINT32 capacityFrames)
+        : m_capacity(RoundUpToPowerOfTwo(capacityFrames)), m_samples(new float[m_capacity * kChannels]()) {}
+
+    AudioRing(const AudioRing&) = delete;
+    AudioRing& operator=(const AudioRing&) = delete;
+
+    UINT32 Capacity() const { return m_capacity; }
+
+    UINT32 Size() const {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+    UINT32 Free() const { return m_capacity - Size(); }
+
+    /**
+     * @brief Appends interleaved frames of any channel count, converted to stereo float.
+     * @param srcChannels Channel count of pSrc (see AudioKernels::ToStereoFloat).
+     * @return Number of frames written (less than requested if the ring is full).
+     */
+    UINT32 Write(const void* pSrc, UINT32 frames, AudioKernels::SampleFormat format, UINT32 srcChannels) {
+        const size_t srcFrameBytes = static_cast<size_t>(srcChannels) *
+                                     (format == AudioKernels::SampleFormat::Float32 ? sizeof(float) : sizeof(int16_t));
+        const UINT32 tail = m_tail.load(std::memory_order_relaxed);
+        const UINT32 count = std::min(frames, m_capacity - (tail - m_head.load(std::memory_order_acquire)));
+        const UINT32 start = tail % m_capacity;
+        const UINT32 firstSpan = std::min(count, m_capacity - start);
+        AudioKernels::ToStereoFloat(m_samples.get() + static_cast<size_t>(start) * kChannels, pSrc, format, srcChannels, firstSpan);
+        AudioKernels::ToStereoFloat(m_samples.get(), static_cast<const BYTE*>(pSrc) + firstSpan * srcFrameBytes, format,
+                                    srcChannels, count - firstSpan);
+        m_tail.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    /**
+     * @brief Consumes up to frames frames, adding them to pDst with a gain ramped from gainStart to gainEnd.
+     * @param pLevels Optional, accumulates the levels of the consumed frames after the gain.
+     * @return Number of frames consumed.
+     */
+    UINT32 MixInto(float* pDst, UINT32 frames, float gainStart, float gainEnd, AudioKernels::Levels* pLevels = nullptr) {
+        const UINT32 head = m_head.load(std::memory_order_relaxed);
+        const UINT32 count = std::min(frames, m_tail.load(std::memory_order_acquire) - head);
+        if (count == 0) return 0;
+        const UINT32 start = head % m_capacity;
+        const UINT32 firstSpan = std::min(count, m_capacity - start);
+        const float gainSplit = gainStart + (gainEnd - gainStart) * static_cast<float>(firstSpan) / static_cast<float>(count);
+        AudioKernels::AccumulateWithGain(pDst, m_samples.get() + static_cast<size_t>(start) * kChannels,
+                                         static_cast<size_t>(firstSpan) * kChannels, gainStart, gainSplit, pLevels);
+        AudioKernels::AccumulateWithGain(pDst + static_cast<size_t>(firstSpan) * kChannels, m_samples.get(),
+                                         static_cast<size_t>(count - firstSpan) * kChannels, gainSplit, gainEnd, pLevels);
+        m_head.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    /**
+     * @brief Drops every queued frame.
+     */
+    void Discard() {
+        m_head.store(m_tail.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+private:
+    static UINT32 RoundUpToPowerOfTwo(UINT32 value) {
+        UINT32 capacity = 1;
+        while (capacity < value && capacity < 0x80000000u)
+            capacity <<= 1;
+        return capacity;
+    }
+
+    const UINT32 m_capacity;
+    std::unique_ptr<float[]> m_samples;
+    std::atomic<UINT32> m_head{0};
+    std::atomic<UINT32> m_tail{0};
+};
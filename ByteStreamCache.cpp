@@ -0,0 +1,546 @@
+#include "ByteStreamCache.h"
+#include "NativeVideoPlayer.h"
+#include <mfapi.h>
+#include <mferror.h>
+#include <algorithm>
+#include <list>
+
+// Blocks the memory ring holds at least, so that read-ahead never evicts the blocks being read
+constexpr size_t kMinBlocks = 4;
+
+// Longest wait for a block before checking whether the cache is being destroyed
+constexpr DWORD kBlockWaitMs = 100;
+
+// ---------------------------------------------------------------------------------------------------------------
+// On-disk segment cache: one file per block, "<content key>-<block>.seg", deleted least recently used first.
+// ---------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+class SegmentStore {
+public:
+    HRESULT Configure(const wchar_t* directory, UINT64 maxBytes)
+    {
+        AcquireSRWLockExclusive(&m_lock);
+        m_directory.clear();
+        m_entries.clear();
+        m_entryOfName.clear();
+        m_totalBytes = 0;
+        m_maxBytes = maxBytes;
+
+        HRESULT hr = S_OK;
+        if (directory && *directory) {
+            const DWORD attributes = GetFileAttributesW(directory);
+            if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY)) {
+                hr = HRESULT_FROM_WIN32(ERROR_PATH_NOT_FOUND);
+            } else {
+                m_directory = directory;
+                if (m_directory.back() != L'\\' && m_directory.back() != L'/')
+                    m_directory += L'\\';
+                LoadExistingSegments();
+                Trim();
+            }
+        }
+        ReleaseSRWLockExclusive(&m_lock);
+        return hr;
+    }
+
+    bool IsEnabled()
+    {
+        AcquireSRWLockShared(&m_lock);
+        const bool bEnabled = !m_directory.empty();
+        ReleaseSRWLockShared(&m_lock);
+        return bEnabled;
+    }
+
+    bool Load(const std::wstring& key, INT64 block, BYTE* pBuffer, DWORD cb, DWORD* pcbRead)
+    {
+        AcquireSRWLockExclusive(&m_lock);
+        const std::wstring name = SegmentName(key, block);
+        auto it = m_entryOfName.find(name);
+        if (it == m_entryOfName.end()) {
+            ReleaseSRWLockExclusive(&m_lock);
+            return false;
+        }
+        m_entries.splice(m_entries.end(), m_entries, it->second);
+        const std::wstring path = m_directory + name;
+        ReleaseSRWLockExclusive(&m_lock);
+
+        HANDLE hFile = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                                   OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (hFile == INVALID_HANDLE_VALUE)
+            return false;
+        DWORD cbRead = 0;
+        const BOOL bRead = ReadFile(hFile, pBuffer, cb, &cbRead, nullptr);
+        CloseHandle(hFile);
+        if (!bRead)
+            return false;
+        *pcbRead = cbRead;
+        return true;
+    }
+
+    void Store(const std::wstring& key, INT64 block, const BYTE* pData, DWORD cb)
+    {
+        AcquireSRWLockShared(&m_lock);
+        const std::wstring name = SegmentName(key, block);
+        const std::wstring path = m_directory + name;
+        const bool bSkip = m_directory.empty() || cb > m_maxBytes || m_entryOfName.count(name);
+        ReleaseSRWLockShared(&m_lock);
+        if (bSkip)
+            return;
+
+        // Written under a temporary name so that a segment cut short by a crash is never read
+        const std::wstring tempPath = path + L".tmp";
+        HANDLE hFile = CreateFileW(tempPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (hFile == INVALID_HANDLE_VALUE)
+            return;
+        DWORD cbWritten = 0;
+        const BOOL bWritten = WriteFile(hFile, pData, cb, &cbWritten, nullptr) && cbWritten == cb;
+        CloseHandle(hFile);
+        if (!bWritten || !MoveFileExW(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+            DeleteFileW(tempPath.c_str());
+            return;
+        }
+
+        AcquireSRWLockExclusive(&m_lock);
+        if (!m_entryOfName.count(name)) {
+            m_entries.push_back({ name, cb });
+            m_entryOfName[name] = std::prev(m_entries.end());
+            m_totalBytes += cb;
+            Trim();
+        }
+        ReleaseSRWLockExclusive(&m_lock);
+    }
+
+private:
+    struct Entry {
+        std::wstring name;
+        UINT64 size;
+    };
+
+    static std::wstring SegmentName(const std::wstring& key, INT64 block)
+    {
+        wchar_t suffix[32];
+        swprintf_s(suffix, L"-%lld.seg", block);
+        return key + suffix;
+    }
+
+    // Oldest segments first, so that the ones written last are kept when trimming. Caller holds the lock.
+    void LoadExistingSegments()
+    {
+        struct Found {
+            Entry entry;
+            FILETIME lastWrite;
+        };
+        std::vector<Found> found;
+        WIN32_FIND_DATAW data;
+        HANDLE hFind = FindFirstFileW((m_directory + L"*.seg").c_str(), &data);
+        if (hFind == INVALID_HANDLE_VALUE)
+            return;
+        do {
+            if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+                const UINT64 size = (static_cast<UINT64>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+                found.push_back({ { data.cFileName, size }, data.ftLastWriteTime });
+            }
+        } while (FindNextFileW(hFind, &data));
+        FindClose(hFind);
+
+        std::sort(found.begin(), found.end(), [](const Found& a, const Found& b) {
+            return CompareFileTime(&a.lastWrite, &b.lastWrite) < 0;
+        });
+        for (const Found& f : found) {
+            m_entries.push_back(f.entry);
+            m_entryOfName[f.entry.name] = std::prev(m_entries.end());
+            m_totalBytes += f.entry.size;
+        }
+    }
+
+    // Caller holds the lock
+    void Trim()
+    {
+        while (m_totalBytes > m_maxBytes && !m_entries.empty()) {
+            const Entry& oldest = m_entries.front();
+            DeleteFileW((m_directory + oldest.name).c_str());
+            m_totalBytes -= oldest.size;
+            m_entryOfName.erase(oldest.name);
+            m_entries.pop_front();
+        }
+    }
+
+    SRWLOCK m_lock = SRWLOCK_INIT;
+    std::wstring m_directory;           // Empty while disabled
+    UINT64 m_maxBytes = 0;
+    UINT64 m_totalBytes = 0;
+    std::list<Entry> m_entries;         // Least recently used first
+    std::unordered_map<std::wstring, std::list<Entry>::iterator> m_entryOfName;
+};
+
+SegmentStore g_segmentStore;
+
+// FNV-1a of the URL and length, so that content changed at the same URL is not served from the disk
+std::wstring MakeContentKey(const wchar_t* url, QWORD length)
+{
+    UINT64 hash = 0xcbf29ce484222325ULL;
+    auto mix = [&hash](const void* pData, size_t cb) {
+        const auto* p = static_cast<const BYTE*>(pData);
+        for (size_t i = 0; i < cb; ++i) {
+            hash ^= p[i];
+            hash *= 0x100000001b3ULL;
+        }
+    };
+    mix(url, wcslen(url) * sizeof(wchar_t));
+    mix(&length, sizeof(length));
+
+    wchar_t key[17];
+    swprintf_s(key, L"%016llx", hash);
+    return key;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------------------------------------------
+// ByteStreamCache
+// ---------------------------------------------------------------------------------------------------------------
+
+HRESULT ByteStreamCache::Create(IMFByteStream* pUpstream, const std::wstring& key, const std::wstring& originName,
+                                UINT32 memoryBytes, UINT32 readAheadBytes, ByteStreamCache** ppCache)
+{
+    if (!pUpstream || !ppCache)
+        return E_POINTER;
+    *ppCache = nullptr;
+
+    auto* pCache = new (std::nothrow) ByteStreamCache(pUpstream, key, originName, memoryBytes, readAheadBytes);
+    if (!pCache)
+        return E_OUTOFMEMORY;
+    HRESULT hr = pCache->Initialize();
+    if (FAILED(hr)) {
+        pCache->Release();
+        return hr;
+    }
+    *ppCache = pCache;
+    return S_OK;
+}
+
+HRESULT ByteStreamCache::CreateFromUrl(const wchar_t* url, UINT32 memoryBytes, UINT32 readAheadBytes,
+                                       ByteStreamCache** ppCache)
+{
+    if (!url || !ppCache)
+        return E_POINTER;
+    *ppCache = nullptr;
+
+    IMFSourceResolver* pResolver = nullptr;
+    HRESULT hr = MFCreateSourceResolver(&pResolver);
+    if (FAILED(hr))
+        return hr;
+    MF_OBJECT_TYPE objectType = MF_OBJECT_INVALID;
+    IUnknown* pObject = nullptr;
+    hr = pResolver->CreateObjectFromURL(url, MF_RESOLUTION_BYTESTREAM | MF_RESOLUTION_READ, nullptr,
+                                        &objectType, &pObject);
+    pResolver->Release();
+    if (FAILED(hr))
+        return hr;
+
+    IMFByteStream* pUpstream = nullptr;
+    hr = pObject->QueryInterface(IID_PPV_ARGS(&pUpstream));
+    pObject->Release();
+    if (FAILED(hr))
+        return hr;
+
+    // Only content of known length can be matched against the disk cache
+    QWORD length = static_cast<QWORD>(-1);
+    std::wstring key;
+    if (SUCCEEDED(pUpstream->GetLength(&length)) && length != static_cast<QWORD>(-1) && g_segmentStore.IsEnabled())
+        key = MakeContentKey(url, length);
+
+    hr = Create(pUpstream, key, url, memoryBytes, readAheadBytes, ppCache);
+    pUpstream->Release();
+    return hr;
+}
+
+HRESULT ByteStreamCache::ConfigureDiskCache(const wchar_t* directory, UINT64 maxBytes)
+{
+    return g_segmentStore.Configure(directory, maxBytes);
+}
+
+ByteStreamCache::ByteStreamCache(IMFByteStream* pUpstream, const std::wstring& key, const std::wstring& originName,
+                                 UINT32 memoryBytes, UINT32 readAheadBytes)
+    : SharedByteSource(originName), m_pUpstream(pUpstream), m_key(key)
+{
+    m_pUpstream->AddRef();
+    const size_t blockCount = std::max<size_t>(kMinBlocks, (static_cast<size_t>(memoryBytes) + kBlockSize - 1) / kBlockSize);
+    m_blocks.resize(blockCount);
+    m_readAheadBlocks = std::min<INT64>((readAheadBytes + kBlockSize - 1) / kBlockSize, blockCount / 2);
+}
+
+ByteStreamCache::~ByteStreamCache()
+{
+    // Closing the upstream stream cancels a read blocked on the network, so the join below cannot stall
+    InterlockedExchange(&m_bStopping, TRUE);
+    m_pUpstream->Close();
+    WakeAllConditionVariable(&m_blockChanged);
+    if (m_hReadAheadThread) {
+        SetEvent(m_hReadAheadEvent);
+        WaitForSingleObject(m_hReadAheadThread, INFINITE);
+        CloseHandle(m_hReadAheadThread);
+    }
+    if (m_hReadAheadEvent) CloseHandle(m_hReadAheadEvent);
+    if (m_pUpstreamAttributes) m_pUpstreamAttributes->Release();
+    m_pUpstream->Release();
+}
+
+HRESULT ByteStreamCache::Initialize()
+{
+    HRESULT hr = m_pUpstream->GetCapabilities(&m_capabilities);
+    if (FAILED(hr))
+        return hr;
+    if (!(m_capabilities & MFBYTESTREAM_IS_READABLE))
+        return MF_E_UNSUPPORTED_BYTESTREAM_TYPE;
+
+    QWORD length = static_cast<QWORD>(-1);
+    if (SUCCEEDED(m_pUpstream->GetLength(&length)))
+        m_length.store(length, std::memory_order_release);
+    m_pUpstream->GetCurrentPosition(&m_upstreamPosition);
+    m_pUpstream->QueryInterface(IID_PPV_ARGS(&m_pUpstreamAttributes));
+
+    if (m_readAheadBlocks > 0) {
+        m_hReadAheadEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        if (!m_hReadAheadEvent)
+            return HRESULT_FROM_WIN32(GetLastError());
+        m_hReadAheadThread = CreateThread(nullptr, 0, ReadAheadThreadProc, this, 0, nullptr);
+        if (!m_hReadAheadThread)
+            return HRESULT_FROM_WIN32(GetLastError());
+    }
+    return S_OK;
+}
+
+void ByteStreamCache::CopyAttributes(IMFAttributes* pDest) const
+{
+    if (m_pUpstreamAttributes)
+        m_pUpstreamAttributes->CopyAllItems(pDest);
+}
+
+HRESULT ByteStreamCache::Read(QWORD offset, BYTE* pBuffer, ULONG cb, ULONG* pcbRead)
+{
+    *pcbRead = 0;
+    HRESULT hr = S_OK;
+    INT64 lastBlock = -1;
+    while (*pcbRead < cb) {
+        const QWORD position = offset + *pcbRead;
+        const QWORD length = GetLength();
+        if (length != static_cast<QWORD>(-1) && position >= length)
+            break;
+
+        const INT64 index = static_cast<INT64>(position / kBlockSize);
+        Block* pBlock = nullptr;
+        hr = AcquireBlock(index, &pBlock);
+        if (FAILED(hr))
+            break;
+        const DWORD inBlock = static_cast<DWORD>(position % kBlockSize);
+        const DWORD available = pBlock->size > inBlock ? pBlock->size - inBlock : 0;
+        const DWORD toCopy = std::min<DWORD>(available, cb - *pcbRead);
+        memcpy(pBuffer + *pcbRead, pBlock->data.data() + inBlock, toCopy);
+        UnpinBlock(pBlock);
+        *pcbRead += toCopy;
+        lastBlock = index;
+        if (available < kBlockSize - inBlock)
+            break;      // Short block: end of stream
+    }
+
+    m_bytesRead += *pcbRead;
+    if (lastBlock >= 0)
+        ScheduleReadAhead(lastBlock + 1);
+    // Data already copied is returned; the error comes back with the next read
+    return *pcbRead ? S_OK : hr;
+}
+
+void ByteStreamCache::GetStats(StreamCacheStats* pStats) const
+{
+    pStats->bytesRead = m_bytesRead.load(std::memory_order_relaxed);
+    pStats->bytesFetched = m_bytesFetched.load(std::memory_order_relaxed);
+    pStats->bytesFromDisk = m_bytesFromDisk.load(std::memory_order_relaxed);
+}
+
+HRESULT ByteStreamCache::AcquireBlock(INT64 index, Block** ppBlock)
+{
+    AcquireSRWLockExclusive(&m_lock);
+    for (;;) {
+        auto it = m_slotOfBlock.find(index);
+        if (it != m_slotOfBlock.end()) {
+            Block& block = m_blocks[it->second];
+            if (block.state == Block::State::Ready) {
+                ++block.pins;
+                block.lastUse = ++m_useClock;
+                ReleaseSRWLockExclusive(&m_lock);
+                *ppBlock = &block;
+                return S_OK;
+            }
+            // Being loaded by another reader or the read-ahead thread
+            if (!WaitForBlockChange())
+                return MF_E_SHUTDOWN;
+            continue;
+        }
+
+        Block* pSlot = FindEvictableSlot();
+        if (!pSlot) {
+            // Every slot is being loaded or copied out of
+            if (!WaitForBlockChange())
+                return MF_E_SHUTDOWN;
+            continue;
+        }
+        if (pSlot->index >= 0)
+            m_slotOfBlock.erase(pSlot->index);
+        pSlot->index = index;
+        pSlot->state = Block::State::Loading;
+        pSlot->pins = 1;
+        m_slotOfBlock[index] = static_cast<size_t>(pSlot - m_blocks.data());
+        ReleaseSRWLockExclusive(&m_lock);
+
+        // The slot is owned by this thread while loading: no lock around the I/O
+        HRESULT hr = LoadBlock(index, pSlot);
+
+        AcquireSRWLockExclusive(&m_lock);
+        if (SUCCEEDED(hr)) {
+            pSlot->state = Block::State::Ready;
+            pSlot->lastUse = ++m_useClock;
+        } else {
+            m_slotOfBlock.erase(index);
+            pSlot->index = -1;
+            pSlot->state = Block::State::Empty;
+            pSlot->pins = 0;
+        }
+        ReleaseSRWLockExclusive(&m_lock);
+        WakeAllConditionVariable(&m_blockChanged);
+        if (FAILED(hr))
+            return hr;
+        *ppBlock = pSlot;
+        return S_OK;
+    }
+}
+
+bool ByteStreamCache::WaitForBlockChange()
+{
+    SleepConditionVariableSRW(&m_blockChanged, &m_lock, kBlockWaitMs, 0);
+    if (!m_bStopping)
+        return true;
+    ReleaseSRWLockExclusive(&m_lock);
+    return false;
+}
+
+void ByteStreamCache::UnpinBlock(Block* pBlock)
+{
+    AcquireSRWLockExclusive(&m_lock);
+    const bool bFreed = --pBlock->pins == 0;
+    ReleaseSRWLockExclusive(&m_lock);
+    if (bFreed)
+        WakeAllConditionVariable(&m_blockChanged);
+}
+
+ByteStreamCache::Block* ByteStreamCache::FindEvictableSlot()
+{
+    Block* pOldest = nullptr;
+    for (Block& block : m_blocks) {
+        if (block.state == Block::State::Empty)
+            return &block;
+        if (block.state == Block::State::Ready && !block.pins && (!pOldest || block.lastUse < pOldest->lastUse))
+            pOldest = &block;
+    }
+    return pOldest;
+}
+
+HRESULT ByteStreamCache::LoadBlock(INT64 index, Block* pBlock)
+{
+    if (pBlock->data.size() < kBlockSize)
+        pBlock->data.resize(kBlockSize);
+
+    const QWORD offset = static_cast<QWORD>(index) * kBlockSize;
+    DWORD cbExpected = kBlockSize;
+    const QWORD length = GetLength();
+    if (length != static_cast<QWORD>(-1))
+        cbExpected = offset < length ? static_cast<DWORD>(std::min<QWORD>(kBlockSize, length - offset)) : 0;
+
+    // Segments on disk are complete blocks, or the tail of the stream
+    DWORD cbRead = 0;
+    if (!m_key.empty() && cbExpected && g_segmentStore.Load(m_key, index, pBlock->data.data(), kBlockSize, &cbRead)
+        && cbRead == cbExpected) {
+        pBlock->size = cbRead;
+        m_bytesFromDisk += cbRead;
+        return S_OK;
+    }
+
+    cbRead = 0;
+    HRESULT hr = cbExpected ? FetchUpstream(offset, pBlock->data.data(), cbExpected, &cbRead) : S_OK;
+    if (FAILED(hr))
+        return hr;
+    pBlock->size = cbRead;
+    m_bytesFetched += cbRead;
+
+    if (cbRead < cbExpected || (length == static_cast<QWORD>(-1) && cbRead < kBlockSize))
+        m_length.store(offset + cbRead, std::memory_order_release);
+    else if (!m_key.empty())
+        g_segmentStore.Store(m_key, index, pBlock->data.data(), cbRead);
+    return S_OK;
+}
+
+HRESULT ByteStreamCache::FetchUpstream(QWORD offset, BYTE* pBuffer, DWORD cb, DWORD* pcbRead)
+{
+    AcquireSRWLockExclusive(&m_upstreamLock);
+    HRESULT hr = m_bStopping ? MF_E_SHUTDOWN : S_OK;
+    if (SUCCEEDED(hr) && m_upstreamPosition != offset) {
+        hr = m_pUpstream->SetCurrentPosition(offset);
+        if (SUCCEEDED(hr))
+            m_upstreamPosition = offset;
+    }
+    *pcbRead = 0;
+    while (SUCCEEDED(hr) && *pcbRead < cb) {
+        if (m_bStopping) {
+            hr = MF_E_SHUTDOWN;
+            break;
+        }
+        ULONG cbChunk = 0;
+        hr = m_pUpstream->Read(pBuffer + *pcbRead, cb - *pcbRead, &cbChunk);
+        if (SUCCEEDED(hr)) {
+            *pcbRead += cbChunk;
+            m_upstreamPosition += cbChunk;
+            if (!cbChunk)
+                break;
+        }
+    }
+    ReleaseSRWLockExclusive(&m_upstreamLock);
+    return hr;
+}
+
+void ByteStreamCache::ScheduleReadAhead(INT64 nextBlock)
+{
+    // Most reads stay within the block of the previous one
+    if (!m_hReadAheadThread || m_scheduledFrom.exchange(nextBlock, std::memory_order_acq_rel) == nextBlock)
+        return;
+    m_readAheadFrom.store(nextBlock, std::memory_order_release);
+    SetEvent(m_hReadAheadEvent);
+}
+
+DWORD WINAPI ByteStreamCache::ReadAheadThreadProc(LPVOID lpParam)
+{
+    static_cast<ByteStreamCache*>(lpParam)->ReadAheadLoop();
+    return 0;
+}
+
+void ByteStreamCache::ReadAheadLoop()
+{
+    while (WaitForSingleObject(m_hReadAheadEvent, INFINITE) == WAIT_OBJECT_0 && !m_bStopping) {
+        const INT64 first = m_readAheadFrom.exchange(-1, std::memory_order_acq_rel);
+        if (first < 0)
+            continue;
+        for (INT64 index = first; index < first + m_readAheadBlocks && !m_bStopping; ++index) {
+            // A read elsewhere moves the window: start over from there
+            if (m_readAheadFrom.load(std::memory_order_acquire) >= 0)
+                break;
+            const QWORD length = GetLength();
+            if (length != static_cast<QWORD>(-1) && static_cast<QWORD>(index) * kBlockSize >= length)
+                break;
+            Block* pBlock = nullptr;
+            if (FAILED(AcquireBlock(index, &pBlock)))
+                break;
+            UnpinBlock(pBlock);
+        }
+    }
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <windows.h>
+#include <mfidl.h>
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "SharedByteSource.h"
+
+/**
+ * @brief Read-ahead block cache over the byte stream of one media, shared by all the readers opened on it.
+ *
+ * The upstream stream (network, or provided by the application) is read in kBlockSize blocks into a memory ring;
+ * a background thread keeps the blocks after the last read loaded. Blocks of media opened from a URL can also be kept in an
+ * on-disk segment cache shared by all instances (see ConfigureDiskCache), so that replays do not fetch them again.
+ * Thread safe.
+ */
+class ByteStreamCache : public SharedByteSource {
+public:
+    static constexpr DWORD kBlockSize = 256 * 1024;
+    static constexpr UINT32 kDefaultMemoryBytes = 32 * 1024 * 1024;
+    static constexpr UINT32 kDefaultReadAheadBytes = 8 * 1024 * 1024;
+
+    /**
+     * @brief Creates a cache over a byte stream.
+     * @param pUpstream Readable stream (referenced); only this cache should read from it afterwards, and it is
+     *        closed when the cache is destroyed.
+     * @param key Identifies the content in the disk cache, empty to keep it out of the disk cache.
+     * @param originName URL or file name reported to the source resolver to pick the container handler, or empty.
+     * @param memoryBytes Memory ring size, rounded up to a minimum of four blocks.
+     * @param readAheadBytes Bytes loaded ahead of the last read, at most half the ring.
+     * @param ppCache Receives the cache with one reference.
+     * @return S_OK on success, or an error code.
+     */
+    static HRESULT Create(IMFByteStream* pUpstream, const std::wstring& key, const std::wstring& originName,
+                          UINT32 memoryBytes, UINT32 readAheadBytes, ByteStreamCache** ppCache);
+
+    /**
+     * @brief Resolves a URL to a byte stream and creates a cache over it, keyed on the URL.
+     */
+    static HRESULT CreateFromUrl(const wchar_t* url, UINT32 memoryBytes, UINT32 readAheadBytes, ByteStreamCache** ppCache);
+
+    /**
+     * @brief Sets the on-disk segment cache used by caches created from a URL afterwards.
+     * @param directory Existing directory for the segment files, or nullptr to disable the disk cache.
+     * @param maxBytes Size cap; the least recently used segments are deleted beyond it.
+     * @return S_OK on success, or an error code.
+     */
+    static HRESULT ConfigureDiskCache(const wchar_t* directory, UINT64 maxBytes);
+
+    /**
+     * @brief Copies bytes at an offset, loading the blocks that are not cached yet.
+     * @param pcbRead Receives the number of bytes copied, short at the end of the stream.
+     * @return S_OK on success, MF_E_SHUTDOWN once the cache is being destroyed, or the upstream error.
+     */
+    HRESULT Read(QWORD offset, BYTE* pBuffer, ULONG cb, ULONG* pcbRead) override;
+
+    DWORD GetCapabilities() const override { return m_capabilities; }
+    QWORD GetLength() const override { return m_length.load(std::memory_order_acquire); }
+    void GetStats(StreamCacheStats* pStats) const override;
+
+protected:
+    void CopyAttributes(IMFAttributes* pDest) const override;
+
+private:
+    struct Block {
+        INT64 index = -1;           // Block number, -1 while the slot is free
+        enum class State { Empty, Loading, Ready } state = State::Empty;
+        UINT32 pins = 0;            // Readers copying out of the slot
+        UINT64 lastUse = 0;
+        DWORD size = 0;             // Short for the last block of the stream
+        std::vector<BYTE> data;
+    };
+
+    ByteStreamCache(IMFByteStream* pUpstream, const std::wstring& key, const std::wstring& originName,
+                    UINT32 memoryBytes, UINT32 readAheadBytes);
+    ~ByteStreamCache() override;
+
+    HRESULT Initialize();
+    HRESULT AcquireBlock(INT64 index, Block** ppBlock);
+    bool WaitForBlockChange();     // With m_lock held; false (and the lock released) once stopping
+    void UnpinBlock(Block* pBlock);
+    Block* FindEvictableSlot();
+    HRESULT LoadBlock(INT64 index, Block* pBlock);
+    HRESULT FetchUpstream(QWORD offset, BYTE* pBuffer, DWORD cb, DWORD* pcbRead);
+    void ScheduleReadAhead(INT64 nextBlock);
+
+    static DWORD WINAPI ReadAheadThreadProc(LPVOID lpParam);
+    void ReadAheadLoop();
+
+    IMFByteStream* m_pUpstream = nullptr;
+    IMFAttributes* m_pUpstreamAttributes = nullptr;
+    std::wstring m_key;
+    DWORD m_capabilities = 0;
+    std::atomic<QWORD> m_length{static_cast<QWORD>(-1)};
+
+    // Memory ring, under m_lock; loads signal m_blockChanged
+    SRWLOCK m_lock = SRWLOCK_INIT;
+    CONDITION_VARIABLE m_blockChanged = CONDITION_VARIABLE_INIT;
+    std::vector<Block> m_blocks;
+    std::unordered_map<INT64, size_t> m_slotOfBlock;
+    UINT64 m_useClock = 0;
+
+    // Upstream reads are serialised (the stream has a single position)
+    SRWLOCK m_upstreamLock = SRWLOCK_INIT;
+    QWORD m_upstreamPosition = 0;
+
+    // Read-ahead thread
+    HANDLE m_hReadAheadThread = nullptr;
+    HANDLE m_hReadAheadEvent = nullptr;
+    volatile LONG m_bStopping = FALSE;
+    std::atomic<INT64> m_readAheadFrom{-1};     // Window requested and not picked up yet
+    std::atomic<INT64> m_scheduledFrom{-1};     // Last window requested
+    INT64 m_readAheadBlocks = 0;
+
+    std::atomic<UINT64> m_bytesRead{0};
+    std::atomic<UINT64> m_bytesFetched{0};
+    std::atomic<UINT64> m_bytesFromDisk{0};
+};
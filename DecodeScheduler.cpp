@@ -0,0 +1,284 @@
+#include "DecodeScheduler.h"
+#include "PlayerMetrics.h"
+#include <mfapi.h>
+#include <algorithm>
+#include <climits>
+
+// Upper bound on the worker pool, whatever the core count
+constexpr UINT32   kMaxWorkers = 16;
+// Low-priority jobs are treated as if their next frame were due this much later (100-ns)
+constexpr LONGLONG kLowPriorityBias = 50 * 10000;
+constexpr DWORD    kStopTimeoutMs = 2000;
+
+// ---------------------------------------------------------------------------
+// DecodeJob
+// ---------------------------------------------------------------------------
+
+DecodeJob::DecodeJob(DecodeScheduler* pScheduler, UINT32 queueDepth)
+    : m_pScheduler(pScheduler), m_queue(queueDepth)
+{
+}
+
+DecodeJob::~DecodeJob()
+{
+    if (m_pScheduler) m_pScheduler->Unregister(this);
+    m_queue.Clear();
+}
+
+void DecodeJob::SetReader(IMFSourceReader* pReader, IMFPresentationClock* pClock)
+{
+    m_pReader = pReader;
+    m_pClock = pClock;
+}
+
+void DecodeJob::SetPriority(DecodePriority priority, UINT32 maxFrameRate)
+{
+    EnterCriticalSection(&m_pScheduler->m_cs);
+    m_priority = priority;
+    m_llMinInterval = maxFrameRate ? 10000000LL / maxFrameRate : 0;
+    m_llNextDelivery = -1;
+    m_llDeliveryDue = -1;
+    m_pScheduler->Wake();
+    LeaveCriticalSection(&m_pScheduler->m_cs);
+}
+
+HRESULT DecodeJob::Start()
+{
+    if (!m_pReader) return E_UNEXPECTED;
+
+    EnterCriticalSection(&m_pScheduler->m_cs);
+    m_hrStatus.store(S_OK, std::memory_order_release);
+    m_bEndOfStream.store(false, std::memory_order_release);
+    m_bRunning = true;
+    m_pScheduler->Wake();
+    LeaveCriticalSection(&m_pScheduler->m_cs);
+    return S_OK;
+}
+
+HRESULT DecodeJob::Flush()
+{
+    EnterCriticalSection(&m_pScheduler->m_cs);
+    m_bRunning = false;
+    m_pScheduler->WaitUntilIdle(this);
+    m_llNextTimestamp = -1;
+    m_llNextDelivery = -1;
+    m_llFrameDue = -1;
+    m_llDeliveryDue = -1;
+    LeaveCriticalSection(&m_pScheduler->m_cs);
+
+    // No worker touches a stopped job, so the queue and the reader are ours now
+    HRESULT hr = m_pReader ? m_pReader->Flush(MF_SOURCE_READER_FIRST_VIDEO_STREAM) : E_UNEXPECTED;
+    m_queue.Clear();
+    return hr;
+}
+
+void DecodeJob::Shutdown()
+{
+    Flush();
+    m_pScheduler->Unregister(this);
+    m_pReader = nullptr;
+    m_pClock = nullptr;
+}
+
+void DecodeJob::NotifyConsumed()
+{
+    // Taking the lock orders the wakeup after a worker that just found the queue full goes to sleep
+    EnterCriticalSection(&m_pScheduler->m_cs);
+    m_pScheduler->Wake();
+    LeaveCriticalSection(&m_pScheduler->m_cs);
+}
+
+// ---------------------------------------------------------------------------
+// DecodeScheduler
+// ---------------------------------------------------------------------------
+
+DecodeScheduler::DecodeScheduler()
+{
+    InitializeCriticalSection(&m_cs);
+    InitializeConditionVariable(&m_cvWork);
+    InitializeConditionVariable(&m_cvIdle);
+
+    // Leave a core for the render and audio threads
+    const DWORD cores = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+    m_workerCount = std::clamp<UINT32>(cores > 1 ? cores - 1 : 1, 1, kMaxWorkers);
+}
+
+DecodeScheduler::~DecodeScheduler()
+{
+    EnterCriticalSection(&m_cs);
+    m_bStopped = true;
+    WakeAllConditionVariable(&m_cvWork);
+    LeaveCriticalSection(&m_cs);
+
+    for (HANDLE hThread : m_threads) {
+        if (WaitForSingleObject(hThread, kStopTimeoutMs) == WAIT_TIMEOUT)
+            TerminateThread(hThread, 0);
+        CloseHandle(hThread);
+    }
+    DeleteCriticalSection(&m_cs);
+}
+
+HRESULT DecodeScheduler::Register(DecodeJob* pJob)
+{
+    if (!pJob) return E_INVALIDARG;
+
+    HRESULT hr = S_OK;
+    EnterCriticalSection(&m_cs);
+    if (std::find(m_jobs.begin(), m_jobs.end(), pJob) == m_jobs.end())
+        m_jobs.push_back(pJob);
+
+    while (m_threads.size() < m_workerCount) {
+        HANDLE hThread = CreateThread(nullptr, 0, WorkerProc, this, 0, nullptr);
+        if (!hThread) {
+            if (m_threads.empty()) {
+                hr = HRESULT_FROM_WIN32(GetLastError());
+                m_jobs.erase(std::find(m_jobs.begin(), m_jobs.end(), pJob));
+            }
+            break;
+        }
+        m_threads.push_back(hThread);
+    }
+    LeaveCriticalSection(&m_cs);
+    return hr;
+}
+
+void DecodeScheduler::Unregister(DecodeJob* pJob)
+{
+    EnterCriticalSection(&m_cs);
+    auto it = std::find(m_jobs.begin(), m_jobs.end(), pJob);
+    if (it != m_jobs.end()) {
+        WaitUntilIdle(pJob);
+        m_jobs.erase(std::find(m_jobs.begin(), m_jobs.end(), pJob));
+    }
+    LeaveCriticalSection(&m_cs);
+}
+
+void DecodeScheduler::WaitUntilIdle(DecodeJob* pJob)
+{
+    while (pJob->m_bBusy)
+        SleepConditionVariableCS(&m_cvIdle, &m_cs, INFINITE);
+}
+
+void DecodeScheduler::Wake()
+{
+    WakeAllConditionVariable(&m_cvWork);
+}
+
+DWORD WINAPI DecodeScheduler::WorkerProc(LPVOID lpParam)
+{
+    static_cast<DecodeScheduler*>(lpParam)->Run();
+    return 0;
+}
+
+DecodeJob* DecodeScheduler::PickJob(DWORD* pWaitMs)
+{
+    DecodeJob* pBest = nullptr;
+    LONGLONG bestDeadline = LLONG_MAX;
+    LONGLONG nextEligible = LLONG_MAX;
+    const LONGLONG now = MFGetSystemTime();
+    for (DecodeJob* pJob : m_jobs) {
+        if (!pJob->m_bRunning || pJob->m_bBusy || !pJob->m_pReader || pJob->m_queue.IsFull() ||
+            pJob->IsEndOfStream() || FAILED(pJob->GetStatus()))
+            continue;
+
+        // Over its cap: the next delivered frame is queued and the one after is more than an interval away.
+        // Every frame up to it has to be decoded anyway, so that work waits until it is needed.
+        if (pJob->m_llDeliveryDue >= 0) {
+            const LONGLONG eligible = pJob->m_llDeliveryDue - pJob->m_llMinInterval;
+            if (eligible > now) {
+                nextEligible = std::min(nextEligible, eligible);
+                continue;
+            }
+        }
+
+        // Time left before the next frame is due; a job that has no frame yet goes first
+        LONGLONG deadline = LLONG_MIN;
+        if (pJob->m_llNextTimestamp >= 0) {
+            deadline = pJob->m_llFrameDue >= 0 ? pJob->m_llFrameDue - now : pJob->m_llNextTimestamp;
+            if (pJob->m_priority == DECODE_PRIORITY_LOW)
+                deadline += kLowPriorityBias;
+        }
+        if (!pBest || deadline < bestDeadline) {
+            pBest = pJob;
+            bestDeadline = deadline;
+        }
+    }
+
+    *pWaitMs = INFINITE;
+    if (!pBest && nextEligible != LLONG_MAX)
+        *pWaitMs = static_cast<DWORD>((nextEligible - now + 9999) / 10000);
+    return pBest;
+}
+
+void DecodeScheduler::Run()
+{
+    EnterCriticalSection(&m_cs);
+    while (!m_bStopped) {
+        DWORD waitMs = INFINITE;
+        DecodeJob* pJob = PickJob(&waitMs);
+        if (!pJob) {
+            SleepConditionVariableCS(&m_cvWork, &m_cs, waitMs);
+            continue;
+        }
+
+        pJob->m_bBusy = true;
+        IMFSourceReader* pReader = pJob->m_pReader;
+        IMFPresentationClock* pClock = pJob->m_pClock;
+        LeaveCriticalSection(&m_cs);
+
+        DWORD streamIndex = 0, flags = 0;
+        LONGLONG timestamp = 0;
+        IMFSample* pSample = nullptr;
+        const LONGLONG decodeStart = PlayerMetrics::Now();
+        HRESULT hr = pReader->ReadSample(MF_SOURCE_READER_FIRST_VIDEO_STREAM, 0, &streamIndex, &flags, &timestamp, &pSample);
+        const UINT64 decodeUs = PlayerMetrics::MicrosecondsSince(decodeStart);
+
+        // Where the clock is now, for the deadlines the next picks compare
+        MFTIME clockTime = 0;
+        const bool bClock = pClock && SUCCEEDED(pClock->GetTime(&clockTime));
+        const LONGLONG systemTime = MFGetSystemTime();
+
+        EnterCriticalSection(&m_cs);
+        pJob->m_bBusy = false;
+        WakeAllConditionVariable(&m_cvIdle); // Flush and Unregister may be waiting for this decode
+
+        if (!pJob->m_bRunning) {
+            // Flushed while decoding: the frame belongs to the old position
+            if (pSample) pSample->Release();
+        } else if (FAILED(hr) || (flags & MF_SOURCE_READERF_ERROR)) {
+            pJob->m_hrStatus.store(FAILED(hr) ? hr : E_FAIL, std::memory_order_release);
+            if (pSample) pSample->Release();
+        } else {
+            // A type change reported without a sample, or on a frame throttled away, applies to the next delivered one
+            pJob->m_pendingFlags |= flags & MF_SOURCE_READERF_CURRENTMEDIATYPECHANGED;
+            if (pSample) {
+                QueuedFrame frame;
+                frame.pSample = pSample;
+                frame.timestamp = timestamp;
+                frame.flags = pJob->m_pendingFlags;
+                frame.decodeUs = static_cast<UINT32>(std::min<UINT64>(decodeUs, UINT32_MAX));
+                pSample->GetSampleDuration(&frame.duration);
+                pJob->m_llNextTimestamp = timestamp + frame.duration;
+
+                // Throttled jobs still decode every frame (later frames depend on it) but deliver fewer.
+                // Frames are only decoded while the queue has room, so Push cannot fail.
+                if (pJob->m_llMinInterval && pJob->m_llNextDelivery >= 0 && timestamp < pJob->m_llNextDelivery) {
+                    pSample->Release();
+                } else {
+                    if (pJob->m_llMinInterval)
+                        pJob->m_llNextDelivery = timestamp + pJob->m_llMinInterval;
+                    if (pJob->m_queue.Push(frame))
+                        pJob->m_pendingFlags = 0;
+                    else
+                        pSample->Release();
+                }
+                pJob->m_llFrameDue = bClock ? systemTime + (pJob->m_llNextTimestamp - clockTime) : -1;
+                pJob->m_llDeliveryDue = (bClock && pJob->m_llMinInterval && pJob->m_llNextDelivery >= 0)
+                                            ? systemTime + (pJob->m_llNextDelivery - clockTime) : -1;
+            }
+            if (flags & MF_SOURCE_READERF_ENDOFSTREAM)
+                pJob->m_bEndOfStream.store(true, std::memory_order_release);
+        }
+    }
+    LeaveCriticalSection(&m_cs);
+}
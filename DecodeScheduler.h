@@ -0,0 +1,116 @@
+#pragma once
+
+#include <windows.h>
+#include <mfidl.h>
+#include <mfreadwrite.h>
+#include <atomic>
+#include <vector>
+#include "FrameProducer.h"
+#include "NativeVideoPlayer.h"
+
+class DecodeScheduler;
+
+/**
+ * @brief Video stream of one player, decoded ahead into a FrameQueue by the shared DecodeScheduler workers.
+ *
+ * The source reader must be synchronous. A job is decoded by at most one worker at a time; the deadline of its
+ * next frame is taken from the presentation clock so the most urgent jobs are served first.
+ */
+class DecodeJob : public FrameProducer {
+public:
+    DecodeJob(DecodeScheduler* pScheduler, UINT32 queueDepth);
+    ~DecodeJob();
+
+    DecodeJob(const DecodeJob&) = delete;
+    DecodeJob& operator=(const DecodeJob&) = delete;
+
+    /**
+     * @brief Attaches the source reader and the clock deadlines are measured against (neither is referenced).
+     */
+    void SetReader(IMFSourceReader* pReader, IMFPresentationClock* pClock);
+
+    /**
+     * @brief Changes the scheduling class and the delivered frame rate cap (0 for no cap).
+     */
+    void SetPriority(DecodePriority priority, UINT32 maxFrameRate);
+
+    // FrameProducer
+    HRESULT Start() override;
+    HRESULT Flush() override;
+    void Shutdown() override;
+    void NotifyConsumed() override;
+    FrameQueue& Queue() override { return m_queue; }
+    bool IsEndOfStream() const override { return m_bEndOfStream.load(std::memory_order_acquire); }
+    HRESULT GetStatus() const override { return m_hrStatus.load(std::memory_order_acquire); }
+
+private:
+    friend class DecodeScheduler;
+
+    DecodeScheduler* m_pScheduler = nullptr;
+    IMFSourceReader* m_pReader = nullptr;
+    IMFPresentationClock* m_pClock = nullptr;
+    FrameQueue m_queue;
+    std::atomic<bool> m_bEndOfStream{false};
+    std::atomic<HRESULT> m_hrStatus{S_OK};
+
+    // Guarded by the scheduler lock
+    bool m_bRunning = false;
+    bool m_bBusy = false;
+    DecodePriority m_priority = DECODE_PRIORITY_NORMAL;
+    LONGLONG m_llMinInterval = 0;      // 100-ns between delivered frames, 0 when not throttled
+    LONGLONG m_llNextTimestamp = -1;   // Expected timestamp of the next frame (-1 before the first one)
+    LONGLONG m_llNextDelivery = -1;    // Earliest timestamp delivered next when throttled
+    // Refreshed from the clock each time a frame is decoded, so picking a job does not query every clock:
+    // system time (MFGetSystemTime) at which the next frame and the next delivered frame are due, -1 if unknown
+    LONGLONG m_llFrameDue = -1;
+    LONGLONG m_llDeliveryDue = -1;
+    DWORD m_pendingFlags = 0;          // Reader flags not delivered with a frame yet
+};
+
+/**
+ * @brief Fixed pool of decode workers shared by every player in VIDEO_DECODE_MODE_SCHEDULED.
+ *
+ * Workers repeatedly pick the registered job whose next frame is due soonest (low-priority jobs are biased
+ * later) and has room in its queue, and decode one frame from it. A throttled job that already holds a frame
+ * for its next delivery is left alone until that delivery comes within one interval. Workers start with the
+ * first job.
+ */
+class DecodeScheduler {
+public:
+    DecodeScheduler();
+    ~DecodeScheduler();
+
+    DecodeScheduler(const DecodeScheduler&) = delete;
+    DecodeScheduler& operator=(const DecodeScheduler&) = delete;
+
+    /**
+     * @brief Adds a job (idle until its Start) and starts the workers if needed.
+     * @return S_OK on success, or an error code if no worker could be started.
+     */
+    HRESULT Register(DecodeJob* pJob);
+
+    /**
+     * @brief Removes a job, waiting for a decode in progress on it to finish.
+     */
+    void Unregister(DecodeJob* pJob);
+
+    UINT32 WorkerCount() const { return m_workerCount; }
+
+private:
+    friend class DecodeJob;
+
+    static DWORD WINAPI WorkerProc(LPVOID lpParam);
+    void Run();
+    DecodeJob* PickJob(DWORD* pWaitMs);
+    void WaitUntilIdle(DecodeJob* pJob);
+    void Wake();
+
+    std::vector<DecodeJob*> m_jobs;
+    std::vector<HANDLE> m_threads;
+    UINT32 m_workerCount = 1;
+
+    CRITICAL_SECTION m_cs{};
+    CONDITION_VARIABLE m_cvWork{};     // signalled when a job may have become runnable
+    CONDITION_VARIABLE m_cvIdle{};     // signalled when a worker finishes a decode
+    bool m_bStopped = false;
+};
@@ -0,0 +1,117 @@
+#include "FramePool.h"
+#include <mfapi.h>
+#include <mferror.h>
+
+FramePool::FramePool(BYTE* const* ppBuffers, UINT32 bufferCount, DWORD bufferSize, UINT32 pitch)
+    : m_count(bufferCount < kMaxBuffers ? bufferCount : kMaxBuffers), m_bufferSize(bufferSize), m_pitch(pitch)
+{
+    for (UINT32 i = 0; i < m_count; ++i)
+        m_buffers[i] = ppBuffers[i];
+    m_freeMask.store(m_count == 64 ? ~0ull : ((1ull << m_count) - 1), std::memory_order_release);
+}
+
+bool FramePool::HasFramesInFlight() const
+{
+    const UINT64 allFree = m_count == 64 ? ~0ull : ((1ull << m_count) - 1);
+    return m_freeMask.load(std::memory_order_acquire) != allFree;
+}
+
+bool FramePool::Acquire(UINT32* pIndex)
+{
+    UINT64 mask = m_freeMask.load(std::memory_order_acquire);
+    while (mask) {
+        unsigned long bit = 0;
+        _BitScanForward64(&bit, mask);
+        if (m_freeMask.compare_exchange_weak(mask, mask & ~(1ull << bit), std::memory_order_acq_rel)) {
+            *pIndex = bit;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FramePool::Release(UINT32 index)
+{
+    if (index >= m_count) return false;
+    const UINT64 bit = 1ull << index;
+    return (m_freeMask.fetch_or(bit, std::memory_order_acq_rel) & bit) == 0;
+}
+
+HRESULT FramePool::CopySample(UINT32 index, IMFSample* pSample, UINT32 width, UINT32 height, VideoOutputFormat format) const
+{
+    BYTE* dst = Buffer(index);
+    if (!dst || !pSample) return E_INVALIDARG;
+
+    // Bytes per row of the luma (or packed RGB) plane, and rows including the interleaved chroma plane
+    const UINT32 bytesPerPixel = format == VIDEO_OUTPUT_FORMAT_RGB32 ? 4 : (format == VIDEO_OUTPUT_FORMAT_P010 ? 2 : 1);
+    const UINT32 rowBytes = width * bytesPerPixel;
+    const UINT32 chromaRows = format == VIDEO_OUTPUT_FORMAT_RGB32 ? 0 : (height + 1) / 2;
+    if (rowBytes > m_pitch || static_cast<UINT64>(m_pitch) * (height + chromaRows) > m_bufferSize)
+        return MF_E_BUFFERTOOSMALL;
+
+    // Prefer the 2-D buffer of a single-buffer sample, which avoids the contiguous copy
+    IMFMediaBuffer* pBuffer = nullptr;
+    IMF2DBuffer* p2DBuffer = nullptr;
+    DWORD bufferCount = 0;
+    HRESULT hr = pSample->GetBufferCount(&bufferCount);
+    if (SUCCEEDED(hr) && bufferCount == 1)
+        hr = pSample->GetBufferByIndex(0, &pBuffer);
+    else if (SUCCEEDED(hr))
+        hr = pSample->ConvertToContiguousBuffer(&pBuffer);
+    if (FAILED(hr)) return hr;
+
+    BYTE* src = nullptr;
+    LONG srcPitch = 0;
+    UINT32 srcLumaRows = height; // Decoder surfaces may be padded below the visible area
+    enum { kNotLocked, kLocked2D, kLocked } lockState = kNotLocked;
+
+    IMF2DBuffer2* p2DBuffer2 = nullptr;
+    if (SUCCEEDED(pBuffer->QueryInterface(IID_PPV_ARGS(&p2DBuffer2)))) {
+        BYTE* bufferStart = nullptr;
+        DWORD bufferLength = 0;
+        hr = p2DBuffer2->Lock2DSize(MF2DBuffer_LockFlags_Read, &src, &srcPitch, &bufferStart, &bufferLength);
+        if (SUCCEEDED(hr)) {
+            lockState = kLocked2D;
+            p2DBuffer = p2DBuffer2;
+            p2DBuffer2 = nullptr;
+            const UINT64 absPitch = srcPitch < 0 ? -static_cast<INT64>(srcPitch) : srcPitch;
+            if (chromaRows && absPitch) {
+                const UINT64 planeRows = (static_cast<UINT64>(bufferLength) * 2) / (absPitch * 3);
+                if (planeRows >= height) srcLumaRows = static_cast<UINT32>(planeRows);
+            }
+        }
+        if (p2DBuffer2) p2DBuffer2->Release();
+    }
+    if (lockState == kNotLocked && SUCCEEDED(pBuffer->QueryInterface(IID_PPV_ARGS(&p2DBuffer)))) {
+        if (SUCCEEDED(p2DBuffer->Lock2D(&src, &srcPitch)))
+            lockState = kLocked2D;
+    }
+    if (lockState == kNotLocked) {
+        DWORD cbMax = 0, cbCurr = 0;
+        hr = pBuffer->Lock(&src, &cbMax, &cbCurr);
+        if (SUCCEEDED(hr)) {
+            lockState = kLocked;
+            srcPitch = static_cast<LONG>(rowBytes);
+            if (cbCurr < rowBytes * (height + chromaRows))
+                hr = MF_E_BUFFERTOOSMALL;
+        }
+    } else {
+        hr = S_OK;
+    }
+
+    if (SUCCEEDED(hr)) {
+        hr = MFCopyImage(dst, m_pitch, src, srcPitch, rowBytes, height);
+        if (SUCCEEDED(hr) && chromaRows) {
+            // The chroma plane follows the (possibly padded) luma plane at the same pitch
+            const BYTE* srcChroma = src + static_cast<LONG_PTR>(srcPitch) * srcLumaRows;
+            hr = MFCopyImage(dst + static_cast<size_t>(m_pitch) * height, m_pitch, srcChroma, srcPitch, rowBytes, chromaRows);
+        }
+    }
+
+    if (lockState == kLocked2D)    p2DBuffer->Unlock2D();
+    else if (lockState == kLocked) pBuffer->Unlock();
+
+    if (p2DBuffer) p2DBuffer->Release();
+    pBuffer->Release();
+    return hr;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <windows.h>
+#include <mfidl.h>
+#include <atomic>
+#include "NativeVideoPlayer.h"
+
+/**
+ * @brief Set of caller-owned destination buffers that decoded frames are copied into.
+ *
+ * Buffers are handed out one frame at a time and stay reserved until the caller releases them,
+ * so several frames can be in flight at once. Acquire and Release may be called from different threads.
+ */
+class FramePool {
+public:
+    static constexpr UINT32 kMaxBuffers = 64;
+
+    /**
+     * @brief Registers the destination buffers.
+     * @param ppBuffers Array of bufferCount pointers to buffers of bufferSize bytes each.
+     * @param bufferCount Number of buffers (1 to kMaxBuffers).
+     * @param bufferSize Size in bytes of every buffer.
+     * @param pitch Destination row pitch in bytes.
+     */
+    FramePool(BYTE* const* ppBuffers, UINT32 bufferCount, DWORD bufferSize, UINT32 pitch);
+
+    UINT32 Count() const { return m_count; }
+    DWORD BufferSize() const { return m_bufferSize; }
+    UINT32 Pitch() const { return m_pitch; }
+    BYTE* Buffer(UINT32 index) const { return index < m_count ? m_buffers[index] : nullptr; }
+
+    /**
+     * @brief Tells whether some buffer is reserved, i.e. still holds a frame the caller may be reading.
+     */
+    bool HasFramesInFlight() const;
+
+    /**
+     * @brief Reserves a free buffer.
+     * @return False if every buffer is in flight.
+     */
+    bool Acquire(UINT32* pIndex);
+
+    /**
+     * @brief Returns a buffer to the pool.
+     * @return False if the index is out of range or the buffer was not reserved.
+     */
+    bool Release(UINT32 index);
+
+    /**
+     * @brief Copies a decoded frame into a reserved buffer at the pool pitch.
+     * @param index Reserved buffer.
+     * @param pSample Decoded sample.
+     * @param width Frame width in pixels.
+     * @param height Frame height in pixels.
+     * @param format Pixel format of the sample.
+     * @return S_OK on success, MF_E_BUFFERTOOSMALL if the frame does not fit, or an error code.
+     */
+    HRESULT CopySample(UINT32 index, IMFSample* pSample, UINT32 width, UINT32 height, VideoOutputFormat format) const;
+
+private:
+    BYTE* m_buffers[kMaxBuffers] = {};
+    UINT32 m_count = 0;
+    DWORD m_bufferSize = 0;
+    UINT32 m_pitch = 0;
+    std::atomic<UINT64> m_freeMask{0};
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <windows.h>
+#include "FrameQueue.h"
+
+/**
+ * @brief Consumer-side interface of the components that decode video ahead into a FrameQueue.
+ *
+ * Implemented by AsyncFrameReader (source reader callbacks) and DecodeJob (shared decode workers).
+ * Lifetime is managed by the implementation, not through this interface.
+ */
+class FrameProducer {
+public:
+    /**
+     * @brief Starts filling the queue.
+     * @return S_OK on success, or an error code.
+     */
+    virtual HRESULT Start() = 0;
+
+    /**
+     * @brief Stops decoding, waits for the request in progress and empties the queue.
+     * @return S_OK on success, or an error code.
+     */
+    virtual HRESULT Flush() = 0;
+
+    /**
+     * @brief Stops decoding for good; the reader can then be released safely.
+     */
+    virtual void Shutdown() = 0;
+
+    /**
+     * @brief Must be called by the consumer after popping a frame from Queue().
+     */
+    virtual void NotifyConsumed() = 0;
+
+    virtual FrameQueue& Queue() = 0;
+    virtual bool IsEndOfStream() const = 0;
+    virtual HRESULT GetStatus() const = 0;
+
+protected:
+    ~FrameProducer() = default;
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <windows.h>
+#include <mfidl.h>
+#include <atomic>
+#include <memory>
+
+/**
+ * @brief A decoded video frame waiting in a FrameQueue.
+ */
+struct QueuedFrame {
+    IMFSample* pSample = nullptr; // Owned reference
+    LONGLONG timestamp = 0;       // Presentation time in 100-ns
+    LONGLONG duration = 0;        // Frame duration in 100-ns (0 if unknown)
+    DWORD flags = 0;              // MF_SOURCE_READERF_CURRENTMEDIATYPECHANGED on the first frame of a new output type
+    UINT32 decodeUs = 0;          // Time the producer spent reading the frame, in microseconds
+};
+
+/**
+ * @brief Bounded lock-free ring of decoded frames with one producer and one consumer.
+ *
+ * The producer (decode side) only calls Push; the consumer (render side) only calls Peek and Pop.
+ * Clear must only be called while the producer is idle.
+ */
+class FrameQueue {
+public:
+    explicit FrameQueue(UINT32 capacity)
+        : m_capacity(capacity ? capacity : 1), m_slots(new QueuedFrame[m_capacity]) {}
+
+    ~FrameQueue() { Clear(); }
+
+    FrameQueue(const FrameQueue&) = delete;
+    FrameQueue& operator=(const FrameQueue&) = delete;
+
+    UINT32 Capacity() const { return m_capacity; }
+
+    UINT32 Size() const {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+    bool IsFull() const { return Size() >= m_capacity; }
+
+    /**
+     * @brief Appends a frame, taking ownership of its sample reference.
+     * @return False if the queue is full (ownership stays with the caller).
+     */
+    bool Push(const QueuedFrame& frame) {
+        const UINT32 tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) >= m_capacity)
+            return false;
+        m_slots[tail % m_capacity] = frame;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Returns the frame at the given distance from the head without removing it.
+     * @return Null if fewer than offset + 1 frames are queued.
+     */
+    const QueuedFrame* Peek(UINT32 offset = 0) const {
+        const UINT32 head = m_head.load(std::memory_order_relaxed);
+        if (m_tail.load(std::memory_order_acquire) - head <= offset)
+            return nullptr;
+        return &m_slots[(head + offset) % m_capacity];
+    }
+
+    /**
+     * @brief Removes the head frame and transfers its sample reference to the caller.
+     * @return False if the queue is empty.
+     */
+    bool Pop(QueuedFrame* pFrame) {
+        const UINT32 head = m_head.load(std::memory_order_relaxed);
+        if (m_tail.load(std::memory_order_acquire) == head)
+            return false;
+        QueuedFrame& slot = m_slots[head % m_capacity];
+        *pFrame = slot;
+        slot = QueuedFrame();
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Releases every queued sample.
+     */
+    void Clear() {
+        QueuedFrame frame;
+        while (Pop(&frame)) {
+            if (frame.pSample) frame.pSample->Release();
+        }
+    }
+
+private:
+    const UINT32 m_capacity;
+    std::unique_ptr<QueuedFrame[]> m_slots;
+    alignas(64) std::atomic<UINT32> m_head{0};
+    alignas(64) std::atomic<UINT32> m_tail{0};
+};
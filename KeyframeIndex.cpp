@@ -0,0 +1,126 @@
+#include "KeyframeIndex.h"
+#include <mfapi.h>
+#include <mfidl.h>
+#include <mfreadwrite.h>
+#include <algorithm>
+#include <climits>
+
+// Keyframes are published to readers in batches to keep lock traffic low
+constexpr size_t kPublishBatch = 64;
+
+KeyframeIndex::KeyframeIndex() = default;
+
+KeyframeIndex::~KeyframeIndex()
+{
+    Cancel();
+}
+
+HRESULT KeyframeIndex::StartBuild(const std::wstring& url)
+{
+    if (m_hThread) return S_OK;
+
+    m_url = url;
+    InterlockedExchange(&m_bCancelled, FALSE);
+    m_hThread = CreateThread(nullptr, 0, ThreadProc, this, 0, nullptr);
+    return m_hThread ? S_OK : HRESULT_FROM_WIN32(GetLastError());
+}
+
+void KeyframeIndex::Cancel()
+{
+    InterlockedExchange(&m_bCancelled, TRUE);
+    if (m_hThread) {
+        WaitForSingleObject(m_hThread, INFINITE);
+        CloseHandle(m_hThread);
+        m_hThread = nullptr;
+    }
+}
+
+bool KeyframeIndex::IsComplete() const
+{
+    return InterlockedCompareExchange(const_cast<volatile LONG*>(&m_bComplete), 0, 0) != FALSE;
+}
+
+bool KeyframeIndex::FindNearest(LONGLONG llPosition, LONGLONG* pKeyframe) const
+{
+    AcquireSRWLockShared(&m_lock);
+    bool bFound = false;
+    if (!m_keyframes.empty()) {
+        auto it = std::lower_bound(m_keyframes.begin(), m_keyframes.end(), llPosition);
+        if (it != m_keyframes.end()) {
+            // Both neighbours are known
+            LONGLONG after = *it;
+            LONGLONG before = (it == m_keyframes.begin()) ? after : *(it - 1);
+            *pKeyframe = (llPosition - before <= after - llPosition) ? before : after;
+            bFound = true;
+        } else if (IsComplete()) {
+            *pKeyframe = m_keyframes.back();
+            bFound = true;
+        }
+    }
+    ReleaseSRWLockShared(&m_lock);
+    return bFound;
+}
+
+DWORD WINAPI KeyframeIndex::ThreadProc(LPVOID lpParam)
+{
+    HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    static_cast<KeyframeIndex*>(lpParam)->Build();
+    if (SUCCEEDED(hr)) CoUninitialize();
+    return 0;
+}
+
+void KeyframeIndex::Build()
+{
+    // Without an output type the reader delivers compressed samples, so no decoder is loaded
+    IMFSourceReader* pReader = nullptr;
+    HRESULT hr = MFCreateSourceReaderFromURL(m_url.c_str(), nullptr, &pReader);
+    if (SUCCEEDED(hr))
+        hr = pReader->SetStreamSelection(MF_SOURCE_READER_ALL_STREAMS, FALSE);
+    if (SUCCEEDED(hr))
+        hr = pReader->SetStreamSelection(MF_SOURCE_READER_FIRST_VIDEO_STREAM, TRUE);
+
+    std::vector<LONGLONG> pending;
+    pending.reserve(kPublishBatch);
+    auto publish = [this, &pending]() {
+        if (pending.empty()) return;
+        AcquireSRWLockExclusive(&m_lock);
+        m_keyframes.insert(m_keyframes.end(), pending.begin(), pending.end());
+        ReleaseSRWLockExclusive(&m_lock);
+        pending.clear();
+    };
+
+    LONGLONG llLast = LLONG_MIN;
+    bool bSorted = true;
+    while (SUCCEEDED(hr) && !m_bCancelled) {
+        DWORD flags = 0;
+        LONGLONG timestamp = 0;
+        IMFSample* pSample = nullptr;
+        hr = pReader->ReadSample(MF_SOURCE_READER_FIRST_VIDEO_STREAM, 0, nullptr, &flags, &timestamp, &pSample);
+        if (FAILED(hr) || (flags & MF_SOURCE_READERF_ENDOFSTREAM)) {
+            if (pSample) pSample->Release();
+            break;
+        }
+        if (!pSample) continue;
+
+        if (MFGetAttributeUINT32(pSample, MFSampleExtension_CleanPoint, FALSE)) {
+            if (timestamp < llLast) bSorted = false;
+            llLast = timestamp;
+            pending.push_back(timestamp);
+            if (pending.size() >= kPublishBatch) publish();
+        }
+        pSample->Release();
+    }
+    publish();
+
+    if (!m_bCancelled && SUCCEEDED(hr)) {
+        // Decode order only differs from presentation order for keyframes in unusual streams
+        if (!bSorted) {
+            AcquireSRWLockExclusive(&m_lock);
+            std::sort(m_keyframes.begin(), m_keyframes.end());
+            ReleaseSRWLockExclusive(&m_lock);
+        }
+        InterlockedExchange(&m_bComplete, TRUE);
+    }
+
+    if (pReader) pReader->Release();
+}
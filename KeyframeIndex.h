@@ -0,0 +1,56 @@
+#pragma once
+
+#include <windows.h>
+#include <vector>
+#include <string>
+
+/**
+ * @brief Sorted list of the sync-sample (keyframe) timestamps of a video stream.
+ *
+ * The index is built on a background thread by reading the compressed stream without decoding it.
+ * Lookups can run while it is being built; they fail for positions past what has been indexed so far.
+ */
+class KeyframeIndex {
+public:
+    KeyframeIndex();
+    ~KeyframeIndex();
+
+    KeyframeIndex(const KeyframeIndex&) = delete;
+    KeyframeIndex& operator=(const KeyframeIndex&) = delete;
+
+    /**
+     * @brief Starts indexing the first video stream of a media on a background thread.
+     * @param url Path or file:// URL of a local media (a network media would be downloaded again).
+     * @return S_OK on success, or an error code.
+     */
+    HRESULT StartBuild(const std::wstring& url);
+
+    /**
+     * @brief Cancels a build in progress and waits for the thread to exit.
+     */
+    void Cancel();
+
+    /**
+     * @brief Tells whether the whole stream has been indexed.
+     */
+    bool IsComplete() const;
+
+    /**
+     * @brief Finds the keyframe closest to a position.
+     * @param llPosition Position in 100-ns.
+     * @param pKeyframe Receives the keyframe timestamp.
+     * @return False if the position has not been indexed yet.
+     */
+    bool FindNearest(LONGLONG llPosition, LONGLONG* pKeyframe) const;
+
+private:
+    static DWORD WINAPI ThreadProc(LPVOID lpParam);
+    void Build();
+
+    std::wstring m_url;
+    std::vector<LONGLONG> m_keyframes;
+    mutable SRWLOCK m_lock = SRWLOCK_INIT;
+    HANDLE m_hThread = nullptr;
+    volatile LONG m_bCancelled = FALSE;
+    volatile LONG m_bComplete = FALSE;
+};
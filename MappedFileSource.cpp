@@ -0,0 +1,273 @@
+#include "MappedFileSource.h"
+#include "NativeVideoPlayer.h"
+#include <mferror.h>
+#include <algorithm>
+#include <cstring>
+
+// Top-level MP4 boxes walked at open to find the index, and the most prefetched per box
+constexpr int kMaxIndexBoxes = 64;
+constexpr QWORD kMaxIndexPrefetchBytes = 64ULL * 1024 * 1024;
+
+// Container header prefetched at open, whatever the format
+constexpr QWORD kHeadPrefetchBytes = 1024 * 1024;
+
+namespace {
+
+typedef BOOL (WINAPI *PrefetchVirtualMemoryFn)(HANDLE, ULONG_PTR, PWIN32_MEMORY_RANGE_ENTRY, ULONG);
+
+// Resolved at run time: the function is missing before Windows 8
+PrefetchVirtualMemoryFn GetPrefetchVirtualMemory()
+{
+    static const auto pfn = reinterpret_cast<PrefetchVirtualMemoryFn>(
+        GetProcAddress(GetModuleHandleW(L"kernel32.dll"), "PrefetchVirtualMemory"));
+    return pfn;
+}
+
+// Page faults on the mapping surface as EXCEPTION_IN_PAGE_ERROR when the file cannot be read (removed drive,
+// network share gone); no C++ objects here, as required for __try
+bool CopyFromMapping(void* pDst, const void* pSrc, size_t cb)
+{
+    __try {
+        memcpy(pDst, pSrc, cb);
+        return true;
+    } __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH) {
+        return false;
+    }
+}
+
+UINT32 ReadBigEndian32(const BYTE* p)
+{
+    return (static_cast<UINT32>(p[0]) << 24) | (static_cast<UINT32>(p[1]) << 16) | (static_cast<UINT32>(p[2]) << 8) | p[3];
+}
+
+} // namespace
+
+HRESULT MappedFileSource::Create(const wchar_t* path, MappedFileSource** ppSource)
+{
+    if (!path || !ppSource)
+        return E_POINTER;
+    *ppSource = nullptr;
+
+    auto* pSource = new (std::nothrow) MappedFileSource(path);
+    if (!pSource)
+        return E_OUTOFMEMORY;
+    HRESULT hr = pSource->Initialize(path);
+    if (FAILED(hr)) {
+        pSource->Release();
+        return hr;
+    }
+    *ppSource = pSource;
+    return S_OK;
+}
+
+MappedFileSource::MappedFileSource(const wchar_t* path)
+    : SharedByteSource(path)
+{
+}
+
+MappedFileSource::~MappedFileSource()
+{
+    for (View* pView : m_views) {
+        UnmapViewOfFile(pView->pBase);
+        delete pView;
+    }
+    if (m_hMapping) CloseHandle(m_hMapping);
+    if (m_hFile != INVALID_HANDLE_VALUE) CloseHandle(m_hFile);
+}
+
+HRESULT MappedFileSource::Initialize(const wchar_t* path)
+{
+    m_hFile = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                          FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_hFile == INVALID_HANDLE_VALUE)
+        return HRESULT_FROM_WIN32(GetLastError());
+
+    LARGE_INTEGER size = {};
+    if (!GetFileSizeEx(m_hFile, &size))
+        return HRESULT_FROM_WIN32(GetLastError());
+    if (size.QuadPart <= 0)
+        return MF_E_INVALID_FILE_FORMAT;
+    m_size = static_cast<QWORD>(size.QuadPart);
+
+    m_hMapping = CreateFileMappingW(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_hMapping)
+        return HRESULT_FROM_WIN32(GetLastError());
+
+    // Map the first view now so that a file that cannot be mapped falls back to the regular file stream
+    View* pView = nullptr;
+    HRESULT hr = AcquireView(0, &pView);
+    if (FAILED(hr))
+        return hr;
+    ReleaseView(pView);
+
+    Prefetch(0, kHeadPrefetchBytes);
+    PrefetchIndex();
+    m_prefetchedUpTo = kHeadPrefetchBytes;
+    return S_OK;
+}
+
+HRESULT MappedFileSource::Read(QWORD offset, BYTE* pBuffer, ULONG cb, ULONG* pcbRead)
+{
+    HRESULT hr = CopyOut(offset, pBuffer, cb, pcbRead);
+    if (FAILED(hr))
+        return hr;
+    m_bytesRead += *pcbRead;
+
+    // Keep the pages ahead of sequential reads in flight, refilling once half the window is consumed
+    const QWORD end = offset + *pcbRead;
+    const QWORD prefetchedUpTo = m_prefetchedUpTo.load(std::memory_order_relaxed);
+    if (end + kReadAheadBytes / 2 > prefetchedUpTo && end <= prefetchedUpTo + kReadAheadBytes) {
+        const QWORD from = std::max(prefetchedUpTo, end);
+        QWORD expected = prefetchedUpTo;
+        if (m_prefetchedUpTo.compare_exchange_strong(expected, end + kReadAheadBytes, std::memory_order_relaxed))
+            Prefetch(from, end + kReadAheadBytes - from);
+    }
+    return S_OK;
+}
+
+HRESULT MappedFileSource::CopyOut(QWORD offset, BYTE* pBuffer, ULONG cb, ULONG* pcbRead)
+{
+    *pcbRead = 0;
+    while (*pcbRead < cb && offset + *pcbRead < m_size) {
+        const QWORD position = offset + *pcbRead;
+        View* pView = nullptr;
+        HRESULT hr = AcquireView(position, &pView);
+        if (FAILED(hr))
+            return *pcbRead ? S_OK : hr;
+        const QWORD inView = position - pView->offset;
+        const ULONG toCopy = static_cast<ULONG>(std::min<QWORD>(pView->size - inView, cb - *pcbRead));
+        const bool bCopied = CopyFromMapping(pBuffer + *pcbRead, pView->pBase + inView, toCopy);
+        ReleaseView(pView);
+        if (!bCopied)
+            return *pcbRead ? S_OK : HRESULT_FROM_WIN32(ERROR_READ_FAULT);
+        *pcbRead += toCopy;
+    }
+    return S_OK;
+}
+
+void MappedFileSource::OnSeek(QWORD /*previousPosition*/, QWORD position)
+{
+    // Parsers move back and forth within what they just read; only a jump outside the window is a seek
+    const QWORD prefetchedUpTo = m_prefetchedUpTo.load(std::memory_order_relaxed);
+    if (position + kReadAheadBytes >= prefetchedUpTo && position < prefetchedUpTo)
+        return;
+    m_prefetchedUpTo.store(position + kSeekPrefetchBytes, std::memory_order_relaxed);
+    Prefetch(position, kSeekPrefetchBytes);
+}
+
+void MappedFileSource::GetStats(StreamCacheStats* pStats) const
+{
+    pStats->bytesRead = m_bytesRead.load(std::memory_order_relaxed);
+    pStats->bytesFetched = 0;
+    pStats->bytesFromDisk = 0;
+}
+
+HRESULT MappedFileSource::AcquireView(QWORD offset, View** ppView)
+{
+    AcquireSRWLockExclusive(&m_lock);
+    for (View* pView : m_views) {
+        if (offset >= pView->offset && offset < pView->offset + pView->size) {
+            ++pView->pins;
+            pView->lastUse = ++m_useClock;
+            ReleaseSRWLockExclusive(&m_lock);
+            *ppView = pView;
+            return S_OK;
+        }
+    }
+
+    // Unmap the least recently used view beyond the limit; views being copied out of stay mapped
+    if (m_views.size() >= kMaxViews) {
+        auto oldest = m_views.end();
+        for (auto it = m_views.begin(); it != m_views.end(); ++it) {
+            if (!(*it)->pins && (oldest == m_views.end() || (*it)->lastUse < (*oldest)->lastUse))
+                oldest = it;
+        }
+        if (oldest != m_views.end()) {
+            UnmapViewOfFile((*oldest)->pBase);
+            delete *oldest;
+            m_views.erase(oldest);
+        }
+    }
+
+    const bool bWholeFile = m_size <= kWholeFileViewLimit;
+    const QWORD viewOffset = bWholeFile ? 0 : offset / kViewSize * kViewSize;
+    const QWORD viewSize = bWholeFile ? m_size : std::min(kViewSize, m_size - viewOffset);
+    auto* pView = new (std::nothrow) View();
+    HRESULT hr = pView ? S_OK : E_OUTOFMEMORY;
+    if (pView) {
+        pView->pBase = static_cast<BYTE*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, static_cast<DWORD>(viewOffset >> 32),
+                                                        static_cast<DWORD>(viewOffset), static_cast<SIZE_T>(viewSize)));
+        if (!pView->pBase) {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+            delete pView;
+            pView = nullptr;
+        }
+    }
+    if (pView) {
+        pView->offset = viewOffset;
+        pView->size = viewSize;
+        pView->pins = 1;
+        pView->lastUse = ++m_useClock;
+        m_views.push_back(pView);
+    }
+    ReleaseSRWLockExclusive(&m_lock);
+
+    *ppView = pView;
+    return hr;
+}
+
+void MappedFileSource::ReleaseView(View* pView)
+{
+    AcquireSRWLockExclusive(&m_lock);
+    --pView->pins;
+    ReleaseSRWLockExclusive(&m_lock);
+}
+
+void MappedFileSource::Prefetch(QWORD offset, QWORD size)
+{
+    PrefetchVirtualMemoryFn pfnPrefetch = GetPrefetchVirtualMemory();
+    if (!pfnPrefetch || offset >= m_size)
+        return;
+
+    // Within the view holding the start; the rest is brought in by the reads themselves
+    View* pView = nullptr;
+    if (FAILED(AcquireView(offset, &pView)))
+        return;
+    const QWORD inView = offset - pView->offset;
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = pView->pBase + inView;
+    range.NumberOfBytes = static_cast<SIZE_T>(std::min(size, pView->size - inView));
+    pfnPrefetch(GetCurrentProcess(), 1, &range, 0);
+    ReleaseView(pView);
+}
+
+void MappedFileSource::PrefetchIndex()
+{
+    // Walks the top-level MP4 boxes: the sample tables may sit after the media data, far from the header
+    QWORD offset = 0;
+    for (int box = 0; box < kMaxIndexBoxes && offset + 8 <= m_size; ++box) {
+        BYTE header[16];
+        ULONG cbRead = 0;
+        if (FAILED(CopyOut(offset, header, sizeof(header), &cbRead)) || cbRead < 8)
+            return;
+        for (int i = 4; i < 8; ++i) {
+            if (header[i] < 0x20 || header[i] > 0x7e)
+                return;     // Not an ISO base media file
+        }
+
+        QWORD boxSize = ReadBigEndian32(header);
+        if (boxSize == 1) {
+            if (cbRead < 16)
+                return;
+            boxSize = (static_cast<QWORD>(ReadBigEndian32(header + 8)) << 32) | ReadBigEndian32(header + 12);
+        } else if (boxSize == 0) {
+            boxSize = m_size - offset;
+        }
+        if (boxSize < 8 || boxSize > m_size - offset)
+            return;
+
+        if (!memcmp(header + 4, "moov", 4) || !memcmp(header + 4, "sidx", 4) || !memcmp(header + 4, "mfra", 4))
+            Prefetch(offset, std::min(boxSize, kMaxIndexPrefetchBytes));
+        offset += boxSize;
+    }
+}
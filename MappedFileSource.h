@@ -0,0 +1,69 @@
+#pragma once
+
+#include <windows.h>
+#include <atomic>
+#include <vector>
+#include "SharedByteSource.h"
+
+/**
+ * @brief Local file read through a file mapping, shared by the readers of one media.
+ *
+ * Reads are copies out of the mapped pages, so the container parser's small reads cost no system call, and
+ * pages already cached by the OS are not read again. Files up to kWholeFileViewLimit are mapped at once; larger
+ * ones through a few sliding kViewSize views. The pages of the container index (MP4 moov, sidx, mfra), those
+ * ahead of the last read and those after a seek are prefetched with PrefetchVirtualMemory where available
+ * (Windows 8 and later). Thread safe.
+ */
+class MappedFileSource : public SharedByteSource {
+public:
+    static constexpr QWORD kWholeFileViewLimit = 1ULL << 30;
+    static constexpr QWORD kViewSize = 64ULL * 1024 * 1024;     // Multiple of the allocation granularity
+    static constexpr size_t kMaxViews = 4;
+    static constexpr QWORD kReadAheadBytes = 8ULL * 1024 * 1024;
+    static constexpr QWORD kSeekPrefetchBytes = 4ULL * 1024 * 1024;
+
+    /**
+     * @brief Maps a file for reading.
+     * @param path Local path of the file (not a file:// URL).
+     * @param ppSource Receives the source with one reference.
+     * @return S_OK on success, or an error code (empty files cannot be mapped).
+     */
+    static HRESULT Create(const wchar_t* path, MappedFileSource** ppSource);
+
+    HRESULT Read(QWORD offset, BYTE* pBuffer, ULONG cb, ULONG* pcbRead) override;
+    QWORD GetLength() const override { return m_size; }
+    DWORD GetCapabilities() const override { return MFBYTESTREAM_IS_READABLE | MFBYTESTREAM_IS_SEEKABLE; }
+    void OnSeek(QWORD previousPosition, QWORD position) override;
+    void GetStats(StreamCacheStats* pStats) const override;
+
+private:
+    struct View {
+        QWORD offset = 0;
+        QWORD size = 0;
+        BYTE* pBase = nullptr;
+        UINT32 pins = 0;            // Readers copying out of the view
+        UINT64 lastUse = 0;
+    };
+
+    explicit MappedFileSource(const wchar_t* path);
+    ~MappedFileSource() override;
+
+    HRESULT Initialize(const wchar_t* path);
+    HRESULT CopyOut(QWORD offset, BYTE* pBuffer, ULONG cb, ULONG* pcbRead);
+    HRESULT AcquireView(QWORD offset, View** ppView);
+    void ReleaseView(View* pView);
+    void Prefetch(QWORD offset, QWORD size);
+    void PrefetchIndex();
+
+    HANDLE m_hFile = INVALID_HANDLE_VALUE;
+    HANDLE m_hMapping = nullptr;
+    QWORD m_size = 0;
+
+    // Mapped views, under m_lock; a single one covering the whole file below kWholeFileViewLimit
+    SRWLOCK m_lock = SRWLOCK_INIT;
+    std::vector<View*> m_views;
+    UINT64 m_useClock = 0;
+
+    std::atomic<QWORD> m_prefetchedUpTo{0};     // End of the sequential prefetch window
+    std::atomic<UINT64> m_bytesRead{0};
+};
@@ -1,7 +1,11 @@
 #include "MediaFoundationManager.h"
+#include "DecodeScheduler.h"
+#include "AudioMixer.h"
+#include "PlayerMetrics.h"
 #include <mfidl.h>
 #include <mfreadwrite.h>
 #include <dxgi.h>
+#include <vector>
 
 namespace MediaFoundation {
 
@@ -10,9 +14,89 @@ static bool g_bMFInitialized = false;
 static ID3D11Device* g_pD3DDevice = nullptr;
 static IMFDXGIDeviceManager* g_pDXGIDeviceManager = nullptr;
 static UINT32 g_dwResetToken = 0;
+static volatile LONG g_deviceGeneration = 0;
+static SRWLOCK g_sharedDeviceLock = SRWLOCK_INIT;
 static IMMDeviceEnumerator* g_pEnumerator = nullptr;
+static DecodeScheduler* g_pDecodeScheduler = nullptr;
+static INIT_ONCE g_decodeSchedulerOnce = INIT_ONCE_STATIC_INIT;
+static AudioMixer* g_pAudioMixer = nullptr;
+static INIT_ONCE g_audioMixerOnce = INIT_ONCE_STATIC_INIT;
 static int g_instanceCount = 0;
 
+// Device pool: one slot per hardware adapter, keeping the devices of closed instances for reuse
+struct AdapterSlot {
+    IDXGIAdapter1* pAdapter = nullptr;
+    DXGI_ADAPTER_DESC1 desc = {};
+    UINT32 activeDevices = 0;
+    std::vector<VideoDevice*> idleDevices;
+};
+constexpr size_t kMaxIdleDevicesPerAdapter = 2;
+static SRWLOCK g_devicePoolLock = SRWLOCK_INIT;
+static std::vector<AdapterSlot> g_adapters;
+static bool g_bAdaptersEnumerated = false;
+
+// Creates a hardware device with video support, on the given adapter or the default one
+static HRESULT CreateVideoCapableDevice(IDXGIAdapter* pAdapter, ID3D11Device** ppDevice) {
+    HRESULT hr = D3D11CreateDevice(pAdapter, pAdapter ? D3D_DRIVER_TYPE_UNKNOWN : D3D_DRIVER_TYPE_HARDWARE, nullptr,
+                                  D3D11_CREATE_DEVICE_VIDEO_SUPPORT, nullptr, 0,
+                                  D3D11_SDK_VERSION, ppDevice, nullptr, nullptr);
+    if (FAILED(hr))
+        return hr;
+
+    // Decoders run on Media Foundation threads while the application copies frames out
+    ID3D10Multithread* pMultithread = nullptr;
+    if (SUCCEEDED((*ppDevice)->QueryInterface(__uuidof(ID3D10Multithread), reinterpret_cast<void**>(&pMultithread)))) {
+        pMultithread->SetMultithreadProtected(TRUE);
+        pMultithread->Release();
+    }
+    return hr;
+}
+
+static bool IsDeviceRemoved(ID3D11Device* pDevice) {
+    return FAILED(pDevice->GetDeviceRemovedReason());
+}
+
+static void DestroyVideoDevice(VideoDevice* pDevice) {
+    if (pDevice->pDeviceManager) pDevice->pDeviceManager->Release();
+    if (pDevice->pDevice) pDevice->pDevice->Release();
+    delete pDevice;
+}
+
+// Lists the hardware adapters once; WARP is left out since it has no video decoder. Caller holds the pool lock.
+static void EnumerateAdapters() {
+    if (g_bAdaptersEnumerated)
+        return;
+    g_bAdaptersEnumerated = true;
+
+    IDXGIFactory1* pFactory = nullptr;
+    if (FAILED(CreateDXGIFactory1(IID_PPV_ARGS(&pFactory))))
+        return;
+    IDXGIAdapter1* pAdapter = nullptr;
+    for (UINT i = 0; pFactory->EnumAdapters1(i, &pAdapter) != DXGI_ERROR_NOT_FOUND; ++i) {
+        AdapterSlot slot;
+        pAdapter->GetDesc1(&slot.desc);
+        if (slot.desc.Flags & DXGI_ADAPTER_FLAG_SOFTWARE) {
+            pAdapter->Release();
+            continue;
+        }
+        slot.pAdapter = pAdapter;
+        g_adapters.push_back(slot);
+    }
+    pFactory->Release();
+}
+
+static void ReleaseDevicePool() {
+    AcquireSRWLockExclusive(&g_devicePoolLock);
+    for (AdapterSlot& slot : g_adapters) {
+        for (VideoDevice* pDevice : slot.idleDevices)
+            DestroyVideoDevice(pDevice);
+        slot.pAdapter->Release();
+    }
+    g_adapters.clear();
+    g_bAdaptersEnumerated = false;
+    ReleaseSRWLockExclusive(&g_devicePoolLock);
+}
+
 HRESULT Initialize() {
     if (g_bMFInitialized)
         return OP_E_ALREADY_INITIALIZED;
@@ -41,6 +125,7 @@ HRESULT Initialize() {
         return hr;
     }
 
+    PlayerMetrics::RegisterTraceProvider();
     g_bMFInitialized = true;
     return S_OK;
 }
@@ -51,7 +136,18 @@ HRESULT Shutdown() {
 
     HRESULT hr = S_OK;
 
+    // Stop the shared decode workers
+    delete g_pDecodeScheduler;
+    g_pDecodeScheduler = nullptr;
+    InitOnceInitialize(&g_decodeSchedulerOnce);
+
+    // Close the shared audio stream
+    delete g_pAudioMixer;
+    g_pAudioMixer = nullptr;
+    InitOnceInitialize(&g_audioMixerOnce);
+
     // Release DXGI and D3D resources
+    ReleaseDevicePool();
     if (g_pDXGIDeviceManager) {
         g_pDXGIDeviceManager->Release();
         g_pDXGIDeviceManager = nullptr;
@@ -70,6 +166,7 @@ HRESULT Shutdown() {
 
     // Shutdown Media Foundation last
     if (g_bMFInitialized) {
+        PlayerMetrics::UnregisterTraceProvider();
         hr = MFShutdown();
         g_bMFInitialized = false;
     }
@@ -80,29 +177,169 @@ HRESULT Shutdown() {
 }
 
 HRESULT CreateDX11Device() {
-    HRESULT hr = D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr,
-                                  D3D11_CREATE_DEVICE_VIDEO_SUPPORT, nullptr, 0,
-                                  D3D11_SDK_VERSION, &g_pD3DDevice, nullptr, nullptr);
-    if (FAILED(hr))
-        return hr;
-    
-    ID3D10Multithread* pMultithread = nullptr;
-    if (SUCCEEDED(g_pD3DDevice->QueryInterface(__uuidof(ID3D10Multithread), reinterpret_cast<void**>(&pMultithread)))) {
-        pMultithread->SetMultithreadProtected(TRUE);
-        pMultithread->Release();
-    }
-    
-    return hr;
+    return CreateVideoCapableDevice(nullptr, &g_pD3DDevice);
 }
 
 ID3D11Device* GetD3DDevice() {
-    return g_pD3DDevice;
+    AcquireSRWLockShared(&g_sharedDeviceLock);
+    ID3D11Device* pDevice = g_pD3DDevice;
+    if (pDevice) pDevice->AddRef();
+    ReleaseSRWLockShared(&g_sharedDeviceLock);
+    return pDevice;
 }
 
 IMFDXGIDeviceManager* GetDXGIDeviceManager() {
     return g_pDXGIDeviceManager;
 }
 
+LONG GetDeviceGeneration() {
+    return InterlockedCompareExchange(&g_deviceGeneration, 0, 0);
+}
+
+HRESULT RecoverSharedDevice(LONG observedGeneration) {
+    if (!g_pDXGIDeviceManager)
+        return OP_E_NOT_INITIALIZED;
+
+    AcquireSRWLockExclusive(&g_sharedDeviceLock);
+    // Another instance got here first, or the reader failed for another reason
+    if (observedGeneration != g_deviceGeneration || (g_pD3DDevice && !IsDeviceRemoved(g_pD3DDevice))) {
+        ReleaseSRWLockExclusive(&g_sharedDeviceLock);
+        return S_OK;
+    }
+
+    ID3D11Device* pNewDevice = nullptr;
+    HRESULT hr = CreateVideoCapableDevice(nullptr, &pNewDevice);
+    if (SUCCEEDED(hr))
+        hr = g_pDXGIDeviceManager->ResetDevice(pNewDevice, g_dwResetToken);
+    if (SUCCEEDED(hr)) {
+        // Readers see the new generation before the old device goes; textures and the references
+        // handed out by GetD3DDevice keep it alive until they are released
+        InterlockedIncrement(&g_deviceGeneration);
+        ID3D11Device* pOldDevice = g_pD3DDevice;
+        g_pD3DDevice = pNewDevice;
+        pNewDevice = nullptr;
+        if (pOldDevice) pOldDevice->Release();
+    }
+    if (pNewDevice) pNewDevice->Release();
+    ReleaseSRWLockExclusive(&g_sharedDeviceLock);
+    return hr;
+}
+
+UINT32 GetAdapterCount() {
+    AcquireSRWLockExclusive(&g_devicePoolLock);
+    EnumerateAdapters();
+    const auto count = static_cast<UINT32>(g_adapters.size());
+    ReleaseSRWLockExclusive(&g_devicePoolLock);
+    return count;
+}
+
+HRESULT GetAdapterInfo(UINT32 adapterIndex, DXGI_ADAPTER_DESC1* pDesc, UINT32* pActiveDevices) {
+    if (!pDesc)
+        return OP_E_INVALID_PARAMETER;
+
+    AcquireSRWLockExclusive(&g_devicePoolLock);
+    EnumerateAdapters();
+    HRESULT hr = OP_E_INVALID_PARAMETER;
+    if (adapterIndex < g_adapters.size()) {
+        *pDesc = g_adapters[adapterIndex].desc;
+        if (pActiveDevices) *pActiveDevices = g_adapters[adapterIndex].activeDevices;
+        hr = S_OK;
+    }
+    ReleaseSRWLockExclusive(&g_devicePoolLock);
+    return hr;
+}
+
+HRESULT AcquireVideoDevice(INT32 adapterIndex, VideoDevice** ppDevice) {
+    if (!ppDevice)
+        return OP_E_INVALID_PARAMETER;
+    *ppDevice = nullptr;
+
+    AcquireSRWLockExclusive(&g_devicePoolLock);
+    EnumerateAdapters();
+    if (g_adapters.empty() || adapterIndex >= static_cast<INT32>(g_adapters.size()) || adapterIndex < -1) {
+        ReleaseSRWLockExclusive(&g_devicePoolLock);
+        return OP_E_INVALID_PARAMETER;
+    }
+
+    // Balance on the number of devices in use; each one carries a decoder of its own
+    UINT32 index = 0;
+    if (adapterIndex >= 0) {
+        index = static_cast<UINT32>(adapterIndex);
+    } else {
+        for (UINT32 i = 1; i < g_adapters.size(); ++i)
+            if (g_adapters[i].activeDevices < g_adapters[index].activeDevices)
+                index = i;
+    }
+
+    AdapterSlot& slot = g_adapters[index];
+    ++slot.activeDevices;
+    VideoDevice* pDevice = nullptr;
+    std::vector<VideoDevice*> removedDevices;
+    while (!pDevice && !slot.idleDevices.empty()) {
+        pDevice = slot.idleDevices.back();
+        slot.idleDevices.pop_back();
+        // Idle devices can be removed as well while nobody decodes on them
+        if (IsDeviceRemoved(pDevice->pDevice)) {
+            removedDevices.push_back(pDevice);
+            pDevice = nullptr;
+        }
+    }
+    IDXGIAdapter1* pAdapter = slot.pAdapter;
+    pAdapter->AddRef();
+    ReleaseSRWLockExclusive(&g_devicePoolLock);
+
+    for (VideoDevice* pRemoved : removedDevices)
+        DestroyVideoDevice(pRemoved);
+
+    // Device creation takes tens of milliseconds; other instances can acquire meanwhile
+    HRESULT hr = S_OK;
+    if (!pDevice) {
+        pDevice = new (std::nothrow) VideoDevice();
+        hr = pDevice ? CreateVideoCapableDevice(pAdapter, &pDevice->pDevice) : E_OUTOFMEMORY;
+        UINT resetToken = 0;
+        if (SUCCEEDED(hr))
+            hr = MFCreateDXGIDeviceManager(&resetToken, &pDevice->pDeviceManager);
+        if (SUCCEEDED(hr))
+            hr = pDevice->pDeviceManager->ResetDevice(pDevice->pDevice, resetToken);
+        if (FAILED(hr) && pDevice) {
+            DestroyVideoDevice(pDevice);
+            pDevice = nullptr;
+        }
+    }
+    pAdapter->Release();
+
+    if (FAILED(hr)) {
+        AcquireSRWLockExclusive(&g_devicePoolLock);
+        --g_adapters[index].activeDevices;
+        ReleaseSRWLockExclusive(&g_devicePoolLock);
+        return hr;
+    }
+
+    pDevice->adapterIndex = index;
+    *ppDevice = pDevice;
+    return S_OK;
+}
+
+void ReleaseVideoDevice(VideoDevice* pDevice) {
+    if (!pDevice)
+        return;
+
+    AcquireSRWLockExclusive(&g_devicePoolLock);
+    bool bKept = false;
+    if (pDevice->adapterIndex < g_adapters.size()) {
+        AdapterSlot& slot = g_adapters[pDevice->adapterIndex];
+        --slot.activeDevices;
+        if (slot.idleDevices.size() < kMaxIdleDevicesPerAdapter && !IsDeviceRemoved(pDevice->pDevice)) {
+            slot.idleDevices.push_back(pDevice);
+            bKept = true;
+        }
+    }
+    ReleaseSRWLockExclusive(&g_devicePoolLock);
+
+    if (!bKept)
+        DestroyVideoDevice(pDevice);
+}
+
 IMMDeviceEnumerator* GetDeviceEnumerator() {
     if (!g_pEnumerator) {
         CoCreateInstance(__uuidof(MMDeviceEnumerator), nullptr, CLSCTX_ALL, 
@@ -111,6 +348,27 @@ IMMDeviceEnumerator* GetDeviceEnumerator() {
     return g_pEnumerator;
 }
 
+// Instances can enable scheduled decoding concurrently; only one of them creates the worker pool
+static BOOL CALLBACK CreateDecodeScheduler(PINIT_ONCE, PVOID, PVOID*) {
+    g_pDecodeScheduler = new (std::nothrow) DecodeScheduler();
+    return g_pDecodeScheduler != nullptr;
+}
+
+DecodeScheduler* GetDecodeScheduler() {
+    InitOnceExecuteOnce(&g_decodeSchedulerOnce, CreateDecodeScheduler, nullptr, nullptr);
+    return g_pDecodeScheduler;
+}
+
+static BOOL CALLBACK CreateAudioMixer(PINIT_ONCE, PVOID, PVOID*) {
+    g_pAudioMixer = new (std::nothrow) AudioMixer();
+    return g_pAudioMixer != nullptr;
+}
+
+AudioMixer* GetAudioMixer() {
+    InitOnceExecuteOnce(&g_audioMixerOnce, CreateAudioMixer, nullptr, nullptr);
+    return g_pAudioMixer;
+}
+
 void IncrementInstanceCount() {
     g_instanceCount++;
 }
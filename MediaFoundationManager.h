@@ -4,8 +4,12 @@
 #include <mfapi.h>
 #include <mfidl.h>
 #include <d3d11.h>
+#include <dxgi.h>
 #include <mmdeviceapi.h>
 
+class DecodeScheduler;
+class AudioMixer;
+
 // Error code definitions
 #define OP_E_NOT_INITIALIZED     ((HRESULT)0x80000001L)
 #define OP_E_ALREADY_INITIALIZED ((HRESULT)0x80000002L)
@@ -13,6 +17,16 @@
 
 namespace MediaFoundation {
 
+/**
+ * @brief D3D11 device of the device pool, with its own DXGI device manager so that decoders on different
+ * devices do not contend on one device lock.
+ */
+struct VideoDevice {
+    ID3D11Device* pDevice = nullptr;
+    IMFDXGIDeviceManager* pDeviceManager = nullptr;
+    UINT32 adapterIndex = 0;
+};
+
 /**
  * @brief Initializes Media Foundation, Direct3D11, and the DXGI device manager.
  * @return S_OK on success, or an error code.
@@ -32,8 +46,9 @@ HRESULT Shutdown();
 HRESULT CreateDX11Device();
 
 /**
- * @brief Gets the D3D11 device.
- * @return Pointer to the D3D11 device.
+ * @brief Gets the shared D3D11 device.
+ * @return The device with a reference the caller must release (RecoverSharedDevice may replace it at any time),
+ *         or nullptr before Initialize.
  */
 ID3D11Device* GetD3DDevice();
 
@@ -43,12 +58,70 @@ ID3D11Device* GetD3DDevice();
  */
 IMFDXGIDeviceManager* GetDXGIDeviceManager();
 
+/**
+ * @brief Gets the generation of the shared device, incremented each time RecoverSharedDevice replaces it.
+ * @return Current generation; readers created at an older one decode on a device that is gone.
+ */
+LONG GetDeviceGeneration();
+
+/**
+ * @brief Replaces a removed shared device (TDR, driver update, GPU switch) behind the same DXGI device manager.
+ *
+ * The new device is handed to the manager with ResetDevice, so readers created afterwards decode on it while the
+ * instances are left running; readers created before have to be re-created. Only the first caller for a given
+ * generation replaces the device, the others return at once.
+ * @param observedGeneration Generation the caller's reader was created at.
+ * @return S_OK if the device was replaced, already replaced, or is not actually removed, or an error code.
+ */
+HRESULT RecoverSharedDevice(LONG observedGeneration);
+
+/**
+ * @brief Gets the number of hardware adapters the device pool can place instances on.
+ * @return Number of adapters (0 if they cannot be enumerated).
+ */
+UINT32 GetAdapterCount();
+
+/**
+ * @brief Describes an adapter of the device pool.
+ * @param adapterIndex Index of the adapter, below GetAdapterCount().
+ * @param pDesc Receives the DXGI description.
+ * @param pActiveDevices Optional, receives the number of devices currently acquired on the adapter.
+ * @return S_OK on success, OP_E_INVALID_PARAMETER for an unknown index.
+ */
+HRESULT GetAdapterInfo(UINT32 adapterIndex, DXGI_ADAPTER_DESC1* pDesc, UINT32* pActiveDevices);
+
+/**
+ * @brief Acquires a device of its own for an instance, reusing a released one when available.
+ * @param adapterIndex Adapter to create the device on, or -1 for the adapter with the fewest active devices.
+ * @param ppDevice Receives the device; give it back with ReleaseVideoDevice.
+ * @return S_OK on success, OP_E_INVALID_PARAMETER for an unknown adapter, or an error code.
+ */
+HRESULT AcquireVideoDevice(INT32 adapterIndex, VideoDevice** ppDevice);
+
+/**
+ * @brief Returns a device to the pool.
+ * @param pDevice Device obtained from AcquireVideoDevice (nullptr is ignored).
+ */
+void ReleaseVideoDevice(VideoDevice* pDevice);
+
 /**
  * @brief Gets the device enumerator for audio devices.
  * @return Pointer to the device enumerator.
  */
 IMMDeviceEnumerator* GetDeviceEnumerator();
 
+/**
+ * @brief Gets the decode scheduler shared by the instances in VIDEO_DECODE_MODE_SCHEDULED, creating it on first use.
+ * @return Pointer to the scheduler, or nullptr if it could not be allocated.
+ */
+DecodeScheduler* GetDecodeScheduler();
+
+/**
+ * @brief Gets the audio mixer shared by the instances that opt into it, creating it on first use.
+ * @return Pointer to the mixer, or nullptr if it could not be allocated.
+ */
+AudioMixer* GetAudioMixer();
+
 /**
  * @brief Increments the instance count.
  */
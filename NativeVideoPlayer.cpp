@@ -4,8 +4,24 @@
 #include "Utils.h"
 #include "MediaFoundationManager.h"
 #include "AudioManager.h"
+#include "AudioMixer.h"
+#include "VideoProcessorManager.h"
+#include "AsyncFrameReader.h"
+#include "DecodeScheduler.h"
+#include "FramePool.h"
+#include "StreamDemuxer.h"
+#include "KeyframeIndex.h"
+#include "ThumbnailExtractor.h"
+#include "ByteStreamCache.h"
+#include "MappedFileSource.h"
 #include <algorithm>
+#include <codecapi.h>
 #include <cstring>
+#include <dxgi1_2.h>
+#include <mferror.h>
+#include <mftransform.h>
+#include <strmif.h>
+#include <string>
 
 using namespace VideoPlayerUtils;
 using namespace MediaFoundation;
@@ -50,10 +66,14 @@ NATIVEVIDEOPLAYER_API HRESULT CreateVideoPlayerInstance(VideoPlayerInstance** pp
 
     // Create audio synchronization event
     pInstance->hAudioReadyEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-    if (!pInstance->hAudioReadyEvent) {
+    pInstance->hAudioStateEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    if (!pInstance->hAudioReadyEvent || !pInstance->hAudioStateEvent) {
+        HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+        if (pInstance->hAudioReadyEvent) CloseHandle(pInstance->hAudioReadyEvent);
+        if (pInstance->hAudioStateEvent) CloseHandle(pInstance->hAudioStateEvent);
         DeleteCriticalSection(&pInstance->csClockSync);
         delete pInstance;
-        return HRESULT_FROM_WIN32(GetLastError());
+        return hr;
     }
 
     // Increment instance count and return the instance
@@ -65,7 +85,13 @@ NATIVEVIDEOPLAYER_API HRESULT CreateVideoPlayerInstance(VideoPlayerInstance** pp
 NATIVEVIDEOPLAYER_API void DestroyVideoPlayerInstance(VideoPlayerInstance* pInstance) {
     if (pInstance) {
         // Ensure all media resources are released
+        CancelPreload(pInstance);
         CloseMedia(pInstance);
+        delete pInstance->pFramePool;
+
+        // Outlives CloseMedia, which a reopen follows
+        if (pInstance->hAudioStateEvent)
+            CloseHandle(pInstance->hAudioStateEvent);
 
         // Delete critical section
         DeleteCriticalSection(&pInstance->csClockSync);
@@ -77,6 +103,417 @@ NATIVEVIDEOPLAYER_API void DestroyVideoPlayerInstance(VideoPlayerInstance* pInst
 }
 
 NATIVEVIDEOPLAYER_API HRESULT OpenMedia(VideoPlayerInstance* pInstance, const wchar_t* url) {
+    return OpenMediaEx(pInstance, url, VIDEO_OUTPUT_FORMAT_RGB32);
+}
+
+static HRESULT OpenMediaInternal(VideoPlayerInstance* pInstance, const wchar_t* url, SharedByteSource* pSource,
+                                 VideoOutputFormat outputFormat, bool bDeferAudio);
+static HRESULT QueryVideoMetadata(const VideoPlayerInstance* pInstance, VideoMetadata* pMetadata);
+static HRESULT CreateAudioReader(VideoPlayerInstance* pInstance, const wchar_t* url, IMFSourceReader** ppReader);
+static HRESULT GetReaderAudioFormat(IMFSourceReader* pReader, WAVEFORMATEX** ppWfx);
+static HRESULT InitAudioOutput(VideoPlayerInstance* pInstance, WAVEFORMATEX* pWfx);
+
+NATIVEVIDEOPLAYER_API HRESULT OpenMediaEx(VideoPlayerInstance* pInstance, const wchar_t* url, VideoOutputFormat outputFormat) {
+    return OpenMediaInternal(pInstance, url, nullptr, outputFormat, false);
+}
+
+NATIVEVIDEOPLAYER_API HRESULT OpenMediaFromByteStream(VideoPlayerInstance* pInstance, IMFByteStream* pByteStream,
+                                                      const wchar_t* pOriginName, VideoOutputFormat outputFormat) {
+    if (!pInstance || !pByteStream)
+        return OP_E_INVALID_PARAMETER;
+
+    // Both readers read the application's stream through views of one cache, so it is read once
+    ByteStreamCache* pCache = nullptr;
+    HRESULT hr = ByteStreamCache::Create(pByteStream, std::wstring(), pOriginName ? pOriginName : L"",
+                                         pInstance->streamCacheBytes, pInstance->streamReadAheadBytes, &pCache);
+    if (FAILED(hr))
+        return hr;
+    hr = OpenMediaInternal(pInstance, L"", pCache, outputFormat, false);
+    pCache->Release();
+    return hr;
+}
+
+// State handed to the background open thread
+struct DeferredOpenContext {
+    VideoPlayerInstance* pInstance;
+    std::wstring url;
+    MediaReadyCallback callback;
+    void* pUserData;
+};
+
+// Finishes a deferred open: audio reader, WASAPI, audio thread and metadata probing
+static DWORD WINAPI DeferredOpenThreadProc(LPVOID lpParam) {
+    auto* pContext = static_cast<DeferredOpenContext*>(lpParam);
+    VideoPlayerInstance* pInstance = pContext->pInstance;
+
+    const bool bComInitialized = SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+
+    // The reader and the format are set up on their own, then published at once below
+    HRESULT hrAudio = S_OK;
+    IMFSourceReader* pAudioReader = nullptr;
+    WAVEFORMATEX* pWfx = nullptr;
+    if (!pInstance->bOpenCancelled && pInstance->mediaPacingMode != PACING_MODE_UNPACED) {
+        hrAudio = CreateAudioReader(pInstance, pContext->url.c_str(), &pAudioReader);
+        if (SUCCEEDED(hrAudio))
+            hrAudio = GetReaderAudioFormat(pAudioReader, &pWfx);
+        if (SUCCEEDED(hrAudio)) {
+            // Video may already have moved on (or been seeked); join it where the clock is
+            MFTIME clockTime = 0;
+            if (pInstance->pPresentationClock && SUCCEEDED(pInstance->pPresentationClock->GetTime(&clockTime)) && clockTime > 0) {
+                PROPVARIANT var;
+                PropVariantInit(&var);
+                var.vt = VT_I8;
+                var.hVal.QuadPart = clockTime;
+                pAudioReader->SetCurrentPosition(GUID_NULL, var);
+                PropVariantClear(&var);
+            }
+        }
+    }
+
+    // Seeks, volume and playback state changes read the audio state under the same lock
+    if (pWfx && !pInstance->bOpenCancelled) {
+        EnterCriticalSection(&pInstance->csClockSync);
+        hrAudio = InitAudioOutput(pInstance, pWfx);
+        pWfx = nullptr;
+        if (SUCCEEDED(hrAudio)) {
+            pInstance->pSourceReaderAudio = pAudioReader;
+            pAudioReader = nullptr;
+        }
+        LeaveCriticalSection(&pInstance->csClockSync);
+        if (FAILED(hrAudio)) {
+            PrintHR("InitWASAPI failed", hrAudio);
+        }
+    }
+    if (pWfx)
+        CoTaskMemFree(pWfx);
+    if (pAudioReader)
+        pAudioReader->Release();
+
+    if (pInstance->bHasAudio && pInstance->bAudioInitialized && !pInstance->bOpenCancelled) {
+        hrAudio = StartAudioThread(pInstance);
+        if (FAILED(hrAudio)) {
+            PrintHR("StartAudioThread failed", hrAudio);
+        }
+
+        // Catch up with a SetPlaybackState(TRUE) issued while audio was being set up
+        EnterCriticalSection(&pInstance->csClockSync);
+        if (pInstance->llPlaybackStartTime != 0 && pInstance->llPauseStart == 0)
+            StartAudioOutput(pInstance);
+        LeaveCriticalSection(&pInstance->csClockSync);
+    }
+
+    // Probe metadata once so that GetVideoMetadata does not have to
+    if (!pInstance->bOpenCancelled && SUCCEEDED(QueryVideoMetadata(pInstance, &pInstance->cachedMetadata)))
+        pInstance->bMetadataCached = TRUE;
+
+    if (bComInitialized)
+        CoUninitialize();
+
+    // Audio failures leave a playable video-only media
+    pInstance->hrOpenStatus = pInstance->bOpenCancelled ? MF_E_SHUTDOWN : S_OK;
+    SetEvent(pInstance->hMediaReadyEvent);
+    if (pContext->callback && !pInstance->bOpenCancelled)
+        pContext->callback(pInstance, pInstance->hrOpenStatus, pContext->pUserData);
+
+    delete pContext;
+    return 0;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT OpenMediaDeferred(VideoPlayerInstance* pInstance, const wchar_t* url, VideoOutputFormat outputFormat,
+                                                MediaReadyCallback callback, void* pUserData) {
+    HRESULT hr = OpenMediaInternal(pInstance, url, nullptr, outputFormat, true);
+    if (FAILED(hr))
+        return hr;
+
+    // The video opened above is closed again when the background open cannot be started
+    auto* pContext = new (std::nothrow) DeferredOpenContext{ pInstance, url, callback, pUserData };
+    if (!pContext) {
+        CloseMedia(pInstance);
+        return E_OUTOFMEMORY;
+    }
+
+    pInstance->hMediaReadyEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    if (!pInstance->hMediaReadyEvent) {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        delete pContext;
+        CloseMedia(pInstance);
+        return hr;
+    }
+
+    pInstance->bOpenCancelled = FALSE;
+    pInstance->hrOpenStatus = E_PENDING;
+    pInstance->hOpenThread = CreateThread(nullptr, 0, DeferredOpenThreadProc, pContext, 0, nullptr);
+    if (!pInstance->hOpenThread) {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        delete pContext;
+        CloseMedia(pInstance);
+        return hr;
+    }
+    return S_OK;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT WaitForMediaReady(VideoPlayerInstance* pInstance, DWORD dwTimeoutMs) {
+    if (!pInstance)
+        return OP_E_INVALID_PARAMETER;
+    if (!pInstance->pSourceReader)
+        return OP_E_NOT_INITIALIZED;
+    if (!pInstance->hMediaReadyEvent)
+        return S_OK;
+
+    DWORD dwWait = WaitForSingleObject(pInstance->hMediaReadyEvent, dwTimeoutMs);
+    if (dwWait == WAIT_TIMEOUT)
+        return S_FALSE;
+    if (dwWait != WAIT_OBJECT_0)
+        return HRESULT_FROM_WIN32(GetLastError());
+    return pInstance->hrOpenStatus;
+}
+
+// Lets a deferred open finish before what it is setting up is torn down or replaced
+static void WaitForDeferredOpen(VideoPlayerInstance* pInstance) {
+    if (pInstance->hOpenThread) {
+        pInstance->bOpenCancelled = TRUE;
+        WaitForSingleObject(pInstance->hOpenThread, INFINITE);
+        CloseHandle(pInstance->hOpenThread);
+        pInstance->hOpenThread = nullptr;
+    }
+}
+
+// Maps an output format onto the Media Foundation subtype requested from the source reader
+static const GUID& GetSubtypeForOutputFormat(VideoOutputFormat format) {
+    switch (format) {
+        case VIDEO_OUTPUT_FORMAT_NV12: return MFVideoFormat_NV12;
+        case VIDEO_OUTPUT_FORMAT_P010: return MFVideoFormat_P010;
+        default:                       return MFVideoFormat_RGB32;
+    }
+}
+
+// Asks the source reader to decode the video stream to the given format
+static HRESULT SetVideoOutputType(IMFSourceReader* pReader, VideoOutputFormat format, UINT32 width = 0, UINT32 height = 0) {
+    IMFMediaType* pType = nullptr;
+    HRESULT hr = MFCreateMediaType(&pType);
+    if (SUCCEEDED(hr)) {
+        hr = pType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video);
+        if (SUCCEEDED(hr))
+            hr = pType->SetGUID(MF_MT_SUBTYPE, GetSubtypeForOutputFormat(format));
+        // An explicit frame size makes the video processor scale on the GPU
+        if (SUCCEEDED(hr) && width && height) {
+            hr = MFSetAttributeSize(pType, MF_MT_FRAME_SIZE, width, height);
+            if (SUCCEEDED(hr))
+                hr = MFSetAttributeRatio(pType, MF_MT_PIXEL_ASPECT_RATIO, 1, 1);
+        }
+        if (SUCCEEDED(hr))
+            hr = pReader->SetCurrentMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, nullptr, pType);
+        pType->Release();
+    }
+    return hr;
+}
+
+// Device the instance decodes on, with a reference the caller must release (the shared one can be replaced
+// by a recovery on another thread)
+static ID3D11Device* GetInstanceDevice(const VideoPlayerInstance* pInstance) {
+    if (!pInstance->pGpuDevice)
+        return GetD3DDevice();
+    pInstance->pGpuDevice->pDevice->AddRef();
+    return pInstance->pGpuDevice->pDevice;
+}
+
+// Caches the size, frame rate and stride of the negotiated video output type
+static HRESULT RefreshVideoStreamInfo(VideoPlayerInstance* pInstance) {
+    IMFMediaType* pCurrent = nullptr;
+    HRESULT hr = pInstance->pSourceReader->GetCurrentMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, &pCurrent);
+    if (FAILED(hr))
+        return hr;
+
+    hr = MFGetAttributeSize(pCurrent, MF_MT_FRAME_SIZE, &pInstance->videoWidth, &pInstance->videoHeight);
+
+    UINT32 num = 0, denom = 0;
+    if (SUCCEEDED(MFGetAttributeRatio(pCurrent, MF_MT_FRAME_RATE, &num, &denom)) && num && denom) {
+        pInstance->frameRateNum = num;
+        pInstance->frameRateDenom = denom;
+    } else {
+        pInstance->frameRateNum = 0;
+        pInstance->frameRateDenom = 1;
+    }
+
+    // Uncompressed types may leave the stride out; it then follows from the subtype and the width
+    UINT32 stride = 0;
+    GUID subtype = GUID_NULL;
+    LONG computedStride = 0;
+    if (SUCCEEDED(pCurrent->GetUINT32(MF_MT_DEFAULT_STRIDE, &stride)))
+        pInstance->videoStride = static_cast<LONG>(stride);
+    else if (SUCCEEDED(pCurrent->GetGUID(MF_MT_SUBTYPE, &subtype)) &&
+             SUCCEEDED(MFGetStrideForBitmapInfoHeader(subtype.Data1, pInstance->videoWidth, &computedStride)))
+        pInstance->videoStride = computedStride;
+    else
+        pInstance->videoStride = 0;
+
+    pCurrent->Release();
+    return hr;
+}
+
+// Caches the media duration from the presentation descriptor of the media source
+static void CacheMediaDuration(VideoPlayerInstance* pInstance) {
+    pInstance->llMediaDuration = -1;
+    IMFPresentationDescriptor* pPresentationDescriptor = nullptr;
+    if (pInstance->pMediaSource && SUCCEEDED(pInstance->pMediaSource->CreatePresentationDescriptor(&pPresentationDescriptor))) {
+        UINT64 duration = 0;
+        if (SUCCEEDED(pPresentationDescriptor->GetUINT64(MF_PD_DURATION, &duration)))
+            pInstance->llMediaDuration = static_cast<LONGLONG>(duration);
+        pPresentationDescriptor->Release();
+    }
+}
+
+// Negotiates the output type at the size requested with SetOutputSize and updates the delivered frame size.
+// Falls back to the source size if the video processor cannot scale to it.
+static HRESULT ApplyOutputSize(VideoPlayerInstance* pInstance) {
+    const UINT32 requestedWidth = pInstance->requestedOutputWidth;
+    const UINT32 requestedHeight = pInstance->requestedOutputHeight;
+    UINT32 width = 0, height = 0;
+    if (requestedWidth || requestedHeight)
+        ResolveOutputSize(pInstance->sourceWidth, pInstance->sourceHeight, requestedWidth, requestedHeight, &width, &height);
+
+    HRESULT hr = SetVideoOutputType(pInstance->pSourceReader, pInstance->actualOutputFormat, width, height);
+    if (FAILED(hr) && width) {
+        PrintHR("Failed to scale video output, using the source size", hr);
+        hr = SetVideoOutputType(pInstance->pSourceReader, pInstance->actualOutputFormat);
+    }
+    if (FAILED(hr))
+        return hr;
+
+    return RefreshVideoStreamInfo(pInstance);
+}
+
+// Asks the source reader to decode the first audio stream to PCM 16-bit stereo 48kHz
+static HRESULT SetAudioOutputType(IMFSourceReader* pReader) {
+    IMFMediaType* pWantedType = nullptr;
+    HRESULT hr = MFCreateMediaType(&pWantedType);
+    if (SUCCEEDED(hr)) {
+        pWantedType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Audio);
+        pWantedType->SetGUID(MF_MT_SUBTYPE, MFAudioFormat_PCM);
+        pWantedType->SetUINT32(MF_MT_AUDIO_NUM_CHANNELS, 2);
+        pWantedType->SetUINT32(MF_MT_AUDIO_SAMPLES_PER_SECOND, 48000);
+        pWantedType->SetUINT32(MF_MT_AUDIO_BLOCK_ALIGNMENT, 4);
+        pWantedType->SetUINT32(MF_MT_AUDIO_AVG_BYTES_PER_SECOND, 192000);
+        pWantedType->SetUINT32(MF_MT_AUDIO_BITS_PER_SAMPLE, 16);
+        hr = pReader->SetCurrentMediaType(MF_SOURCE_READER_FIRST_AUDIO_STREAM, nullptr, pWantedType);
+        pWantedType->Release();
+    }
+    return hr;
+}
+
+// Initialises WASAPI with an audio format and keeps it as the source format; takes ownership of pWfx.
+// A media being preloaded only keeps the format: its output is opened, or the current one kept, at the switch.
+static HRESULT InitAudioOutput(VideoPlayerInstance* pInstance, WAVEFORMATEX* pWfx) {
+    HRESULT hr = pInstance->bPreloading ? S_OK : InitWASAPI(pInstance, pWfx);
+    if (FAILED(hr)) {
+        CoTaskMemFree(pWfx);
+        return hr;
+    }
+
+    if (pInstance->pSourceAudioFormat)
+        CoTaskMemFree(pInstance->pSourceAudioFormat);
+    pInstance->pSourceAudioFormat = pWfx;
+    pInstance->bHasAudio = TRUE;
+    return S_OK;
+}
+
+// Gets the audio format negotiated on the reader; the caller frees it with CoTaskMemFree
+static HRESULT GetReaderAudioFormat(IMFSourceReader* pReader, WAVEFORMATEX** ppWfx) {
+    IMFMediaType* pActualType = nullptr;
+    HRESULT hr = pReader->GetCurrentMediaType(MF_SOURCE_READER_FIRST_AUDIO_STREAM, &pActualType);
+    if (FAILED(hr))
+        return hr;
+
+    UINT32 size = 0;
+    hr = MFCreateWaveFormatExFromMFMediaType(pActualType, ppWfx, &size);
+    pActualType->Release();
+    return hr;
+}
+
+// Initialises WASAPI with the audio format negotiated on the reader
+static HRESULT InitAudioFromReader(VideoPlayerInstance* pInstance, IMFSourceReader* pReader) {
+    WAVEFORMATEX* pWfx = nullptr;
+    HRESULT hr = GetReaderAudioFormat(pReader, &pWfx);
+    if (FAILED(hr))
+        return hr;
+
+    return InitAudioOutput(pInstance, pWfx);
+}
+
+// Creates a reader on the media, through a view of the instance's shared byte source when it has one
+static HRESULT CreateMediaReader(VideoPlayerInstance* pInstance, const wchar_t* url, IMFAttributes* pAttributes,
+                                 IMFSourceReader** ppReader) {
+    if (!pInstance->pByteSource)
+        return MFCreateSourceReaderFromURL(url, pAttributes, ppReader);
+
+    IMFByteStream* pStream = nullptr;
+    HRESULT hr = pInstance->pByteSource->CreateView(&pStream);
+    if (FAILED(hr))
+        return hr;
+    hr = MFCreateSourceReaderFromByteStream(pStream, pAttributes, ppReader);
+    pStream->Release();
+    return hr;
+}
+
+// Lets the video decoder of the reader run a worker thread per logical processor
+static void MaximizeDecoderThreads(IMFSourceReader* pReader) {
+    IMFSourceReaderEx* pReaderEx = nullptr;
+    if (FAILED(pReader->QueryInterface(IID_PPV_ARGS(&pReaderEx))))
+        return;
+
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    for (DWORD index = 0;; ++index) {
+        GUID category = GUID_NULL;
+        IMFTransform* pTransform = nullptr;
+        if (FAILED(pReaderEx->GetTransformForStream(MF_SOURCE_READER_FIRST_VIDEO_STREAM, index, &category, &pTransform)))
+            break;
+        ICodecAPI* pCodecApi = nullptr;
+        if (category == MFT_CATEGORY_VIDEO_DECODER && SUCCEEDED(pTransform->QueryInterface(IID_PPV_ARGS(&pCodecApi)))) {
+            VARIANT value = {};
+            value.vt = VT_UI4;
+            value.ulVal = systemInfo.dwNumberOfProcessors;
+            HRESULT hr = pCodecApi->SetValue(&CODECAPI_AVDecNumWorkerThreads, &value);
+            if (FAILED(hr)) {
+                PrintHR("Decoder does not take a worker thread count", hr);
+            }
+            pCodecApi->Release();
+        }
+        pTransform->Release();
+        if (category == MFT_CATEGORY_VIDEO_DECODER)
+            break;
+    }
+    pReaderEx->Release();
+}
+
+// Opens the dedicated audio-only reader consumed by the audio thread
+static HRESULT CreateAudioReader(VideoPlayerInstance* pInstance, const wchar_t* url, IMFSourceReader** ppReader) {
+    IMFSourceReader* pReader = nullptr;
+    HRESULT hr = CreateMediaReader(pInstance, url, nullptr, &pReader);
+    if (FAILED(hr))
+        return hr;
+
+    // Select only audio stream, in the same format as the main reader
+    hr = pReader->SetStreamSelection(MF_SOURCE_READER_ALL_STREAMS, FALSE);
+    if (SUCCEEDED(hr))
+        hr = pReader->SetStreamSelection(MF_SOURCE_READER_FIRST_AUDIO_STREAM, TRUE);
+    if (SUCCEEDED(hr))
+        hr = SetAudioOutputType(pReader);
+
+    if (FAILED(hr)) {
+        PrintHR("Failed to configure audio source reader", hr);
+        pReader->Release();
+        return hr;
+    }
+
+    *ppReader = pReader;
+    return S_OK;
+}
+
+// Opens the media, from pSource when given (byte streams, device recovery). Network URLs get a cache of their own,
+// local files a mapping. With bDeferAudio the audio stream is left to the background open thread.
+static HRESULT OpenMediaInternal(VideoPlayerInstance* pInstance, const wchar_t* url, SharedByteSource* pSource,
+                                 VideoOutputFormat outputFormat, bool bDeferAudio) {
     // Parameter validation
     if (!pInstance || !url)
         return OP_E_INVALID_PARAMETER;
@@ -87,30 +524,88 @@ NATIVEVIDEOPLAYER_API HRESULT OpenMedia(VideoPlayerInstance* pInstance, const wc
     CloseMedia(pInstance);
     pInstance->bEOF = FALSE;
     pInstance->videoWidth = pInstance->videoHeight = 0;
+    pInstance->sourceWidth = pInstance->sourceHeight = 0;
     pInstance->bHasAudio = FALSE;
+    pInstance->requestedOutputFormat = outputFormat;
+    pInstance->mediaUrl = url;
+    pInstance->mediaPacingMode = pInstance->pacingMode.load();
 
     HRESULT hr = S_OK;
 
+    // Network media is fetched once for both readers, with read-ahead; local files are mapped
+    if (pSource) {
+        pSource->AddRef();
+        pInstance->pByteSource = pSource;
+    } else if (!IsLocalPath(url) && pInstance->streamCacheBytes) {
+        ByteStreamCache* pCache = nullptr;
+        hr = ByteStreamCache::CreateFromUrl(url, pInstance->streamCacheBytes, pInstance->streamReadAheadBytes, &pCache);
+        if (FAILED(hr)) {
+            PrintHR("Stream cache unavailable, reading the URL directly", hr);
+            hr = S_OK;
+        }
+        pInstance->pByteSource = pCache;
+    } else if (IsLocalPath(url) && _wcsnicmp(url, L"file://", 7) != 0 && pInstance->bMemoryMappedIo) {
+        MappedFileSource* pMapped = nullptr;
+        hr = MappedFileSource::Create(url, &pMapped);
+        if (FAILED(hr)) {
+            PrintHR("File mapping unavailable, reading the file directly", hr);
+            hr = S_OK;
+        }
+        pInstance->pByteSource = pMapped;
+    }
+
     // Helper function to safely release COM objects
     auto safeRelease = [](IUnknown* obj) { if (obj) obj->Release(); };
 
     // 1. Configure and open media source with both audio and video streams
     // ------------------------------------------------------------------
     IMFAttributes* pAttributes = nullptr;
-    hr = MFCreateAttributes(&pAttributes, 5);
+    hr = MFCreateAttributes(&pAttributes, 6);
     if (FAILED(hr))
         return hr;
 
+    // In asynchronous mode the reader decodes ahead into the frame queue
+    if (pInstance->decodeMode == VIDEO_DECODE_MODE_ASYNC) {
+        pInstance->pAsyncReader = new (std::nothrow) AsyncFrameReader(pInstance->frameQueueDepth);
+        if (!pInstance->pAsyncReader) {
+            safeRelease(pAttributes);
+            return E_OUTOFMEMORY;
+        }
+        pAttributes->SetUnknown(MF_SOURCE_READER_ASYNC_CALLBACK, pInstance->pAsyncReader);
+    }
+
+    // Decode on a device of the instance's own when an adapter was selected, the shared one otherwise
+    if (pInstance->videoAdapter != VIDEO_ADAPTER_SHARED) {
+        HRESULT hrDevice = AcquireVideoDevice(pInstance->videoAdapter, &pInstance->pGpuDevice);
+        if (FAILED(hrDevice)) {
+            PrintHR("Failed to acquire a video device, using the shared one", hrDevice);
+        }
+    }
+
+    pInstance->deviceGeneration = GetDeviceGeneration();
+
     // Configure attributes for hardware acceleration
     pAttributes->SetUINT32(MF_READWRITE_ENABLE_HARDWARE_TRANSFORMS, TRUE);
     pAttributes->SetUINT32(MF_SOURCE_READER_DISABLE_DXVA, FALSE);
-    pAttributes->SetUnknown(MF_SOURCE_READER_D3D_MANAGER, GetDXGIDeviceManager());
+    pAttributes->SetUnknown(MF_SOURCE_READER_D3D_MANAGER,
+                            pInstance->pGpuDevice ? pInstance->pGpuDevice->pDeviceManager : GetDXGIDeviceManager());
 
     // Enable advanced video processing for better synchronization
     pAttributes->SetUINT32(MF_SOURCE_READER_ENABLE_ADVANCED_VIDEO_PROCESSING, TRUE);
 
+    // Unpaced reads want each frame out of the decoder as soon as it is decoded
+    if (pInstance->mediaPacingMode == PACING_MODE_UNPACED)
+        pAttributes->SetUINT32(MF_LOW_LATENCY, TRUE);
+
     // Create source reader for both audio and video
-    hr = MFCreateSourceReaderFromURL(url, pAttributes, &pInstance->pSourceReader);
+    hr = CreateMediaReader(pInstance, url, pAttributes, &pInstance->pSourceReader);
+    if (FAILED(hr) && pInstance->pByteSource && !pSource) {
+        // Some sources only open from their URL: drop the cache or the mapping set up above and read it directly
+        PrintHR("Failed to open the media through its byte stream, reading it directly", hr);
+        pInstance->pByteSource->Release();
+        pInstance->pByteSource = nullptr;
+        hr = CreateMediaReader(pInstance, url, pAttributes, &pInstance->pSourceReader);
+    }
     safeRelease(pAttributes);
     if (FAILED(hr))
         return hr;
@@ -124,106 +619,69 @@ NATIVEVIDEOPLAYER_API HRESULT OpenMedia(VideoPlayerInstance* pInstance, const wc
     if (FAILED(hr))
         return hr;
 
-    // Configure video format (RGB32)
-    IMFMediaType* pType = nullptr;
-    hr = MFCreateMediaType(&pType);
-    if (SUCCEEDED(hr)) {
-        hr = pType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video);
-        if (SUCCEEDED(hr))
-            hr = pType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_RGB32);
-        if (SUCCEEDED(hr))
-            hr = pInstance->pSourceReader->SetCurrentMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, nullptr, pType);
-        safeRelease(pType);
+    // Configure video format (RGB32, NV12 or P010); 8-bit streams cannot be decoded to P010
+    pInstance->actualOutputFormat = outputFormat;
+    hr = SetVideoOutputType(pInstance->pSourceReader, outputFormat);
+    if (FAILED(hr) && outputFormat == VIDEO_OUTPUT_FORMAT_P010) {
+        pInstance->actualOutputFormat = VIDEO_OUTPUT_FORMAT_NV12;
+        hr = SetVideoOutputType(pInstance->pSourceReader, VIDEO_OUTPUT_FORMAT_NV12);
     }
     if (FAILED(hr))
         return hr;
 
-    // Get video dimensions
+    // Get video dimensions and colour description
     IMFMediaType* pCurrent = nullptr;
     hr = pInstance->pSourceReader->GetCurrentMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, &pCurrent);
     if (SUCCEEDED(hr)) {
-        hr = MFGetAttributeSize(pCurrent, MF_MT_FRAME_SIZE, &pInstance->videoWidth, &pInstance->videoHeight);
+        hr = MFGetAttributeSize(pCurrent, MF_MT_FRAME_SIZE, &pInstance->sourceWidth, &pInstance->sourceHeight);
+        pInstance->videoWidth = pInstance->sourceWidth;
+        pInstance->videoHeight = pInstance->sourceHeight;
+        pInstance->videoTransferFunction = MFGetAttributeUINT32(pCurrent, MF_MT_TRANSFER_FUNCTION, MFVideoTransFunc_Unknown);
+        pInstance->videoPrimaries = MFGetAttributeUINT32(pCurrent, MF_MT_VIDEO_PRIMARIES, MFVideoPrimaries_Unknown);
         safeRelease(pCurrent);
     }
 
+    // Scale in the pipeline if an output size was set
+    InterlockedExchange(&pInstance->bOutputSizeChanged, FALSE);
+    if (SUCCEEDED(hr) && (pInstance->requestedOutputWidth || pInstance->requestedOutputHeight))
+        ApplyOutputSize(pInstance);
+    else if (SUCCEEDED(hr))
+        RefreshVideoStreamInfo(pInstance);
+
+    // Lateness feedback goes to the decoder the reader ended up with
+    pInstance->qualityControl.Attach(pInstance->pSourceReader);
+    if (pInstance->mediaPacingMode == PACING_MODE_UNPACED)
+        MaximizeDecoderThreads(pInstance->pSourceReader);
+
     // 3. Configure audio stream (if available)
     // ------------------------------------------
-    // Try to enable audio stream
-    hr = pInstance->pSourceReader->SetStreamSelection(MF_SOURCE_READER_FIRST_AUDIO_STREAM, TRUE);
-    if (SUCCEEDED(hr)) {
-        // Configure audio format (PCM 16-bit stereo 48kHz)
-        IMFMediaType* pWantedType = nullptr;
-        hr = MFCreateMediaType(&pWantedType);
+    if (bDeferAudio || pInstance->mediaPacingMode == PACING_MODE_UNPACED) {
+        // Audio gets its own reader on the background open thread; unpaced reads have no use for it
+        pInstance->pSourceReader->SetStreamSelection(MF_SOURCE_READER_FIRST_AUDIO_STREAM, FALSE);
+    } else if (SUCCEEDED(pInstance->pSourceReader->SetStreamSelection(MF_SOURCE_READER_FIRST_AUDIO_STREAM, TRUE))) {
+        // Negotiate the audio format on the main reader
+        hr = SetAudioOutputType(pInstance->pSourceReader);
         if (SUCCEEDED(hr)) {
-            pWantedType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Audio);
-            pWantedType->SetGUID(MF_MT_SUBTYPE, MFAudioFormat_PCM);
-            pWantedType->SetUINT32(MF_MT_AUDIO_NUM_CHANNELS, 2);
-            pWantedType->SetUINT32(MF_MT_AUDIO_SAMPLES_PER_SECOND, 48000);
-            pWantedType->SetUINT32(MF_MT_AUDIO_BLOCK_ALIGNMENT, 4);
-            pWantedType->SetUINT32(MF_MT_AUDIO_AVG_BYTES_PER_SECOND, 192000);
-            pWantedType->SetUINT32(MF_MT_AUDIO_BITS_PER_SAMPLE, 16);
-            hr = pInstance->pSourceReader->SetCurrentMediaType(MF_SOURCE_READER_FIRST_AUDIO_STREAM, nullptr, pWantedType);
-            safeRelease(pWantedType);
-        }
-
-        if (SUCCEEDED(hr)) {
-            // Get the actual audio format for WASAPI
-            IMFMediaType* pActualType = nullptr;
-            hr = pInstance->pSourceReader->GetCurrentMediaType(MF_SOURCE_READER_FIRST_AUDIO_STREAM, &pActualType);
-            if (SUCCEEDED(hr) && pActualType) {
-                WAVEFORMATEX* pWfx = nullptr;
-                UINT32 size = 0;
-                hr = MFCreateWaveFormatExFromMFMediaType(pActualType, &pWfx, &size);
-                if (SUCCEEDED(hr) && pWfx) {
-                    hr = InitWASAPI(pInstance, pWfx);
-                    if (FAILED(hr)) {
-                        PrintHR("InitWASAPI failed", hr);
-                        if (pWfx) CoTaskMemFree(pWfx);
-                        safeRelease(pActualType);
-                    } else {
-                        if (pInstance->pSourceAudioFormat)
-                            CoTaskMemFree(pInstance->pSourceAudioFormat);
-                        pInstance->pSourceAudioFormat = pWfx;
-                        pInstance->bHasAudio = TRUE;
-                    }
-                }
-                safeRelease(pActualType);
+            hr = InitAudioFromReader(pInstance, pInstance->pSourceReader);
+            if (FAILED(hr)) {
+                PrintHR("InitWASAPI failed", hr);
             }
         }
 
-        // Create a separate audio source reader for the audio thread
-        // This is needed even with automatic synchronization
-        hr = MFCreateSourceReaderFromURL(url, nullptr, &pInstance->pSourceReaderAudio);
-        if (SUCCEEDED(hr)) {
-            // Select only audio stream
-            hr = pInstance->pSourceReaderAudio->SetStreamSelection(MF_SOURCE_READER_ALL_STREAMS, FALSE);
-            if (SUCCEEDED(hr))
-                hr = pInstance->pSourceReaderAudio->SetStreamSelection(MF_SOURCE_READER_FIRST_AUDIO_STREAM, TRUE);
-
-            if (SUCCEEDED(hr)) {
-                // Configure audio format (same as main reader)
-                IMFMediaType* pWantedAudioType = nullptr;
-                hr = MFCreateMediaType(&pWantedAudioType);
-                if (SUCCEEDED(hr)) {
-                    pWantedAudioType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Audio);
-                    pWantedAudioType->SetGUID(MF_MT_SUBTYPE, MFAudioFormat_PCM);
-                    pWantedAudioType->SetUINT32(MF_MT_AUDIO_NUM_CHANNELS, 2);
-                    pWantedAudioType->SetUINT32(MF_MT_AUDIO_SAMPLES_PER_SECOND, 48000);
-                    pWantedAudioType->SetUINT32(MF_MT_AUDIO_BLOCK_ALIGNMENT, 4);
-                    pWantedAudioType->SetUINT32(MF_MT_AUDIO_AVG_BYTES_PER_SECOND, 192000);
-                    pWantedAudioType->SetUINT32(MF_MT_AUDIO_BITS_PER_SAMPLE, 16);
-                    hr = pInstance->pSourceReaderAudio->SetCurrentMediaType(MF_SOURCE_READER_FIRST_AUDIO_STREAM, nullptr, pWantedAudioType);
-                    safeRelease(pWantedAudioType);
-                }
-            }
-
+        if (pInstance->bSharedSourceReader && pInstance->decodeMode == VIDEO_DECODE_MODE_SYNC) {
+            // Audio is demuxed from the main reader (see step 5); drop the stream if it cannot be played
+            if (!pInstance->bHasAudio)
+                pInstance->pSourceReader->SetStreamSelection(MF_SOURCE_READER_FIRST_AUDIO_STREAM, FALSE);
+        } else {
+            // Create a separate audio source reader for the audio thread
+            // This is needed even with automatic synchronization
+            hr = CreateAudioReader(pInstance, url, &pInstance->pSourceReaderAudio);
             if (FAILED(hr)) {
-                PrintHR("Failed to configure audio source reader", hr);
-                safeRelease(pInstance->pSourceReaderAudio);
-                pInstance->pSourceReaderAudio = nullptr;
+                PrintHR("Failed to create audio source reader", hr);
             }
-        } else {
-            PrintHR("Failed to create audio source reader", hr);
+
+            // The main reader only feeds video; an unread audio stream would keep queuing samples
+            pInstance->pSourceReader->SetStreamSelection(MF_SOURCE_READER_FIRST_AUDIO_STREAM, FALSE);
         }
     }
 
@@ -236,6 +694,8 @@ NATIVEVIDEOPLAYER_API HRESULT OpenMedia(VideoPlayerInstance* pInstance, const wc
         IID_PPV_ARGS(&pInstance->pMediaSource));
 
     if (SUCCEEDED(hr)) {
+        CacheMediaDuration(pInstance);
+
         // Create the presentation clock
         hr = MFCreatePresentationClock(&pInstance->pPresentationClock);
         if (SUCCEEDED(hr)) {
@@ -283,134 +743,1267 @@ NATIVEVIDEOPLAYER_API HRESULT OpenMedia(VideoPlayerInstance* pInstance, const wc
         }
     }
 
-    // 5. Start audio thread for both manual and automatic synchronization
+    // 5. Start the demux thread when audio and video share the main reader
+    // ----------------------------------------------------
+    if (pInstance->bSharedSourceReader && pInstance->decodeMode == VIDEO_DECODE_MODE_SYNC) {
+        pInstance->pDemuxer = new (std::nothrow) StreamDemuxer(pInstance->pSourceReader);
+        if (!pInstance->pDemuxer)
+            return E_OUTOFMEMORY;
+        hr = pInstance->pDemuxer->Start();
+        if (FAILED(hr)) {
+            PrintHR("Failed to start demux thread", hr);
+            return hr;
+        }
+    }
+
+    // 6. Start audio thread for both manual and automatic synchronization
     // ----------------------------------------------------
-    if (pInstance->bHasAudio && pInstance->bAudioInitialized && pInstance->pSourceReaderAudio) {
+    if (pInstance->bHasAudio && pInstance->bAudioInitialized && (pInstance->pSourceReaderAudio || pInstance->pDemuxer)) {
         hr = StartAudioThread(pInstance);
         if (FAILED(hr)) {
             PrintHR("StartAudioThread failed", hr);
         }
     }
 
+    // 7. Start decoding ahead in asynchronous or scheduled mode
+    // ----------------------------------------------------
+    if (pInstance->pAsyncReader) {
+        pInstance->pAsyncReader->SetReader(pInstance->pSourceReader);
+        pInstance->pFrameProducer = pInstance->pAsyncReader;
+    } else if (pInstance->decodeMode == VIDEO_DECODE_MODE_SCHEDULED) {
+        DecodeScheduler* pScheduler = GetDecodeScheduler();
+        if (!pScheduler)
+            return E_OUTOFMEMORY;
+        pInstance->pDecodeJob = new (std::nothrow) DecodeJob(pScheduler, pInstance->frameQueueDepth);
+        if (!pInstance->pDecodeJob)
+            return E_OUTOFMEMORY;
+        // Without the clock, deadlines are the frame timestamps: unpaced or externally paced jobs take turns
+        pInstance->pDecodeJob->SetReader(pInstance->pSourceReader,
+                                         pInstance->mediaPacingMode == PACING_MODE_CLOCK ? pInstance->pPresentationClock : nullptr);
+        pInstance->pDecodeJob->SetPriority(pInstance->decodePriority, pInstance->maxDecodeFrameRate);
+        hr = pScheduler->Register(pInstance->pDecodeJob);
+        if (FAILED(hr)) {
+            PrintHR("Failed to register with the decode scheduler", hr);
+            return hr;
+        }
+        pInstance->pFrameProducer = pInstance->pDecodeJob;
+    }
+    if (pInstance->pFrameProducer) {
+        hr = pInstance->pFrameProducer->Start();
+        if (FAILED(hr)) {
+            PrintHR("Failed to start decoding ahead", hr);
+            return hr;
+        }
+    }
+
+    return S_OK;
+}
+
+// Stream ticks and gaps make ReadSample return without a sample
+constexpr int kMaxPrerollReads = 8;
+
+// Decodes the first video frame of a preloaded media, handed out by the first read after the switch.
+// Decoding-ahead modes fill their frame queue instead.
+static HRESULT PrerollVideo(VideoPlayerInstance* pInstance) {
+    for (int attempt = 0; attempt < kMaxPrerollReads; ++attempt) {
+        DWORD streamIndex = 0, dwFlags = 0;
+        LONGLONG llTimestamp = 0;
+        IMFSample* pSample = nullptr;
+        HRESULT hr = pInstance->pDemuxer
+            ? pInstance->pDemuxer->Read(StreamDemuxer::kVideo, &dwFlags, &llTimestamp, &pSample)
+            : pInstance->pSourceReader->ReadSample(MF_SOURCE_READER_FIRST_VIDEO_STREAM, 0, &streamIndex, &dwFlags, &llTimestamp, &pSample);
+        if (FAILED(hr))
+            return hr;
+        if (dwFlags & MF_SOURCE_READERF_CURRENTMEDIATYPECHANGED)
+            RefreshVideoStreamInfo(pInstance);
+        if (dwFlags & MF_SOURCE_READERF_ENDOFSTREAM) {
+            if (pSample) pSample->Release();
+            pInstance->bEOF = TRUE;
+            return S_FALSE;
+        }
+        if (pSample) {
+            pInstance->pPrerollSample = pSample;
+            pInstance->llPrerollTimestamp = llTimestamp;
+            return S_OK;
+        }
+    }
+    return S_OK;
+}
+
+// State handed to the preload thread
+struct PreloadContext {
+    VideoPlayerInstance* pStaged;
+    std::wstring url;
+    VideoOutputFormat outputFormat;
+};
+
+// Opens the next media on the staging instance, decodes its first frame and probes its metadata
+static DWORD WINAPI PreloadThreadProc(LPVOID lpParam) {
+    auto* pContext = static_cast<PreloadContext*>(lpParam);
+    VideoPlayerInstance* pStaged = pContext->pStaged;
+
+    const bool bComInitialized = SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+
+    HRESULT hr = OpenMediaInternal(pStaged, pContext->url.c_str(), nullptr, pContext->outputFormat, false);
+    if (SUCCEEDED(hr)) {
+        // The clock starts over from zero at the switch
+        if (pStaged->pPresentationClock)
+            pStaged->pPresentationClock->Stop();
+        if (!pStaged->pFrameProducer) {
+            HRESULT hrPreroll = PrerollVideo(pStaged);
+            if (FAILED(hrPreroll)) {
+                PrintHR("Failed to decode the first frame of the preloaded media", hrPreroll);
+            }
+        }
+        if (SUCCEEDED(QueryVideoMetadata(pStaged, &pStaged->cachedMetadata)))
+            pStaged->bMetadataCached = TRUE;
+    } else {
+        PrintHR("Failed to preload media", hr);
+    }
+    pStaged->hrOpenStatus = hr;
+
+    if (bComInitialized)
+        CoUninitialize();
+
+    delete pContext;
+    return 0;
+}
+
+// Waits for the preload thread and detaches the staging instance from its owner
+static VideoPlayerInstance* TakePreloaded(VideoPlayerInstance* pInstance) {
+    if (pInstance->hPreloadThread) {
+        WaitForSingleObject(pInstance->hPreloadThread, INFINITE);
+        CloseHandle(pInstance->hPreloadThread);
+        pInstance->hPreloadThread = nullptr;
+    }
+    VideoPlayerInstance* pStaged = pInstance->pPreloaded;
+    pInstance->pPreloaded = nullptr;
+    return pStaged;
+}
+
+// Releases a staging instance and the media it holds
+static void DestroyStagingInstance(VideoPlayerInstance* pStaged) {
+    CloseMedia(pStaged);
+    DeleteCriticalSection(&pStaged->csClockSync);
+    delete pStaged;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT PreloadMedia(VideoPlayerInstance* pInstance, const wchar_t* url) {
+    if (!pInstance || !url)
+        return OP_E_INVALID_PARAMETER;
+    if (!IsInitialized())
+        return OP_E_NOT_INITIALIZED;
+
+    // A single media is preloaded at a time
+    CancelPreload(pInstance);
+
+    auto* pStaged = new (std::nothrow) VideoPlayerInstance();
+    if (!pStaged)
+        return E_OUTOFMEMORY;
+    InitializeCriticalSection(&pStaged->csClockSync);
+    pStaged->bPreloading = TRUE;
+    pStaged->hrOpenStatus = E_PENDING;
+
+    // Opened with the settings the next OpenMedia of the instance would use
+    pStaged->requestedOutputWidth = pInstance->requestedOutputWidth.load();
+    pStaged->requestedOutputHeight = pInstance->requestedOutputHeight.load();
+    pStaged->decodeMode = pInstance->decodeMode;
+    pStaged->pacingMode = pInstance->pacingMode.load();
+    pStaged->frameQueueDepth = pInstance->frameQueueDepth;
+    pStaged->decodePriority = pInstance->decodePriority;
+    pStaged->maxDecodeFrameRate = pInstance->maxDecodeFrameRate;
+    pStaged->bSharedSourceReader = pInstance->bSharedSourceReader;
+    pStaged->videoAdapter = pInstance->videoAdapter;
+    pStaged->streamCacheBytes = pInstance->streamCacheBytes;
+    pStaged->streamReadAheadBytes = pInstance->streamReadAheadBytes;
+    pStaged->bMemoryMappedIo = pInstance->bMemoryMappedIo;
+
+    auto* pContext = new (std::nothrow) PreloadContext{ pStaged, url, pInstance->requestedOutputFormat };
+    if (!pContext) {
+        DestroyStagingInstance(pStaged);
+        return E_OUTOFMEMORY;
+    }
+
+    pInstance->pPreloaded = pStaged;
+    pInstance->hPreloadThread = CreateThread(nullptr, 0, PreloadThreadProc, pContext, 0, nullptr);
+    if (!pInstance->hPreloadThread) {
+        HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+        delete pContext;
+        CancelPreload(pInstance);
+        return hr;
+    }
+    return S_OK;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT CancelPreload(VideoPlayerInstance* pInstance) {
+    if (!pInstance)
+        return OP_E_INVALID_PARAMETER;
+    if (VideoPlayerInstance* pStaged = TakePreloaded(pInstance))
+        DestroyStagingInstance(pStaged);
+    return S_OK;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT SwitchToPreloaded(VideoPlayerInstance* pInstance) {
+    if (!pInstance)
+        return OP_E_INVALID_PARAMETER;
+    if (!pInstance->pPreloaded)
+        return OP_E_NOT_INITIALIZED;
+
+    VideoPlayerInstance* pStaged = TakePreloaded(pInstance);
+    if (FAILED(pStaged->hrOpenStatus)) {
+        HRESULT hr = pStaged->hrOpenStatus;
+        DestroyStagingInstance(pStaged);
+        return hr;
+    }
+
+    const bool bPlaying = pInstance->llPlaybackStartTime != 0 && pInstance->llPauseStart == 0;
+    const float speed = pInstance->playbackSpeed;
+
+    // The current media stops feeding the outputs; it is released with the staging instance at the end
+    WaitForDeferredOpen(pInstance);
+    if (pInstance->pDemuxer)
+        pInstance->pDemuxer->Stop();
+    StopAudioThread(pInstance);
+    if (pInstance->pLockedBuffer || pInstance->pTextureSample)
+        UnlockVideoFrame(pInstance);
+    pInstance->qualityControl.Detach();
+    pStaged->qualityControl.Detach();
+
+    // The render stream (or mixer input) is kept when the next media plays in the same format
+    const WAVEFORMATEX* pCurrentFormat = pInstance->pSourceAudioFormat;
+    const WAVEFORMATEX* pNextFormat = pStaged->pSourceAudioFormat;
+    const bool bKeepAudioOutput = pInstance->bAudioInitialized && HasAudioOutput(pInstance) && pStaged->bHasAudio &&
+                                  pCurrentFormat && pNextFormat && pCurrentFormat->cbSize == pNextFormat->cbSize &&
+                                  memcmp(pCurrentFormat, pNextFormat, sizeof(WAVEFORMATEX) + pCurrentFormat->cbSize) == 0;
+
+    // Exchange the media state; the staging instance ends up with the previous media
+    using std::swap;
+    swap(pInstance->pSourceReader, pStaged->pSourceReader);
+    swap(pInstance->videoWidth, pStaged->videoWidth);
+    swap(pInstance->videoHeight, pStaged->videoHeight);
+    swap(pInstance->sourceWidth, pStaged->sourceWidth);
+    swap(pInstance->sourceHeight, pStaged->sourceHeight);
+    pInstance->bEOF = pStaged->bEOF.exchange(pInstance->bEOF);
+    swap(pInstance->actualOutputFormat, pStaged->actualOutputFormat);
+    swap(pInstance->videoTransferFunction, pStaged->videoTransferFunction);
+    swap(pInstance->videoPrimaries, pStaged->videoPrimaries);
+    swap(pInstance->frameRateNum, pStaged->frameRateNum);
+    swap(pInstance->frameRateDenom, pStaged->frameRateDenom);
+    swap(pInstance->videoStride, pStaged->videoStride);
+    swap(pInstance->llMediaDuration, pStaged->llMediaDuration);
+    swap(pInstance->mediaPacingMode, pStaged->mediaPacingMode);
+    swap(pInstance->pAsyncReader, pStaged->pAsyncReader);
+    swap(pInstance->pDecodeJob, pStaged->pDecodeJob);
+    swap(pInstance->pFrameProducer, pStaged->pFrameProducer);
+    swap(pInstance->pDemuxer, pStaged->pDemuxer);
+    swap(pInstance->pGpuDevice, pStaged->pGpuDevice);
+    swap(pInstance->deviceGeneration, pStaged->deviceGeneration);
+    swap(pInstance->pSharedTexture, pStaged->pSharedTexture);
+    swap(pInstance->hSharedTextureHandle, pStaged->hSharedTextureHandle);
+    swap(pInstance->pVideoDevice, pStaged->pVideoDevice);
+    swap(pInstance->pVideoContext, pStaged->pVideoContext);
+    swap(pInstance->pVideoProcessorEnum, pStaged->pVideoProcessorEnum);
+    swap(pInstance->pVideoProcessor, pStaged->pVideoProcessor);
+    swap(pInstance->vpInputWidth, pStaged->vpInputWidth);
+    swap(pInstance->vpInputHeight, pStaged->vpInputHeight);
+    swap(pInstance->vpOutputWidth, pStaged->vpOutputWidth);
+    swap(pInstance->vpOutputHeight, pStaged->vpOutputHeight);
+    swap(pInstance->pSourceReaderAudio, pStaged->pSourceReaderAudio);
+    swap(pInstance->bHasAudio, pStaged->bHasAudio);
+    swap(pInstance->pSourceAudioFormat, pStaged->pSourceAudioFormat);
+    swap(pInstance->pPresentationClock, pStaged->pPresentationClock);
+    swap(pInstance->pMediaSource, pStaged->pMediaSource);
+    swap(pInstance->pByteSource, pStaged->pByteSource);
+    swap(pInstance->mediaUrl, pStaged->mediaUrl);
+    swap(pInstance->pKeyframeIndex, pStaged->pKeyframeIndex);
+    swap(pInstance->hMediaReadyEvent, pStaged->hMediaReadyEvent);
+    swap(pInstance->cachedMetadata, pStaged->cachedMetadata);
+    swap(pInstance->bMetadataCached, pStaged->bMetadataCached);
+    swap(pInstance->pPrerollSample, pStaged->pPrerollSample);
+    swap(pInstance->llPrerollTimestamp, pStaged->llPrerollTimestamp);
+    if (!bKeepAudioOutput) {
+        swap(pInstance->bAudioInitialized, pStaged->bAudioInitialized);
+        swap(pInstance->pAudioClient, pStaged->pAudioClient);
+        swap(pInstance->bExclusiveAudio, pStaged->bExclusiveAudio);
+        swap(pInstance->pRenderClient, pStaged->pRenderClient);
+        swap(pInstance->pDevice, pStaged->pDevice);
+        swap(pInstance->pAudioEndpointVolume, pStaged->pAudioEndpointVolume);
+        swap(pInstance->pAudioClock, pStaged->pAudioClock);
+        swap(pInstance->audioClockFrequency, pStaged->audioClockFrequency);
+        swap(pInstance->hAudioSamplesReadyEvent, pStaged->hAudioSamplesReadyEvent);
+        swap(pInstance->pMixerSource, pStaged->pMixerSource);
+    }
+
+    pInstance->llCurrentPosition = 0;
+    pInstance->llAccurateSeekTarget = -1;
+    pInstance->hrOpenStatus = S_OK;
+    pInstance->metrics.Reset();
+    pInstance->qualityControl.Attach(pInstance->pSourceReader);
+
+    // The tail of the previous media's audio still plays out; the next media starts right after it
+    LONGLONG llAudioTail = 0;
+    if (bKeepAudioOutput) {
+        llAudioTail = ContinueAudioOutput(pInstance);
+    } else if (pInstance->bHasAudio) {
+        WAVEFORMATEX* pWfx = pInstance->pSourceAudioFormat;
+        pInstance->pSourceAudioFormat = nullptr;
+        pInstance->bHasAudio = FALSE;
+        HRESULT hrAudio = InitAudioOutput(pInstance, pWfx);
+        if (FAILED(hrAudio)) {
+            PrintHR("InitWASAPI failed", hrAudio);
+        }
+    }
+    if (pInstance->bHasAudio && pInstance->bAudioInitialized && (pInstance->pSourceReaderAudio || pInstance->pDemuxer)) {
+        HRESULT hrAudio = StartAudioThread(pInstance);
+        if (FAILED(hrAudio)) {
+            PrintHR("StartAudioThread failed", hrAudio);
+        }
+    }
+
+    // Resume in the state the previous media was in
+    if (speed != 1.0f)
+        SetPlaybackSpeed(pInstance, speed);
+    if (bPlaying) {
+        if (pInstance->pPresentationClock) {
+            HRESULT hrClock = pInstance->pPresentationClock->Start(-llAudioTail);
+            if (FAILED(hrClock)) {
+                PrintHR("Failed to start presentation clock", hrClock);
+            }
+        }
+        EnterCriticalSection(&pInstance->csClockSync);
+        if (HasAudioOutput(pInstance) && pInstance->bAudioInitialized)
+            StartAudioOutput(pInstance);
+        LeaveCriticalSection(&pInstance->csClockSync);
+    }
+    WakeAudioThread(pInstance);
+
+    DestroyStagingInstance(pStaged);
+    return S_OK;
+}
+
+// Locks the sample's contiguous buffer and keeps it as the instance's current frame.
+// Takes ownership of the sample reference.
+static HRESULT LockSampleBuffer(VideoPlayerInstance* pInstance, IMFSample* pSample, BYTE** pData, DWORD* pDataSize) {
+    const LONGLONG lockStart = PlayerMetrics::Now();
+    IMFMediaBuffer* pBuffer = nullptr;
+    HRESULT hr = pSample->ConvertToContiguousBuffer(&pBuffer);
+    if (FAILED(hr)) {
+        PrintHR("ConvertToContiguousBuffer failed", hr);
+        pSample->Release();
+        return hr;
+    }
+
+    BYTE* pBytes = nullptr;
+    DWORD cbMax = 0, cbCurr = 0;
+    hr = pBuffer->Lock(&pBytes, &cbMax, &cbCurr);
+    if (FAILED(hr)) {
+        PrintHR("Buffer->Lock failed", hr);
+        pBuffer->Release();
+        pSample->Release();
+        return hr;
+    }
+
+    pInstance->pLockedBuffer = pBuffer;
+    pInstance->pLockedBytes = pBytes;
+    pInstance->lockedMaxSize = cbMax;
+    pInstance->lockedCurrSize = cbCurr;
+    *pData = pBytes;
+    *pDataSize = cbCurr;
+    pSample->Release();
+    pInstance->metrics.Record(PlayerMetrics::kVideoLock, PlayerMetrics::MicrosecondsSince(lockStart));
+    return S_OK;
+}
+
+// Nominal frame duration in 100-ns, from the frame rate (60 fps when unknown)
+static LONGLONG GetFrameDuration(const VideoPlayerInstance* pInstance) {
+    if (!pInstance->frameRateNum)
+        return 10'000'000 / 60;
+    return static_cast<LONGLONG>(10'000'000) * pInstance->frameRateDenom / pInstance->frameRateNum;
+}
+
+// Current master time: the played audio position in CLOCK_MODE_AUDIO, the presentation clock otherwise
+static HRESULT GetMasterClockTime(VideoPlayerInstance* pInstance, MFTIME* pTime) {
+    if (pInstance->clockMode == CLOCK_MODE_AUDIO && AudioManager::GetAudioClockTime(pInstance, pTime))
+        return S_OK;
+    if (!pInstance->pPresentationClock)
+        return MF_E_NO_CLOCK;
+    return pInstance->pPresentationClock->GetTime(pTime);
+}
+
+// Time frames are paced against: the master clock, or the time last given to SetPresentationTime
+static HRESULT GetPacingTime(VideoPlayerInstance* pInstance, MFTIME* pTime) {
+    if (pInstance->mediaPacingMode == PACING_MODE_EXTERNAL) {
+        *pTime = pInstance->llExternalTime;
+        return S_OK;
+    }
+    return GetMasterClockTime(pInstance, pTime);
+}
+
+// Pops the frame due at llTime from the asynchronous frame queue, discarding older ones; with bEveryFrame,
+// pops the oldest frame whatever its time. Returns S_FALSE at end of stream. On S_OK, *ppSample is null
+// when no new frame is due.
+static HRESULT AcquireQueuedSample(VideoPlayerInstance* pInstance, LONGLONG llTime, bool bEveryFrame,
+                                   IMFSample** ppSample, LONGLONG* pTimestamp) {
+    *ppSample = nullptr;
+    *pTimestamp = 0;
+
+    if (pInstance->bEOF)
+        return S_FALSE;
+
+    FrameProducer* pReader = pInstance->pFrameProducer;
+    FrameQueue& queue = pReader->Queue();
+    const LONGLONG llFrameDuration = GetFrameDuration(pInstance);
+
+    // Drop frames that are superseded by a later frame which is already due
+    bool bConsumed = false;
+    for (const QueuedFrame* pNext = queue.Peek(1); !bEveryFrame && pNext && pNext->timestamp <= llTime; pNext = queue.Peek(1)) {
+        QueuedFrame stale;
+        queue.Pop(&stale);
+        if (stale.flags & MF_SOURCE_READERF_CURRENTMEDIATYPECHANGED)
+            RefreshVideoStreamInfo(pInstance);
+        pInstance->qualityControl.OnFrameDropped(stale.timestamp, llTime - stale.timestamp, llFrameDuration);
+        if (stale.pSample) stale.pSample->Release();
+        bConsumed = true;
+    }
+
+    const QueuedFrame* pFront = queue.Peek();
+    if (!pFront || (!bEveryFrame && pFront->timestamp > llTime)) {
+        if (bConsumed)
+            pReader->NotifyConsumed();
+        if (!pFront) {
+            if (pReader->IsEndOfStream()) {
+                pInstance->bEOF = TRUE;
+                return S_FALSE;
+            }
+            return pReader->GetStatus();
+        }
+        return S_OK;
+    }
+
+    QueuedFrame frame;
+    queue.Pop(&frame);
+    pReader->NotifyConsumed();
+    if (frame.flags & MF_SOURCE_READERF_CURRENTMEDIATYPECHANGED)
+        RefreshVideoStreamInfo(pInstance);
+    if (!bEveryFrame)
+        pInstance->qualityControl.OnFramePresented(frame.timestamp, llTime - frame.timestamp, llFrameDuration);
+    pInstance->metrics.Record(PlayerMetrics::kVideoDecode, frame.decodeUs);
+    pInstance->metrics.Increment(PlayerMetrics::kVideoFrames);
+
+    pInstance->llCurrentPosition = frame.timestamp;
+    *ppSample = frame.pSample;
+    *pTimestamp = frame.timestamp;
+    return S_OK;
+}
+
+// True when the device the reader decodes on was removed, or replaced after another instance saw it removed
+static bool IsVideoDeviceLost(const VideoPlayerInstance* pInstance) {
+    if (!pInstance->pGpuDevice && pInstance->deviceGeneration != GetDeviceGeneration())
+        return true;
+    ID3D11Device* pDevice = GetInstanceDevice(pInstance);
+    if (!pDevice)
+        return false;
+    const bool bRemoved = FAILED(pDevice->GetDeviceRemovedReason());
+    pDevice->Release();
+    return bRemoved;
+}
+
+// Re-creates the readers of an instance whose device was lost, at the position and in the state it was in.
+// The shared device is replaced first, once for all the instances decoding on it.
+static HRESULT RecoverVideoDevice(VideoPlayerInstance* pInstance) {
+    ID3D11Device* pLostDevice = GetInstanceDevice(pInstance);
+    PrintHR("Video device lost, reopening the media", pLostDevice ? pLostDevice->GetDeviceRemovedReason() : S_OK);
+    if (pLostDevice) pLostDevice->Release();
+    if (!pInstance->pGpuDevice) {
+        HRESULT hr = RecoverSharedDevice(pInstance->deviceGeneration);
+        if (FAILED(hr)) {
+            PrintHR("Failed to recreate the shared device", hr);
+            return hr;
+        }
+    }
+
+    const std::wstring url = pInstance->mediaUrl;
+    const LONGLONG llPosition = pInstance->llCurrentPosition;
+    const float speed = pInstance->playbackSpeed;
+    const bool bPlaying = pInstance->llPlaybackStartTime != 0 && pInstance->llPauseStart == 0;
+
+    // Reopening from the shared source keeps what was already fetched
+    SharedByteSource* pSource = pInstance->pByteSource;
+    if (pSource) pSource->AddRef();
+    HRESULT hr = OpenMediaInternal(pInstance, url.c_str(), pSource, pInstance->requestedOutputFormat, false);
+    if (pSource) pSource->Release();
+    if (FAILED(hr)) {
+        PrintHR("Failed to reopen the media after a device loss", hr);
+        return hr;
+    }
+    if (llPosition > 0)
+        SeekMediaEx(pInstance, llPosition, SEEK_MODE_ACCURATE);
+    if (speed != 1.0f)
+        SetPlaybackSpeed(pInstance, speed);
+    if (bPlaying)
+        SetPlaybackState(pInstance, TRUE, FALSE);
+    return S_OK;
+}
+
+// Reads the next video sample and paces it against the presentation clock.
+// Returns S_FALSE at end of stream. On S_OK, *ppSample is null when no frame is
+// due (decoder starved or the frame was too late and has been skipped).
+static HRESULT DecodeNextVideoSample(VideoPlayerInstance* pInstance, IMFSample** ppSample, LONGLONG* pTimestamp) {
+    *ppSample = nullptr;
+    *pTimestamp = 0;
+
+    if (pInstance->bEOF)
+        return S_FALSE;
+
+    // Renegotiate the output size on the reading thread; frames already decoded ahead at the old size are dropped.
+    // Audio demuxed from the same reader stays queued, so resizing does not leave a gap in the sound.
+    if (InterlockedExchange(&pInstance->bOutputSizeChanged, FALSE)) {
+        if (pInstance->pPrerollSample) {
+            pInstance->pPrerollSample->Release();
+            pInstance->pPrerollSample = nullptr;
+        }
+        if (pInstance->pFrameProducer)
+            pInstance->pFrameProducer->Flush();
+        if (pInstance->pDemuxer)
+            pInstance->pDemuxer->FlushStream(StreamDemuxer::kVideo);
+        HRESULT hrSize = ApplyOutputSize(pInstance);
+        if (FAILED(hrSize)) {
+            PrintHR("Failed to apply output size", hrSize);
+        }
+        if (pInstance->pFrameProducer) {
+            // The flush dropped the decoder's reference frames: restart from the keyframe before the current
+            // position instead of decoding the rest of the GOP without them
+            PROPVARIANT var;
+            PropVariantInit(&var);
+            var.vt = VT_I8;
+            var.hVal.QuadPart = pInstance->llCurrentPosition;
+            HRESULT hrSeek = pInstance->pSourceReader->SetCurrentPosition(GUID_NULL, var);
+            if (FAILED(hrSeek)) {
+                PrintHR("Failed to reposition the reader after resizing", hrSeek);
+            }
+            PropVariantClear(&var);
+        }
+        pInstance->qualityControl.Attach(pInstance->pSourceReader);
+        if (pInstance->pDemuxer)
+            pInstance->pDemuxer->Resume();
+        if (pInstance->pFrameProducer)
+            pInstance->pFrameProducer->Start();
+    }
+
+    // Asynchronous and scheduled modes never block: take whatever frame is due at the clock
+    if (pInstance->pFrameProducer) {
+        MFTIME pacingTime = 0;
+        const bool bEveryFrame = pInstance->mediaPacingMode == PACING_MODE_UNPACED;
+        if (!bEveryFrame)
+            GetPacingTime(pInstance, &pacingTime);
+        return AcquireQueuedSample(pInstance, pacingTime, bEveryFrame, ppSample, pTimestamp);
+    }
+
+    DWORD streamIndex = 0, dwFlags = 0;
+    LONGLONG llTimestamp = 0;
+    IMFSample* pSample = nullptr;
+    HRESULT hr = S_OK;
+    for (;;) {
+        if (pInstance->pPrerollSample) {
+            // First frame, decoded while the media was preloaded
+            pSample = pInstance->pPrerollSample;
+            llTimestamp = pInstance->llPrerollTimestamp;
+            pInstance->pPrerollSample = nullptr;
+        } else {
+            const LONGLONG decodeStart = PlayerMetrics::Now();
+            hr = pInstance->pDemuxer
+                ? pInstance->pDemuxer->Read(StreamDemuxer::kVideo, &dwFlags, &llTimestamp, &pSample)
+                : pInstance->pSourceReader->ReadSample(MF_SOURCE_READER_FIRST_VIDEO_STREAM, 0, &streamIndex, &dwFlags, &llTimestamp, &pSample);
+            if (FAILED(hr))
+                return hr;
+            if (pSample)
+                pInstance->metrics.Record(PlayerMetrics::kVideoDecode, PlayerMetrics::MicrosecondsSince(decodeStart));
+        }
+
+        // The decoder renegotiated its output (resolution or stride change): frames from here on use the new type
+        if (dwFlags & MF_SOURCE_READERF_CURRENTMEDIATYPECHANGED)
+            RefreshVideoStreamInfo(pInstance);
+
+        if (dwFlags & MF_SOURCE_READERF_ENDOFSTREAM) {
+            pInstance->bEOF = TRUE;
+            if (pSample) pSample->Release();
+            return S_FALSE;
+        }
+
+        if (!pSample)
+            return S_OK;
+
+        // After an accurate seek, decode forward to the target and drop earlier frames without locking them
+        if (pInstance->llAccurateSeekTarget < 0)
+            break;
+        LONGLONG llDuration = 0;
+        pSample->GetSampleDuration(&llDuration);
+        if (llTimestamp + std::max(llDuration, 1LL) > pInstance->llAccurateSeekTarget) {
+            pInstance->llAccurateSeekTarget = -1;
+            break;
+        }
+        pSample->Release();
+        pSample = nullptr;
+    }
+
+    // Store current position
+    pInstance->llCurrentPosition = llTimestamp;
+
+    // Automatic synchronization with presentation clock (or the caller's time), unless every frame is wanted
+    if (pInstance->mediaPacingMode != PACING_MODE_UNPACED) {
+        // With automatic synchronization, the presentation clock handles timing
+        // We need to check if we should skip very late frames or wait for early frames
+
+        // Get current presentation time
+        MFTIME clockTime = 0;
+        hr = GetPacingTime(pInstance, &clockTime);
+
+        if (SUCCEEDED(hr)) {
+            // Calculate frame rate for skip threshold
+            const LONGLONG llFrameDuration = GetFrameDuration(pInstance);
+            double frameTimeMs = llFrameDuration / 10000.0;
+            auto skipThreshold = -llFrameDuration * 3;
+
+            // The presentation clock's rate already accounts for playback speed
+
+            // Calculate difference between frame timestamp and clock
+            LONGLONG diff = llTimestamp - clockTime;
+
+            // If frame is very late, skip it; the decoder is told to drop frames before decoding them
+            // if this keeps happening
+            if (diff < skipThreshold) {
+                pInstance->qualityControl.OnFrameDropped(llTimestamp, -diff, llFrameDuration);
+                pSample->Release();
+                return S_OK;
+            }
+            pInstance->qualityControl.OnFramePresented(llTimestamp, -diff, llFrameDuration);
+            // If frame is ahead of schedule, wait to maintain correct frame rate; the caller's time does not
+            // advance while its thread waits here
+            if (diff > 0 && pInstance->mediaPacingMode == PACING_MODE_CLOCK) {
+                // Convert diff from 100ns units to milliseconds and apply playback speed
+                double waitTime = diff / 10000.0;
+                // Limit maximum wait time to avoid freezing if timestamps are far apart
+                waitTime = std::min(waitTime, frameTimeMs * 2);
+                if (waitTime > 1.0) {
+                    const double lateMs = PreciseSleepHighRes(waitTime);
+                    pInstance->metrics.Record(PlayerMetrics::kPacingError, static_cast<UINT64>(lateMs * 1000.0));
+                }
+            }
+        }
+    }
+
+    pInstance->metrics.Increment(PlayerMetrics::kVideoFrames);
+    *ppSample = pSample;
+    *pTimestamp = llTimestamp;
+    return S_OK;
+}
+
+// Reads the next frame, reopening the media first if the device was lost (TDR, driver update, GPU switch).
+// Returns S_OK without a sample after a recovery; frames follow from the position the instance was at.
+static HRESULT ReadNextVideoSample(VideoPlayerInstance* pInstance, IMFSample** ppSample, LONGLONG* pTimestamp) {
+    if (IsVideoDeviceLost(pInstance)) {
+        *ppSample = nullptr;
+        *pTimestamp = 0;
+        return RecoverVideoDevice(pInstance);
+    }
+
+    HRESULT hr = DecodeNextVideoSample(pInstance, ppSample, pTimestamp);
+    if (FAILED(hr) && IsVideoDeviceLost(pInstance))
+        hr = RecoverVideoDevice(pInstance);
+    return hr;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT ReadVideoFrame(VideoPlayerInstance* pInstance, BYTE** pData, DWORD* pDataSize) {
+    if (!pInstance || !pInstance->pSourceReader || !pData || !pDataSize)
+        return OP_E_NOT_INITIALIZED;
+
+    if (pInstance->pLockedBuffer || pInstance->pTextureSample)
+        UnlockVideoFrame(pInstance);
+
+    *pData = nullptr;
+    *pDataSize = 0;
+
+    IMFSample* pSample = nullptr;
+    LONGLONG llTimestamp = 0;
+    HRESULT hr = ReadNextVideoSample(pInstance, &pSample, &llTimestamp);
+    if (hr != S_OK || !pSample)
+        return hr;
+
+    return LockSampleBuffer(pInstance, pSample, pData, pDataSize);
+}
+
+// Reads the next frame into *pInfo with the state a frame loop polls (ReadVideoFrameEx and its batch form)
+static HRESULT ReadFrameInfo(VideoPlayerInstance* pInstance, VideoFrameInfo* pInfo) {
+    *pInfo = {};
+    if (!pInstance->pSourceReader)
+        return OP_E_NOT_INITIALIZED;
+
+    if (pInstance->pLockedBuffer || pInstance->pTextureSample)
+        UnlockVideoFrame(pInstance);
+
+    // The read refreshes the stream info when the decoder renegotiates its output
+    const UINT32 previousWidth = pInstance->videoWidth;
+    const UINT32 previousHeight = pInstance->videoHeight;
+    const LONG previousStride = pInstance->videoStride;
+
+    IMFSample* pSample = nullptr;
+    LONGLONG llTimestamp = 0;
+    HRESULT hr = ReadNextVideoSample(pInstance, &pSample, &llTimestamp);
+    if (hr == S_OK && pSample) {
+        pSample->GetSampleDuration(&pInfo->duration);
+        if (MFGetAttributeUINT32(pSample, MFSampleExtension_Discontinuity, FALSE))
+            pInfo->flags |= VIDEO_FRAME_FLAG_DISCONTINUITY;
+        if (pInstance->videoWidth != previousWidth || pInstance->videoHeight != previousHeight ||
+            pInstance->videoStride != previousStride)
+            pInfo->flags |= VIDEO_FRAME_FLAG_FORMAT_CHANGED;
+        hr = LockSampleBuffer(pInstance, pSample, &pInfo->pData, &pInfo->dataSize);
+        if (SUCCEEDED(hr))
+            pInfo->timestamp = llTimestamp;
+        else
+            pInfo->duration = 0;
+    }
+
+    pInfo->stride = pInstance->videoStride;
+    pInfo->width = pInstance->videoWidth;
+    pInfo->height = pInstance->videoHeight;
+    pInfo->position = pInstance->llCurrentPosition;
+    if (pInstance->bEOF)
+        pInfo->flags |= VIDEO_FRAME_FLAG_END_OF_STREAM;
+    pInstance->qualityControl.GetStats(&pInfo->qos);
+    return hr;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT ReadVideoFrameEx(VideoPlayerInstance* pInstance, VideoFrameInfo* pInfo) {
+    if (!pInstance || !pInfo)
+        return OP_E_INVALID_PARAMETER;
+    return ReadFrameInfo(pInstance, pInfo);
+}
+
+NATIVEVIDEOPLAYER_API HRESULT ReadVideoFramesBatch(VideoPlayerInstance** ppInstances, UINT32 count,
+                                                   VideoFrameInfo* pInfos, HRESULT* pResults) {
+    if (!ppInstances || !pInfos || !count)
+        return OP_E_INVALID_PARAMETER;
+
+    UINT32 newFrames = 0;
+    for (UINT32 i = 0; i < count; ++i) {
+        pInfos[i] = {};
+        const HRESULT hr = ppInstances[i] ? ReadFrameInfo(ppInstances[i], &pInfos[i]) : OP_E_INVALID_PARAMETER;
+        if (pResults)
+            pResults[i] = hr;
+        if (hr == S_OK && pInfos[i].pData)
+            ++newFrames;
+    }
+    return newFrames ? S_OK : S_FALSE;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT TryAcquireFrame(VideoPlayerInstance* pInstance, LONGLONG llPresentationTime,
+                                              BYTE** pData, DWORD* pDataSize, LONGLONG* pTimestamp) {
+    if (!pInstance || !pInstance->pSourceReader || !pData || !pDataSize)
+        return OP_E_NOT_INITIALIZED;
+    if (!pInstance->pFrameProducer)
+        return MF_E_INVALIDREQUEST;
+
+    *pData = nullptr;
+    *pDataSize = 0;
+    if (pTimestamp) *pTimestamp = 0;
+
+    if (IsVideoDeviceLost(pInstance)) {
+        HRESULT hr = RecoverVideoDevice(pInstance);
+        return FAILED(hr) ? hr : S_FALSE;
+    }
+
+    IMFSample* pSample = nullptr;
+    LONGLONG llTimestamp = 0;
+    HRESULT hr = AcquireQueuedSample(pInstance, llPresentationTime, false, &pSample, &llTimestamp);
+    if (FAILED(hr) && IsVideoDeviceLost(pInstance)) {
+        hr = RecoverVideoDevice(pInstance);
+        return FAILED(hr) ? hr : S_FALSE;
+    }
+    if (FAILED(hr))
+        return hr;
+    if (!pSample)
+        return S_FALSE;
+
+    // Keep the previous frame locked until a new one replaces it
+    if (pInstance->pLockedBuffer || pInstance->pTextureSample)
+        UnlockVideoFrame(pInstance);
+
+    hr = LockSampleBuffer(pInstance, pSample, pData, pDataSize);
+    if (SUCCEEDED(hr) && pTimestamp)
+        *pTimestamp = llTimestamp;
+    return hr;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT RegisterFramePool(VideoPlayerInstance* pInstance, BYTE** ppBuffers, UINT32 bufferCount,
+                                                DWORD bufferSize, UINT32 pitch) {
+    if (!pInstance || !ppBuffers || bufferCount == 0 || bufferCount > FramePool::kMaxBuffers || !bufferSize || !pitch)
+        return OP_E_INVALID_PARAMETER;
+    for (UINT32 i = 0; i < bufferCount; ++i) {
+        if (!ppBuffers[i])
+            return OP_E_INVALID_PARAMETER;
+    }
+
+    // The buffers of frames still in flight may still be read by the caller
+    if (pInstance->pFramePool && pInstance->pFramePool->HasFramesInFlight())
+        return MF_E_INVALIDREQUEST;
+
+    auto* pPool = new (std::nothrow) FramePool(ppBuffers, bufferCount, bufferSize, pitch);
+    if (!pPool)
+        return E_OUTOFMEMORY;
+
+    delete pInstance->pFramePool;
+    pInstance->pFramePool = pPool;
+    return S_OK;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT UnregisterFramePool(VideoPlayerInstance* pInstance) {
+    if (!pInstance)
+        return OP_E_INVALID_PARAMETER;
+    if (pInstance->pFramePool && pInstance->pFramePool->HasFramesInFlight())
+        return MF_E_INVALIDREQUEST;
+    delete pInstance->pFramePool;
+    pInstance->pFramePool = nullptr;
+    return S_OK;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT ReadVideoFrameToPool(VideoPlayerInstance* pInstance, UINT32* pBufferIndex, LONGLONG* pTimestamp) {
+    if (!pInstance || !pInstance->pSourceReader || !pBufferIndex)
+        return OP_E_NOT_INITIALIZED;
+    if (!pInstance->pFramePool)
+        return MF_E_INVALIDREQUEST;
+
+    *pBufferIndex = UINT32_MAX;
+    if (pTimestamp) *pTimestamp = 0;
+
+    // Reserve the destination first so that no decoded frame is lost when the pool is exhausted
+    UINT32 index = 0;
+    if (!pInstance->pFramePool->Acquire(&index))
+        return MF_E_SAMPLEALLOCATOR_EMPTY;
+
+    IMFSample* pSample = nullptr;
+    LONGLONG llTimestamp = 0;
+    HRESULT hr = ReadNextVideoSample(pInstance, &pSample, &llTimestamp);
+    if (hr != S_OK || !pSample) {
+        pInstance->pFramePool->Release(index);
+        return hr;
+    }
+
+    hr = pInstance->pFramePool->CopySample(index, pSample, pInstance->videoWidth, pInstance->videoHeight,
+                                           pInstance->actualOutputFormat);
+    pSample->Release();
+    if (FAILED(hr)) {
+        PrintHR("Failed to copy frame into pool buffer", hr);
+        pInstance->pFramePool->Release(index);
+        return hr;
+    }
+
+    *pBufferIndex = index;
+    if (pTimestamp) *pTimestamp = llTimestamp;
+    return S_OK;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT ReleasePoolFrame(VideoPlayerInstance* pInstance, UINT32 bufferIndex) {
+    if (!pInstance || !pInstance->pFramePool)
+        return OP_E_INVALID_PARAMETER;
+    return pInstance->pFramePool->Release(bufferIndex) ? S_OK : OP_E_INVALID_PARAMETER;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT ReadVideoFrameTexture(VideoPlayerInstance* pInstance, ID3D11Texture2D** ppTexture,
+                                                    UINT* pSubresource, LONGLONG* pTimestamp) {
+    if (!pInstance || !pInstance->pSourceReader || !ppTexture || !pSubresource)
+        return OP_E_NOT_INITIALIZED;
+
+    if (pInstance->pLockedBuffer || pInstance->pTextureSample)
+        UnlockVideoFrame(pInstance);
+
+    *ppTexture = nullptr;
+    *pSubresource = 0;
+    if (pTimestamp) *pTimestamp = 0;
+
+    IMFSample* pSample = nullptr;
+    LONGLONG llTimestamp = 0;
+    HRESULT hr = ReadNextVideoSample(pInstance, &pSample, &llTimestamp);
+    if (hr != S_OK || !pSample)
+        return hr;
+
+    // The sample stays referenced so the decoder does not recycle the surface
+    // while the caller is still sampling from it.
+    IMFMediaBuffer* pBuffer = nullptr;
+    hr = pSample->GetBufferByIndex(0, &pBuffer);
+    if (SUCCEEDED(hr)) {
+        IMFDXGIBuffer* pDXGIBuffer = nullptr;
+        hr = pBuffer->QueryInterface(IID_PPV_ARGS(&pDXGIBuffer));
+        if (SUCCEEDED(hr)) {
+            ID3D11Texture2D* pTexture = nullptr;
+            hr = pDXGIBuffer->GetResource(IID_PPV_ARGS(&pTexture));
+            if (SUCCEEDED(hr))
+                hr = pDXGIBuffer->GetSubresourceIndex(pSubresource);
+            if (SUCCEEDED(hr)) {
+                // The sample holds a reference for as long as the frame is outstanding
+                pTexture->Release();
+                *ppTexture = pTexture;
+            } else if (pTexture) {
+                pTexture->Release();
+            }
+            pDXGIBuffer->Release();
+        } else {
+            PrintHR("Sample is not backed by a DXGI surface", hr);
+        }
+        pBuffer->Release();
+    }
+
+    if (FAILED(hr)) {
+        pSample->Release();
+        *pSubresource = 0;
+        return hr;
+    }
+
+    pInstance->pTextureSample = pSample;
+    if (pTimestamp) *pTimestamp = llTimestamp;
+    return S_OK;
+}
+
+// Keyed mutex handshake on the shareable texture (see ReadVideoFrameSharedHandle)
+constexpr UINT64 kSharedTextureWriteKey = 0;
+constexpr UINT64 kSharedTextureReadKey = 1;
+constexpr DWORD kSharedTextureTimeoutMs = 100;
+
+// Copies a decoded frame into the instance's shareable texture, (re)creating it on the frame's device as needed
+static HRESULT CopyToSharedTexture(VideoPlayerInstance* pInstance, ID3D11Device* pDevice, ID3D11Texture2D* pTexture,
+                                   UINT subresource) {
+    HRESULT hr = S_OK;
+    D3D11_TEXTURE2D_DESC srcDesc = {};
+    pTexture->GetDesc(&srcDesc);
+
+    // (Re)create the shareable texture when the decoded surface changes shape
+    if (pInstance->pSharedTexture) {
+        D3D11_TEXTURE2D_DESC dstDesc = {};
+        pInstance->pSharedTexture->GetDesc(&dstDesc);
+        if (dstDesc.Width != srcDesc.Width || dstDesc.Height != srcDesc.Height || dstDesc.Format != srcDesc.Format) {
+            if (pInstance->hSharedTextureHandle) {
+                CloseHandle(pInstance->hSharedTextureHandle);
+                pInstance->hSharedTextureHandle = nullptr;
+            }
+            pInstance->pSharedTexture->Release();
+            pInstance->pSharedTexture = nullptr;
+        }
+    }
+
+    if (!pInstance->pSharedTexture) {
+        D3D11_TEXTURE2D_DESC desc = {};
+        desc.Width = srcDesc.Width;
+        desc.Height = srcDesc.Height;
+        desc.MipLevels = 1;
+        desc.ArraySize = 1;
+        desc.Format = srcDesc.Format;
+        desc.SampleDesc.Count = 1;
+        desc.Usage = D3D11_USAGE_DEFAULT;
+        desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+        desc.MiscFlags = D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX | D3D11_RESOURCE_MISC_SHARED_NTHANDLE;
+
+        hr = pDevice->CreateTexture2D(&desc, nullptr, &pInstance->pSharedTexture);
+        if (FAILED(hr)) {
+            PrintHR("Failed to create shared texture", hr);
+            return hr;
+        }
+
+        IDXGIResource1* pResource = nullptr;
+        hr = pInstance->pSharedTexture->QueryInterface(IID_PPV_ARGS(&pResource));
+        if (SUCCEEDED(hr)) {
+            hr = pResource->CreateSharedHandle(nullptr, DXGI_SHARED_RESOURCE_READ, nullptr,
+                                               &pInstance->hSharedTextureHandle);
+            pResource->Release();
+        }
+        if (FAILED(hr)) {
+            PrintHR("Failed to create shared texture handle", hr);
+            pInstance->pSharedTexture->Release();
+            pInstance->pSharedTexture = nullptr;
+            return hr;
+        }
+    }
+
+    // The consumer hands the texture back with kSharedTextureWriteKey once it is done reading the previous frame
+    IDXGIKeyedMutex* pMutex = nullptr;
+    hr = pInstance->pSharedTexture->QueryInterface(IID_PPV_ARGS(&pMutex));
+    if (FAILED(hr))
+        return hr;
+    hr = pMutex->AcquireSync(kSharedTextureWriteKey, kSharedTextureTimeoutMs);
+    if (hr != S_OK) {
+        pMutex->Release();
+        return hr == static_cast<HRESULT>(WAIT_TIMEOUT) ? HRESULT_FROM_WIN32(WAIT_TIMEOUT) : hr;
+    }
+
+    // GPU-to-GPU copy out of the decoder pool; no system memory round trip. Releasing the mutex submits
+    // the copy, and the consumer's AcquireSync on kSharedTextureReadKey waits for it to complete.
+    ID3D11DeviceContext* pContext = nullptr;
+    pDevice->GetImmediateContext(&pContext);
+    pContext->CopySubresourceRegion(pInstance->pSharedTexture, 0, 0, 0, 0, pTexture, subresource, nullptr);
+    pContext->Release();
+    pMutex->ReleaseSync(kSharedTextureReadKey);
+    pMutex->Release();
     return S_OK;
 }
 
-NATIVEVIDEOPLAYER_API HRESULT ReadVideoFrame(VideoPlayerInstance* pInstance, BYTE** pData, DWORD* pDataSize) {
-    if (!pInstance || !pInstance->pSourceReader || !pData || !pDataSize)
-        return OP_E_NOT_INITIALIZED;
+NATIVEVIDEOPLAYER_API HRESULT ReadVideoFrameSharedHandle(VideoPlayerInstance* pInstance, HANDLE* pSharedHandle, LONGLONG* pTimestamp) {
+    if (!pInstance || !pSharedHandle)
+        return OP_E_INVALID_PARAMETER;
 
-    if (pInstance->pLockedBuffer)
-        UnlockVideoFrame(pInstance);
+    *pSharedHandle = nullptr;
 
-    if (pInstance->bEOF) {
-        *pData = nullptr;
-        *pDataSize = 0;
-        return S_FALSE;
-    }
+    ID3D11Texture2D* pTexture = nullptr;
+    UINT subresource = 0;
+    HRESULT hr = ReadVideoFrameTexture(pInstance, &pTexture, &subresource, pTimestamp);
+    if (hr != S_OK || !pTexture)
+        return hr;
 
-    DWORD streamIndex = 0, dwFlags = 0;
-    LONGLONG llTimestamp = 0;
-    IMFSample* pSample = nullptr;
-    HRESULT hr = pInstance->pSourceReader->ReadSample(MF_SOURCE_READER_FIRST_VIDEO_STREAM, 0, &streamIndex, &dwFlags, &llTimestamp, &pSample);
+    // The device the frame was decoded on, referenced: a recovery elsewhere may replace the shared one meanwhile
+    ID3D11Device* pDevice = nullptr;
+    pTexture->GetDevice(&pDevice);
+    hr = CopyToSharedTexture(pInstance, pDevice, pTexture, subresource);
+    pDevice->Release();
     if (FAILED(hr))
         return hr;
 
-    if (dwFlags & MF_SOURCE_READERF_ENDOFSTREAM) {
-        pInstance->bEOF = TRUE;
-        if (pSample) pSample->Release();
-        *pData = nullptr;
-        *pDataSize = 0;
-        return S_FALSE;
+    *pSharedHandle = pInstance->hSharedTextureHandle;
+    return S_OK;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT UnlockVideoFrame(VideoPlayerInstance* pInstance) {
+    if (!pInstance)
+        return E_INVALIDARG;
+    if (pInstance->pLockedBuffer) {
+        pInstance->pLockedBuffer->Unlock();
+        pInstance->pLockedBuffer->Release();
+        pInstance->pLockedBuffer = nullptr;
+    }
+    if (pInstance->pTextureSample) {
+        pInstance->pTextureSample->Release();
+        pInstance->pTextureSample = nullptr;
     }
+    pInstance->pLockedBytes = nullptr;
+    pInstance->lockedMaxSize = pInstance->lockedCurrSize = 0;
+    return S_OK;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT ConvertVideoFrameToTexture(VideoPlayerInstance* pInstance, ID3D11Texture2D* pDestTexture) {
+    if (!pInstance || !pDestTexture)
+        return OP_E_INVALID_PARAMETER;
+    if (!pInstance->pTextureSample)
+        return S_FALSE;
+
+    IMFMediaBuffer* pBuffer = nullptr;
+    HRESULT hr = pInstance->pTextureSample->GetBufferByIndex(0, &pBuffer);
+    if (FAILED(hr))
+        return hr;
 
-    if (!pSample) { 
-        *pData = nullptr; 
-        *pDataSize = 0; 
-        return S_OK; 
+    IMFDXGIBuffer* pDXGIBuffer = nullptr;
+    hr = pBuffer->QueryInterface(IID_PPV_ARGS(&pDXGIBuffer));
+    if (SUCCEEDED(hr)) {
+        ID3D11Texture2D* pTexture = nullptr;
+        UINT subresource = 0;
+        hr = pDXGIBuffer->GetResource(IID_PPV_ARGS(&pTexture));
+        if (SUCCEEDED(hr))
+            hr = pDXGIBuffer->GetSubresourceIndex(&subresource);
+        if (SUCCEEDED(hr))
+            hr = VideoProcessor::Blit(pInstance, pTexture, subresource, pDestTexture);
+        if (FAILED(hr))
+            PrintHR("Video processor conversion failed", hr);
+        if (pTexture) pTexture->Release();
+        pDXGIBuffer->Release();
     }
+    pBuffer->Release();
+    return hr;
+}
 
-    // Store current position
-    pInstance->llCurrentPosition = llTimestamp;
+NATIVEVIDEOPLAYER_API HRESULT SetVideoDecodeMode(VideoPlayerInstance* pInstance, VideoDecodeMode mode, UINT32 queueDepth) {
+    if (!pInstance)
+        return OP_E_INVALID_PARAMETER;
+    if (mode != VIDEO_DECODE_MODE_SYNC && mode != VIDEO_DECODE_MODE_ASYNC && mode != VIDEO_DECODE_MODE_SCHEDULED)
+        return OP_E_INVALID_PARAMETER;
 
-    // Automatic synchronization with presentation clock
-    if (pInstance->pPresentationClock) {
-        // With automatic synchronization, the presentation clock handles timing
-        // We need to check if we should skip very late frames or wait for early frames
+    pInstance->decodeMode = mode;
+    pInstance->frameQueueDepth = queueDepth ? std::min(queueDepth, 64u) : 4u;
+    return S_OK;
+}
 
-        // Get current presentation time
-        MFTIME clockTime = 0;
-        hr = pInstance->pPresentationClock->GetTime(&clockTime);
+NATIVEVIDEOPLAYER_API HRESULT SetDecodePriority(VideoPlayerInstance* pInstance, DecodePriority priority, UINT32 maxFrameRate) {
+    if (!pInstance)
+        return OP_E_INVALID_PARAMETER;
+    if (priority != DECODE_PRIORITY_NORMAL && priority != DECODE_PRIORITY_LOW)
+        return OP_E_INVALID_PARAMETER;
 
-        if (SUCCEEDED(hr)) {
-            // Calculate frame rate for skip threshold
-            UINT frameRateNum = 60, frameRateDenom = 1;
-            GetVideoFrameRate(pInstance, &frameRateNum, &frameRateDenom);
-            double frameTimeMs = 1000.0 * frameRateDenom / frameRateNum;
-            auto skipThreshold = static_cast<LONGLONG>(-frameTimeMs * 3 * 10000);
+    pInstance->decodePriority = priority;
+    pInstance->maxDecodeFrameRate = maxFrameRate;
+    if (pInstance->pDecodeJob)
+        pInstance->pDecodeJob->SetPriority(priority, maxFrameRate);
+    return S_OK;
+}
 
-            // The presentation clock's rate already accounts for playback speed
+NATIVEVIDEOPLAYER_API HRESULT SetPacingMode(VideoPlayerInstance* pInstance, PacingMode mode) {
+    if (!pInstance)
+        return OP_E_INVALID_PARAMETER;
+    if (mode != PACING_MODE_CLOCK && mode != PACING_MODE_UNPACED && mode != PACING_MODE_EXTERNAL)
+        return OP_E_INVALID_PARAMETER;
 
-            // Calculate difference between frame timestamp and clock
-            LONGLONG diff = llTimestamp - clockTime;
+    pInstance->pacingMode = mode;
+    return S_OK;
+}
 
-            // If frame is very late, skip it
-            if (diff < skipThreshold) {
-                pSample->Release();
-                *pData = nullptr;
-                *pDataSize = 0;
-                return S_OK;
-            }
-            // If frame is ahead of schedule, wait to maintain correct frame rate
-            else if (diff > 0) {
-                // Convert diff from 100ns units to milliseconds and apply playback speed
-                double waitTime = diff / 10000.0;
-                // Limit maximum wait time to avoid freezing if timestamps are far apart
-                waitTime = std::min(waitTime, frameTimeMs * 2);
-                if (waitTime > 1.0) {
-                    PreciseSleepHighRes(waitTime);
-                }
-            }
-        }
-    }
+NATIVEVIDEOPLAYER_API HRESULT SetPresentationTime(VideoPlayerInstance* pInstance, LONGLONG llPresentationTime) {
+    if (!pInstance)
+        return OP_E_INVALID_PARAMETER;
 
-    IMFMediaBuffer* pBuffer = nullptr;
-    hr = pSample->ConvertToContiguousBuffer(&pBuffer);
-    if (FAILED(hr)) {
-        PrintHR("ConvertToContiguousBuffer failed", hr);
-        pSample->Release();
-        return hr;
-    }
+    InterlockedExchange64(&pInstance->llExternalTime, llPresentationTime);
+    return S_OK;
+}
 
-    BYTE* pBytes = nullptr;
-    DWORD cbMax = 0, cbCurr = 0;
-    hr = pBuffer->Lock(&pBytes, &cbMax, &cbCurr);
-    if (FAILED(hr)) {
-        PrintHR("Buffer->Lock failed", hr);
-        pBuffer->Release();
-        pSample->Release();
+NATIVEVIDEOPLAYER_API HRESULT SetVideoQualityControl(VideoPlayerInstance* pInstance, BOOL bEnabled) {
+    if (!pInstance)
+        return OP_E_INVALID_PARAMETER;
+    pInstance->qualityControl.SetEnabled(bEnabled != FALSE);
+    return S_OK;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT GetVideoQosStats(const VideoPlayerInstance* pInstance, VideoQosStats* pStats) {
+    if (!pInstance || !pStats)
+        return OP_E_INVALID_PARAMETER;
+    pInstance->qualityControl.GetStats(pStats);
+    return S_OK;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT GetVideoAdapterCount(UINT32* pCount) {
+    if (!pCount)
+        return OP_E_INVALID_PARAMETER;
+    *pCount = GetAdapterCount();
+    return S_OK;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT GetVideoAdapterInfo(UINT32 adapterIndex, VideoAdapterInfo* pInfo) {
+    if (!pInfo)
+        return OP_E_INVALID_PARAMETER;
+
+    DXGI_ADAPTER_DESC1 desc = {};
+    UINT32 activeDevices = 0;
+    HRESULT hr = GetAdapterInfo(adapterIndex, &desc, &activeDevices);
+    if (FAILED(hr))
         return hr;
-    }
 
-    pInstance->pLockedBuffer = pBuffer;
-    pInstance->pLockedBytes = pBytes;
-    pInstance->lockedMaxSize = cbMax;
-    pInstance->lockedCurrSize = cbCurr;
-    *pData = pBytes;
-    *pDataSize = cbCurr;
-    pSample->Release();
+    wcsncpy_s(pInfo->description, desc.Description, _TRUNCATE);
+    pInfo->vendorId = desc.VendorId;
+    pInfo->deviceId = desc.DeviceId;
+    pInfo->dedicatedVideoMemory = desc.DedicatedVideoMemory;
+    pInfo->activeDevices = activeDevices;
     return S_OK;
 }
 
-NATIVEVIDEOPLAYER_API HRESULT UnlockVideoFrame(VideoPlayerInstance* pInstance) {
+NATIVEVIDEOPLAYER_API HRESULT SetVideoAdapter(VideoPlayerInstance* pInstance, INT32 adapter) {
+    if (!pInstance || adapter < VIDEO_ADAPTER_SHARED)
+        return OP_E_INVALID_PARAMETER;
+    if (adapter >= 0 && static_cast<UINT32>(adapter) >= GetAdapterCount())
+        return OP_E_INVALID_PARAMETER;
+    pInstance->videoAdapter = adapter;
+    return S_OK;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT GetVideoDevice(const VideoPlayerInstance* pInstance, ID3D11Device** ppDevice) {
+    if (!pInstance || !ppDevice)
+        return OP_E_INVALID_PARAMETER;
+    *ppDevice = GetInstanceDevice(pInstance);
+    return *ppDevice ? S_OK : OP_E_NOT_INITIALIZED;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT SetOutputSize(VideoPlayerInstance* pInstance, UINT32 width, UINT32 height) {
     if (!pInstance)
-        return E_INVALIDARG;
-    if (pInstance->pLockedBuffer) {
-        pInstance->pLockedBuffer->Unlock();
-        pInstance->pLockedBuffer->Release();
-        pInstance->pLockedBuffer = nullptr;
+        return OP_E_INVALID_PARAMETER;
+    // The size is stored before the flag is raised, and the reading thread clears the flag before loading it
+    pInstance->requestedOutputWidth = width;
+    pInstance->requestedOutputHeight = height;
+    if (pInstance->pSourceReader)
+        InterlockedExchange(&pInstance->bOutputSizeChanged, TRUE);
+    return S_OK;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT SetSharedAudioMixer(VideoPlayerInstance* pInstance, BOOL bShared) {
+    if (!pInstance)
+        return OP_E_INVALID_PARAMETER;
+    pInstance->bUseAudioMixer = bShared;
+    return S_OK;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT SetAudioLatencyMode(VideoPlayerInstance* pInstance, AudioLatencyMode mode) {
+    if (!pInstance)
+        return OP_E_INVALID_PARAMETER;
+    if (mode != AUDIO_LATENCY_DEFAULT && mode != AUDIO_LATENCY_LOW && mode != AUDIO_LATENCY_EXCLUSIVE)
+        return OP_E_INVALID_PARAMETER;
+    pInstance->audioLatencyMode = mode;
+    return S_OK;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT SetClockMode(VideoPlayerInstance* pInstance, ClockMode mode) {
+    if (!pInstance)
+        return OP_E_INVALID_PARAMETER;
+    if (mode != CLOCK_MODE_SYSTEM && mode != CLOCK_MODE_AUDIO)
+        return OP_E_INVALID_PARAMETER;
+    pInstance->clockMode = mode;
+    return S_OK;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT GetAudioLatency(const VideoPlayerInstance* pInstance, LONGLONG* pLatency) {
+    if (!pInstance || !pLatency)
+        return OP_E_INVALID_PARAMETER;
+    return AudioManager::GetOutputLatency(pInstance, pLatency);
+}
+
+NATIVEVIDEOPLAYER_API HRESULT SetSharedSourceReader(VideoPlayerInstance* pInstance, BOOL bShared) {
+    if (!pInstance)
+        return OP_E_INVALID_PARAMETER;
+    pInstance->bSharedSourceReader = bShared;
+    return S_OK;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT SetStreamCache(VideoPlayerInstance* pInstance, UINT32 memoryBytes, UINT32 readAheadBytes) {
+    if (!pInstance)
+        return OP_E_INVALID_PARAMETER;
+    pInstance->streamCacheBytes = memoryBytes;
+    pInstance->streamReadAheadBytes = readAheadBytes;
+    return S_OK;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT SetMemoryMappedIo(VideoPlayerInstance* pInstance, BOOL bEnable) {
+    if (!pInstance)
+        return OP_E_INVALID_PARAMETER;
+    pInstance->bMemoryMappedIo = bEnable;
+    return S_OK;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT SetStreamDiskCache(const wchar_t* directory, UINT64 maxBytes) {
+    return ByteStreamCache::ConfigureDiskCache(directory, maxBytes);
+}
+
+NATIVEVIDEOPLAYER_API HRESULT GetStreamCacheStats(const VideoPlayerInstance* pInstance, StreamCacheStats* pStats) {
+    if (!pInstance || !pStats)
+        return OP_E_INVALID_PARAMETER;
+    if (!pInstance->pByteSource) {
+        *pStats = {};
+        return S_FALSE;
     }
-    pInstance->pLockedBytes = nullptr;
-    pInstance->lockedMaxSize = pInstance->lockedCurrSize = 0;
+    pInstance->pByteSource->GetStats(pStats);
+    return S_OK;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT GetPlayerStats(const VideoPlayerInstance* pInstance, PlayerStats* pStats) {
+    if (!pInstance || !pStats)
+        return OP_E_INVALID_PARAMETER;
+    pInstance->metrics.GetStats(pStats);
+    return S_OK;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT GetVideoOutputFormat(const VideoPlayerInstance* pInstance, VideoOutputFormat* pFormat) {
+    if (!pInstance || !pFormat)
+        return OP_E_INVALID_PARAMETER;
+    if (!pInstance->pSourceReader)
+        return OP_E_NOT_INITIALIZED;
+    *pFormat = pInstance->actualOutputFormat;
     return S_OK;
 }
 
@@ -431,41 +2024,80 @@ NATIVEVIDEOPLAYER_API HRESULT GetVideoFrameRate(const VideoPlayerInstance* pInst
     if (!pInstance || !pInstance->pSourceReader || !pNum || !pDenom)
         return OP_E_NOT_INITIALIZED;
 
-    IMFMediaType* pType = nullptr;
-    HRESULT hr = pInstance->pSourceReader->GetCurrentMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, &pType);
-    if (SUCCEEDED(hr)) {
-        hr = MFGetAttributeRatio(pType, MF_MT_FRAME_RATE, pNum, pDenom);
-        pType->Release();
-    }
-    return hr;
+    if (!pInstance->frameRateNum)
+        return MF_E_ATTRIBUTENOTFOUND;
+    *pNum = pInstance->frameRateNum;
+    *pDenom = pInstance->frameRateDenom;
+    return S_OK;
+}
+
+NATIVEVIDEOPLAYER_API HRESULT GetVideoStride(const VideoPlayerInstance* pInstance, LONG* pStride) {
+    if (!pInstance || !pInstance->pSourceReader || !pStride)
+        return OP_E_NOT_INITIALIZED;
+    if (!pInstance->videoStride)
+        return MF_E_ATTRIBUTENOTFOUND;
+    *pStride = pInstance->videoStride;
+    return S_OK;
 }
 
 NATIVEVIDEOPLAYER_API HRESULT SeekMedia(VideoPlayerInstance* pInstance, LONGLONG llPositionIn100Ns) {
+    return SeekMediaEx(pInstance, llPositionIn100Ns, SEEK_MODE_DEFAULT);
+}
+
+NATIVEVIDEOPLAYER_API HRESULT SeekMediaEx(VideoPlayerInstance* pInstance, LONGLONG llPositionIn100Ns, SeekMode mode) {
     if (!pInstance || !pInstance->pSourceReader)
         return OP_E_NOT_INITIALIZED;
+    if (mode != SEEK_MODE_DEFAULT && mode != SEEK_MODE_FAST && mode != SEEK_MODE_ACCURATE)
+        return OP_E_INVALID_PARAMETER;
+
+    // Fast seeks land exactly on the nearest keyframe, which the keyframe index knows once built.
+    // The index demuxes the whole file a second time, so it is only built for local files, on the first
+    // fast seek; network media seeks on the reader side.
+    LONGLONG llSeekPosition = llPositionIn100Ns;
+    if (mode == SEEK_MODE_FAST && !pInstance->pKeyframeIndex && !pInstance->mediaUrl.empty() &&
+        IsLocalPath(pInstance->mediaUrl.c_str())) {
+        pInstance->pKeyframeIndex = new (std::nothrow) KeyframeIndex();
+        if (pInstance->pKeyframeIndex)
+            pInstance->pKeyframeIndex->StartBuild(pInstance->mediaUrl);
+    }
+    if (mode == SEEK_MODE_FAST && pInstance->pKeyframeIndex) {
+        LONGLONG llKeyframe = 0;
+        if (pInstance->pKeyframeIndex->FindNearest(llPositionIn100Ns, &llKeyframe))
+            llSeekPosition = llKeyframe;
+    }
 
+    // The flag goes up before the count changes (see VideoPlayerInstance), so the audio thread never
+    // sees the new count without the seek. Audio published by a deferred open is read under the same lock;
+    // audio that joins later starts at the clock position on its own.
     EnterCriticalSection(&pInstance->csClockSync);
     pInstance->bSeekInProgress = TRUE;
+    ++pInstance->seekCount;
+    const bool bAudioOutput = pInstance->bHasAudio && HasAudioOutput(pInstance);
+    IMFSourceReader* pAudioReader = pInstance->pSourceReaderAudio;
     LeaveCriticalSection(&pInstance->csClockSync);
+    WakeAudioThread(pInstance);
 
     if (pInstance->llPauseStart != 0) {
         pInstance->llTotalPauseTime += (GetCurrentTimeMs() - pInstance->llPauseStart);
         pInstance->llPauseStart = GetCurrentTimeMs();
     }
 
-    if (pInstance->pLockedBuffer)
+    if (pInstance->pLockedBuffer || pInstance->pTextureSample)
         UnlockVideoFrame(pInstance);
+    if (pInstance->pPrerollSample) {
+        pInstance->pPrerollSample->Release();
+        pInstance->pPrerollSample = nullptr;
+    }
 
     PROPVARIANT var;
     PropVariantInit(&var);
     var.vt = VT_I8;
-    var.hVal.QuadPart = llPositionIn100Ns;
+    var.hVal.QuadPart = llSeekPosition;
 
     bool wasPlaying = false;
-    if (pInstance->bHasAudio && pInstance->pAudioClient) {
+    if (bAudioOutput) {
         wasPlaying = (pInstance->llPauseStart == 0);
-        pInstance->pAudioClient->Stop();
-        Sleep(5);
+        StopAudioOutput(pInstance);
     }
 
     // Stop the presentation clock
@@ -473,24 +2105,42 @@ NATIVEVIDEOPLAYER_API HRESULT SeekMedia(VideoPlayerInstance* pInstance, LONGLONG
         pInstance->pPresentationClock->Stop();
     }
 
+    // The demux thread must be out of ReadSample before the shared reader can seek
+    if (pInstance->pDemuxer) {
+        pInstance->pDemuxer->Flush();
+    }
+
+    // Pending asynchronous requests must be cancelled before the reader can seek
+    if (pInstance->pFrameProducer) {
+        HRESULT hrFlush = pInstance->pFrameProducer->Flush();
+        if (FAILED(hrFlush)) {
+            PrintHR("Failed to flush asynchronous reader", hrFlush);
+        }
+    }
+
     // Seek the main source reader
     HRESULT hr = pInstance->pSourceReader->SetCurrentPosition(GUID_NULL, var);
     if (FAILED(hr)) {
+        if (pInstance->pDemuxer)
+            pInstance->pDemuxer->Resume();
         EnterCriticalSection(&pInstance->csClockSync);
         pInstance->bSeekInProgress = FALSE;
         LeaveCriticalSection(&pInstance->csClockSync);
+        WakeAudioThread(pInstance);
+        if (pInstance->pFrameProducer)
+            pInstance->pFrameProducer->Start();
         PropVariantClear(&var);
         return hr;
     }
 
     // Also seek the audio source reader if available
-    if (pInstance->pSourceReaderAudio) {
+    if (pAudioReader) {
         PROPVARIANT varAudio;
         PropVariantInit(&varAudio);
         varAudio.vt = VT_I8;
-        varAudio.hVal.QuadPart = llPositionIn100Ns;
+        varAudio.hVal.QuadPart = llSeekPosition;
 
-        HRESULT hrAudio = pInstance->pSourceReaderAudio->SetCurrentPosition(GUID_NULL, varAudio);
+        HRESULT hrAudio = pAudioReader->SetCurrentPosition(GUID_NULL, varAudio);
         if (FAILED(hrAudio)) {
             PrintHR("Failed to seek audio source reader", hrAudio);
         }
@@ -499,60 +2149,73 @@ NATIVEVIDEOPLAYER_API HRESULT SeekMedia(VideoPlayerInstance* pInstance, LONGLONG
 
 
     // Reset audio client if needed
-    if (pInstance->bHasAudio && pInstance->pRenderClient && pInstance->pAudioClient) {
-        UINT32 bufferFrameCount = 0;
-        if (SUCCEEDED(pInstance->pAudioClient->GetBufferSize(&bufferFrameCount))) {
-            pInstance->pAudioClient->Reset();
-        }
+    if (bAudioOutput) {
+        ResetAudioOutput(pInstance);
     }
 
     PropVariantClear(&var);
 
     // Update position and state
     EnterCriticalSection(&pInstance->csClockSync);
-    pInstance->llCurrentPosition = llPositionIn100Ns;
+    pInstance->llCurrentPosition = llSeekPosition;
+    // The reader lands on the previous keyframe; accurate seeks decode forward from there
+    // (asynchronous mode already drops frames older than the clock)
+    pInstance->llAccurateSeekTarget = (mode == SEEK_MODE_ACCURATE && !pInstance->pFrameProducer) ? llPositionIn100Ns : -1;
     pInstance->bSeekInProgress = FALSE;
     LeaveCriticalSection(&pInstance->csClockSync);
 
+    // Lateness measured before the seek says nothing about the new position
+    pInstance->qualityControl.Reset();
+
     pInstance->bEOF = FALSE;
 
+    // Resume demuxing from the new position
+    if (pInstance->pDemuxer) {
+        pInstance->pDemuxer->Resume();
+    }
+
+    // Resume decoding ahead from the new position
+    if (pInstance->pFrameProducer) {
+        hr = pInstance->pFrameProducer->Start();
+        if (FAILED(hr)) {
+            PrintHR("Failed to restart asynchronous decoding after seek", hr);
+        }
+    }
+
     // Restart the presentation clock at the new position
     if (pInstance->pPresentationClock) {
-        hr = pInstance->pPresentationClock->Start(llPositionIn100Ns);
+        hr = pInstance->pPresentationClock->Start(llSeekPosition);
         if (FAILED(hr)) {
             PrintHR("Failed to restart presentation clock after seek", hr);
         }
     }
 
     // Restart audio if it was playing
-    if (pInstance->bHasAudio && pInstance->pAudioClient && wasPlaying) {
-        Sleep(5);
-        pInstance->pAudioClient->Start();
+    if (bAudioOutput && wasPlaying) {
+        StartAudioOutput(pInstance);
     }
 
-    // Signal audio thread to continue
-    if (pInstance->hAudioReadyEvent)
-        SetEvent(pInstance->hAudioReadyEvent);
+    // Let the audio thread feed the new position
+    WakeAudioThread(pInstance);
 
     return S_OK;
 }
 
+NATIVEVIDEOPLAYER_API HRESULT ExtractFrames(const wchar_t* url, const LONGLONG* pTimestamps, UINT32 count,
+                                            UINT32 targetWidth, UINT32 targetHeight, VideoOutputFormat format,
+                                            UINT32 batchSize, ExtractFramesCallback callback, void* pUserData) {
+    return ThumbnailExtractor::Extract(url, pTimestamps, count, targetWidth, targetHeight, format,
+                                       batchSize, callback, pUserData);
+}
+
 NATIVEVIDEOPLAYER_API HRESULT GetMediaDuration(const VideoPlayerInstance* pInstance, LONGLONG* pDuration) {
     if (!pInstance || !pInstance->pSourceReader || !pDuration)
         return OP_E_NOT_INITIALIZED;
 
-    IMFMediaSource* pMediaSource = nullptr;
-    IMFPresentationDescriptor* pPresentationDescriptor = nullptr;
-    HRESULT hr = pInstance->pSourceReader->GetServiceForStream(MF_SOURCE_READER_MEDIASOURCE, GUID_NULL, IID_PPV_ARGS(&pMediaSource));
-    if (SUCCEEDED(hr)) {
-        hr = pMediaSource->CreatePresentationDescriptor(&pPresentationDescriptor);
-        if (SUCCEEDED(hr)) {
-            hr = pPresentationDescriptor->GetUINT64(MF_PD_DURATION, reinterpret_cast<UINT64*>(pDuration));
-            pPresentationDescriptor->Release();
-        }
-        pMediaSource->Release();
-    }
-    return hr;
+    if (pInstance->llMediaDuration < 0)
+        return MF_E_ATTRIBUTENOTFOUND;
+    *pDuration = pInstance->llMediaDuration;
+    return S_OK;
 }
 
 NATIVEVIDEOPLAYER_API HRESULT GetMediaPosition(const VideoPlayerInstance* pInstance, LONGLONG* pPosition) {
@@ -592,10 +2255,13 @@ NATIVEVIDEOPLAYER_API HRESULT SetPlaybackState(VideoPlayerInstance* pInstance, B
             pInstance->llPauseStart = 0;
         }
 
-        // Start audio client if available
-        if (pInstance->pAudioClient && pInstance->bAudioInitialized) {
-            pInstance->pAudioClient->Start();
+        // Start audio client if available (a deferred open may still be setting it up)
+        EnterCriticalSection(&pInstance->csClockSync);
+        if (HasAudioOutput(pInstance) && pInstance->bAudioInitialized) {
+            StartAudioOutput(pInstance);
         }
+        LeaveCriticalSection(&pInstance->csClockSync);
+        WakeAudioThread(pInstance);
 
         // Start or resume presentation clock
         if (pInstance->pPresentationClock) {
@@ -614,9 +2280,12 @@ NATIVEVIDEOPLAYER_API HRESULT SetPlaybackState(VideoPlayerInstance* pInstance, B
         }
 
         // Pause audio client if available
-        if (pInstance->pAudioClient && pInstance->bAudioInitialized) {
-            pInstance->pAudioClient->Stop();
+        EnterCriticalSection(&pInstance->csClockSync);
+        if (HasAudioOutput(pInstance) && pInstance->bAudioInitialized) {
+            StopAudioOutput(pInstance);
         }
+        LeaveCriticalSection(&pInstance->csClockSync);
+        WakeAudioThread(pInstance);
 
         // Pause presentation clock
         if (pInstance->pPresentationClock) {
@@ -637,22 +2306,46 @@ NATIVEVIDEOPLAYER_API void CloseMedia(VideoPlayerInstance* pInstance) {
     if (!pInstance)
         return;
 
-    // Stop audio thread
+    // Let a deferred open finish before tearing down what it is setting up
+    WaitForDeferredOpen(pInstance);
+
+    // Wake readers blocked on the demux queues, then stop audio thread
+    if (pInstance->pDemuxer) {
+        pInstance->pDemuxer->Stop();
+    }
     StopAudioThread(pInstance);
 
     // Release video buffer
-    if (pInstance->pLockedBuffer) {
+    if (pInstance->pLockedBuffer || pInstance->pTextureSample) {
         UnlockVideoFrame(pInstance);
     }
+    if (pInstance->pPrerollSample) {
+        pInstance->pPrerollSample->Release();
+        pInstance->pPrerollSample = nullptr;
+    }
+
+    // Stop decoding ahead before the reader goes away
+    if (pInstance->pFrameProducer) {
+        pInstance->pFrameProducer->Shutdown();
+    }
+    pInstance->qualityControl.Detach();
 
     // Macro for safely releasing COM interfaces
     #define SAFE_RELEASE(obj) if (obj) { obj->Release(); obj = nullptr; }
 
     // Stop and release audio resources
+    if (pInstance->pMixerSource) {
+        if (AudioMixer* pMixer = GetAudioMixer())
+            pMixer->RemoveSource(pInstance->pMixerSource);
+        pInstance->pMixerSource = nullptr;
+    }
     if (pInstance->pAudioClient) {
         pInstance->pAudioClient->Stop();
+        SAFE_RELEASE(pInstance->pAudioClock);
         SAFE_RELEASE(pInstance->pAudioClient);
     }
+    pInstance->audioClockFrequency = 0;
+    pInstance->llAudioClockWrittenEnd = -1;
 
     // Stop and release presentation clock
     if (pInstance->pPresentationClock) {
@@ -663,12 +2356,32 @@ NATIVEVIDEOPLAYER_API void CloseMedia(VideoPlayerInstance* pInstance) {
     // Release media source
     SAFE_RELEASE(pInstance->pMediaSource);
 
+    // Release zero-copy output resources
+    SAFE_RELEASE(pInstance->pSharedTexture);
+    VideoProcessor::Release(pInstance);
+
     // Release other COM resources
     SAFE_RELEASE(pInstance->pRenderClient);
     SAFE_RELEASE(pInstance->pDevice);
     SAFE_RELEASE(pInstance->pAudioEndpointVolume);
     SAFE_RELEASE(pInstance->pSourceReader);
+
+    // Back to the pool once the reader no longer decodes on it
+    ReleaseVideoDevice(pInstance->pGpuDevice);
+    pInstance->pGpuDevice = nullptr;
     SAFE_RELEASE(pInstance->pSourceReaderAudio);
+    if (pInstance->pByteSource) {
+        pInstance->pByteSource->Release();
+        pInstance->pByteSource = nullptr;
+    }
+    SAFE_RELEASE(pInstance->pAsyncReader);
+    delete pInstance->pDecodeJob;
+    pInstance->pDecodeJob = nullptr;
+    pInstance->pFrameProducer = nullptr;
+    delete pInstance->pDemuxer;
+    pInstance->pDemuxer = nullptr;
+    delete pInstance->pKeyframeIndex;
+    pInstance->pKeyframeIndex = nullptr;
 
     // Release audio format
     if (pInstance->pSourceAudioFormat) {
@@ -681,10 +2394,20 @@ NATIVEVIDEOPLAYER_API void CloseMedia(VideoPlayerInstance* pInstance) {
 
     SAFE_CLOSE_HANDLE(pInstance->hAudioSamplesReadyEvent);
     SAFE_CLOSE_HANDLE(pInstance->hAudioReadyEvent);
+    SAFE_CLOSE_HANDLE(pInstance->hSharedTextureHandle);
+    SAFE_CLOSE_HANDLE(pInstance->hMediaReadyEvent);
 
     // Reset state variables
     pInstance->bEOF = FALSE;
     pInstance->videoWidth = pInstance->videoHeight = 0;
+    pInstance->sourceWidth = pInstance->sourceHeight = 0;
+    pInstance->actualOutputFormat = VIDEO_OUTPUT_FORMAT_RGB32;
+    pInstance->videoTransferFunction = 0;
+    pInstance->videoPrimaries = 0;
+    pInstance->frameRateNum = 0;
+    pInstance->frameRateDenom = 1;
+    pInstance->videoStride = 0;
+    pInstance->llMediaDuration = -1;
     pInstance->bHasAudio = FALSE;
     pInstance->bAudioInitialized = FALSE;
     pInstance->llPlaybackStartTime = 0;
@@ -693,6 +2416,11 @@ NATIVEVIDEOPLAYER_API void CloseMedia(VideoPlayerInstance* pInstance) {
     pInstance->llCurrentPosition = 0;
     pInstance->bSeekInProgress = FALSE;
     pInstance->playbackSpeed = 1.0f;
+    pInstance->bMetadataCached = FALSE;
+    pInstance->hrOpenStatus = S_OK;
+    pInstance->llAccurateSeekTarget = -1;
+    pInstance->mediaUrl.clear();
+    pInstance->metrics.Reset();
 
     #undef SAFE_RELEASE
     #undef SAFE_CLOSE_HANDLE
@@ -710,6 +2438,10 @@ NATIVEVIDEOPLAYER_API HRESULT GetAudioLevels(const VideoPlayerInstance* pInstanc
     return AudioManager::GetAudioLevels(pInstance, pLeftLevel, pRightLevel);
 }
 
+NATIVEVIDEOPLAYER_API HRESULT GetAudioLevelsEx(const VideoPlayerInstance* pInstance, AudioLevels* pLevels) {
+    return AudioManager::GetAudioLevelsEx(pInstance, pLevels);
+}
+
 NATIVEVIDEOPLAYER_API HRESULT SetPlaybackSpeed(VideoPlayerInstance* pInstance, float speed) {
     if (!pInstance)
         return OP_E_NOT_INITIALIZED;
@@ -754,6 +2486,16 @@ NATIVEVIDEOPLAYER_API HRESULT GetVideoMetadata(const VideoPlayerInstance* pInsta
     if (!pInstance->pSourceReader)
         return OP_E_NOT_INITIALIZED;
 
+    // Already probed by a deferred open
+    if (pInstance->bMetadataCached) {
+        *pMetadata = pInstance->cachedMetadata;
+        return S_OK;
+    }
+    return QueryVideoMetadata(pInstance, pMetadata);
+}
+
+// Probes the media source for metadata
+static HRESULT QueryVideoMetadata(const VideoPlayerInstance* pInstance, VideoMetadata* pMetadata) {
     // Initialize metadata structure with default values
     ZeroMemory(pMetadata, sizeof(VideoMetadata));
 
@@ -905,9 +2647,9 @@ NATIVEVIDEOPLAYER_API HRESULT GetVideoMetadata(const VideoPlayerInstance* pInsta
 
     // If we couldn't get some metadata from the media source, try to get it from the instance
     if (!pMetadata->hasWidth || !pMetadata->hasHeight) {
-        if (pInstance->videoWidth > 0 && pInstance->videoHeight > 0) {
-            pMetadata->width = pInstance->videoWidth;
-            pMetadata->height = pInstance->videoHeight;
+        if (pInstance->sourceWidth > 0 && pInstance->sourceHeight > 0) {
+            pMetadata->width = pInstance->sourceWidth;
+            pMetadata->height = pInstance->sourceHeight;
             pMetadata->hasWidth = TRUE;
             pMetadata->hasHeight = TRUE;
         }
@@ -9,6 +9,7 @@
 #include <mfreadwrite.h>
 #include <audioclient.h>
 #include <mmdeviceapi.h>
+#include <d3d11.h>
 
 // Structure to hold video metadata
 typedef struct VideoMetadata {
@@ -32,6 +33,161 @@ typedef struct VideoMetadata {
     BOOL hasAudioSampleRate;     // TRUE if audio sample rate is available
 } VideoMetadata;
 
+// Pixel format delivered by the decoding pipeline
+typedef enum VideoOutputFormat {
+    VIDEO_OUTPUT_FORMAT_RGB32 = 0,  // 32-bit BGRX, converted by the Media Foundation video processor
+    VIDEO_OUTPUT_FORMAT_NV12  = 1,  // 8-bit 4:2:0, Y plane followed by interleaved UV plane
+    VIDEO_OUTPUT_FORMAT_P010  = 2   // 10-bit 4:2:0 in 16-bit words (HDR10), same layout as NV12
+} VideoOutputFormat;
+
+// How decoded video frames are produced
+typedef enum VideoDecodeMode {
+    VIDEO_DECODE_MODE_SYNC  = 0,    // ReadVideoFrame decodes on the calling thread and waits for the clock
+    VIDEO_DECODE_MODE_ASYNC = 1,    // Frames are decoded ahead into a bounded queue (see TryAcquireFrame)
+    VIDEO_DECODE_MODE_SCHEDULED = 2 // Like ASYNC, but decoded by worker threads shared by all instances
+} VideoDecodeMode;
+
+// What video frames are paced against
+typedef enum PacingMode {
+    PACING_MODE_CLOCK    = 0,       // The presentation clock: early frames are waited for, late ones dropped
+    PACING_MODE_UNPACED  = 1,       // None: every frame as soon as it is decoded, without audio
+    PACING_MODE_EXTERNAL = 2        // The time given with SetPresentationTime: late frames are dropped, none waited for
+} PacingMode;
+
+// Scheduling class of an instance in VIDEO_DECODE_MODE_SCHEDULED
+typedef enum DecodePriority {
+    DECODE_PRIORITY_NORMAL = 0,
+    DECODE_PRIORITY_LOW    = 1      // Served after normal instances whose frames are due at about the same time
+} DecodePriority;
+
+// Special values of SetVideoAdapter; other values are adapter indices (see GetVideoAdapterInfo)
+typedef enum VideoAdapterSelection {
+    VIDEO_ADAPTER_SHARED = -2,      // The device shared by all instances, created by InitMediaFoundation
+    VIDEO_ADAPTER_AUTO   = -1       // A device of its own, on the adapter with the fewest devices in use
+} VideoAdapterSelection;
+
+// Hardware adapter that instances can decode on
+typedef struct VideoAdapterInfo {
+    wchar_t description[128];   // Adapter name reported by the driver
+    UINT32 vendorId;            // PCI vendor ID
+    UINT32 deviceId;            // PCI device ID
+    UINT64 dedicatedVideoMemory;// In bytes
+    UINT32 activeDevices;       // Instance devices currently open on the adapter
+} VideoAdapterInfo;
+
+// Render stream profile of an instance's own audio output (not used with the shared mixer)
+typedef enum AudioLatencyMode {
+    AUDIO_LATENCY_DEFAULT   = 0,    // Shared mode with a 200 ms buffer
+    AUDIO_LATENCY_LOW       = 1,    // Shared mode at the engine's minimum period (IAudioClient3), 20 ms buffer otherwise
+    AUDIO_LATENCY_EXCLUSIVE = 2     // Exclusive mode at the device's minimum period, if the format is supported
+} AudioLatencyMode;
+
+// Time base that video frames are paced against
+typedef enum ClockMode {
+    CLOCK_MODE_SYSTEM = 0,          // Presentation clock on the system time source; audio follows it
+    CLOCK_MODE_AUDIO  = 1           // Played position of the audio render stream; the system clock is the fallback
+} ClockMode;
+
+// Levels of an instance's audio output after its volume, linear with full scale 1.0
+typedef struct AudioLevels {
+    float peakLeft;             // Peak, falling back at 20 dB/s
+    float peakRight;
+    float rmsLeft;              // RMS over about 300 ms
+    float rmsRight;
+} AudioLevels;
+
+// Frame delivery counters of an instance since its media was opened (see GetVideoQosStats)
+typedef struct VideoQosStats {
+    UINT64 framesPresented;     // Frames handed out by the read functions
+    UINT64 framesLate;          // Handed out more than one frame duration behind the clock
+    UINT64 framesDropped;       // Decoded, then discarded for being too late
+    UINT64 framesSkipped;       // Not decoded at all, dropped by the decoder on quality feedback
+    UINT32 dropMode;            // Current MF_QUALITY_DROP_MODE of the decoder (0 when every frame is decoded)
+} VideoQosStats;
+
+// Byte counters of the stream cache of an instance since its media was opened (see GetStreamCacheStats)
+typedef struct StreamCacheStats {
+    UINT64 bytesRead;           // Bytes handed to the readers
+    UINT64 bytesFetched;        // Bytes read from the network or the application's byte stream
+    UINT64 bytesFromDisk;       // Bytes served from the disk cache
+} StreamCacheStats;
+
+// Latency distribution of one pipeline stage, in microseconds (percentiles within 1/8 of the value)
+typedef struct LatencyStats {
+    UINT64 count;               // Samples recorded
+    UINT32 meanUs;
+    UINT32 p50Us;
+    UINT32 p90Us;
+    UINT32 p99Us;
+    UINT32 maxUs;
+} LatencyStats;
+
+// Performance counters of an instance since its media was opened (see GetPlayerStats)
+typedef struct PlayerStats {
+    LatencyStats videoDecode;       // Reading a decoded video frame (CPU colour conversion included)
+    LatencyStats videoLock;         // Locking the frame buffer
+    LatencyStats colorConversion;   // D3D11 video processor blit
+    LatencyStats pacingError;       // Lateness of the frame pacing wakeups
+    LatencyStats audioDecode;       // Reading a decoded audio sample
+    LatencyStats audioDrift;        // Distance between the audio heard and the presentation clock
+    UINT64 videoFrames;             // Frames handed out
+    UINT64 audioUnderruns;          // Audio output found empty while playing
+    UINT64 audioSamplesDropped;     // Audio samples skipped to catch up with the clock
+    UINT64 audioSamplesDelayed;     // Audio samples held back for the clock
+} PlayerStats;
+
+// Flags of VideoFrameInfo
+typedef enum VideoFrameFlags {
+    VIDEO_FRAME_FLAG_END_OF_STREAM  = 0x1,  // No more frames until the next seek
+    VIDEO_FRAME_FLAG_DISCONTINUITY  = 0x2,  // First frame after a seek or a gap in the stream
+    VIDEO_FRAME_FLAG_FORMAT_CHANGED = 0x4   // Size or stride differ from the previous frame
+} VideoFrameFlags;
+
+// Frame and instance state returned by a single ReadVideoFrameEx call
+typedef struct VideoFrameInfo {
+    BYTE* pData;                // Frame data (do not free), valid until the next read or UnlockVideoFrame; nullptr if no new frame
+    DWORD dataSize;             // Size of pData in bytes
+    LONG stride;                // Row stride in bytes (negative when bottom-up)
+    UINT32 width;               // Frame size in pixels
+    UINT32 height;
+    LONGLONG timestamp;         // Presentation time of the frame in 100-ns
+    LONGLONG duration;          // Frame duration in 100-ns (0 if unknown)
+    LONGLONG position;          // Media position in 100-ns, as returned by GetMediaPosition
+    UINT32 flags;               // VideoFrameFlags
+    VideoQosStats qos;          // Frame delivery counters, as returned by GetVideoQosStats
+} VideoFrameInfo;
+
+// Seek behaviour of SeekMediaEx
+typedef enum SeekMode {
+    SEEK_MODE_DEFAULT  = 0,     // Same as SeekMedia: playback resumes from the previous keyframe
+    SEEK_MODE_FAST     = 1,     // Snap to the nearest keyframe, no decode-forward
+    SEEK_MODE_ACCURATE = 2      // Decode forward from the previous keyframe to the exact position
+} SeekMode;
+
+// Frame decoded by ExtractFrames
+typedef struct ExtractedFrame {
+    UINT32 index;                // Position of the request in the timestamp array
+    LONGLONG requestedTime;      // Requested position in 100-ns units
+    LONGLONG timestamp;          // Timestamp of the keyframe actually decoded, in 100-ns units
+    HRESULT hr;                  // S_OK, MF_E_END_OF_STREAM past the end of the media, or a copy error
+    const BYTE* pData;           // Pixels, valid until the callback returns (nullptr on failure)
+    DWORD dataSize;              // Size of pData in bytes
+    UINT32 width;                // Width in pixels
+    UINT32 height;               // Height in pixels
+    UINT32 pitch;                // Row pitch in bytes (the NV12 UV plane follows the Y plane at the same pitch)
+    VideoOutputFormat format;    // VIDEO_OUTPUT_FORMAT_RGB32 or VIDEO_OUTPUT_FORMAT_NV12
+} ExtractedFrame;
+
+// Receives a batch of extracted frames, in presentation order; return FALSE to stop the extraction
+typedef BOOL (CALLBACK *ExtractFramesCallback)(const ExtractedFrame* pFrames, UINT32 frameCount, void* pUserData);
+
+// Structure pour encapsuler l'état d'une instance de lecteur vidéo
+struct VideoPlayerInstance;
+
+// Called from a background thread once a media opened with OpenMediaDeferred is fully ready. CloseMedia and the
+// OpenMedia functions wait for that thread, so calling them from the callback deadlocks.
+typedef void (CALLBACK *MediaReadyCallback)(VideoPlayerInstance* pInstance, HRESULT hrStatus, void* pUserData);
+
 // Macro d'exportation pour la DLL Windows
 #ifdef _WIN32
 #ifdef NATIVEVIDEOPLAYER_EXPORTS
@@ -48,9 +204,6 @@ typedef struct VideoMetadata {
 #define OP_E_ALREADY_INITIALIZED ((HRESULT)0x80000002L)
 #define OP_E_INVALID_PARAMETER   ((HRESULT)0x80000003L)
 
-// Structure pour encapsuler l'état d'une instance de lecteur vidéo
-struct VideoPlayerInstance;
-
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -87,7 +240,151 @@ NATIVEVIDEOPLAYER_API void DestroyVideoPlayerInstance(VideoPlayerInstance* pInst
 NATIVEVIDEOPLAYER_API HRESULT OpenMedia(VideoPlayerInstance* pInstance, const wchar_t* url);
 
 /**
- * @brief Lit la prochaine frame vidéo en format RGB32 pour une instance spécifique.
+ * @brief Opens a media (file or URL) and decodes it to the requested pixel format.
+ *
+ * NV12 and P010 skip the YUV to RGB conversion; use ConvertVideoFrameToTexture to convert on the GPU.
+ * If the stream cannot be decoded to P010 (8-bit content), NV12 is used instead.
+ * @param pInstance Handle to the instance.
+ * @param url Path or URL of the media (wide string).
+ * @param outputFormat Requested output format.
+ * @return S_OK on success, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT OpenMediaEx(VideoPlayerInstance* pInstance, const wchar_t* url, VideoOutputFormat outputFormat);
+
+/**
+ * @brief Opens a media and returns as soon as its video stream can be decoded.
+ *
+ * The audio reader, WASAPI, the audio thread and metadata probing are set up on a background thread.
+ * Frames can be read and playback started right away; audio joins in when ready. Completion is reported
+ * through the callback (if any) and WaitForMediaReady. Ignores SetSharedSourceReader.
+ * @param pInstance Handle to the instance.
+ * @param url Path or URL of the media (wide string).
+ * @param outputFormat Requested output format.
+ * @param callback Optional, called from the background thread once ready. It must not call CloseMedia or open a
+ *                 media on the instance: both wait for the background thread and would deadlock.
+ * @param pUserData Passed to the callback.
+ * @return S_OK once video is ready, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT OpenMediaDeferred(VideoPlayerInstance* pInstance, const wchar_t* url, VideoOutputFormat outputFormat,
+                                                MediaReadyCallback callback, void* pUserData);
+
+/**
+ * @brief Waits until a media opened with OpenMediaDeferred is fully ready (returns at once after OpenMedia).
+ * @param pInstance Handle to the instance.
+ * @param dwTimeoutMs Timeout in milliseconds (INFINITE to wait forever, 0 to poll).
+ * @return S_OK if ready, S_FALSE on timeout, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT WaitForMediaReady(VideoPlayerInstance* pInstance, DWORD dwTimeoutMs);
+
+/**
+ * @brief Opens the next media of a playlist in the background, to be swapped in by SwitchToPreloaded.
+ *
+ * The readers are created and configured, and the first video frame decoded (the frame queue filled in the
+ * asynchronous and scheduled modes), with the settings and output format the instance would reopen with.
+ * The current media keeps playing meanwhile. A new call replaces the media preloaded before.
+ * @param pInstance Handle to the instance.
+ * @param url Path or URL of the next media (wide string).
+ * @return S_OK once the preload is started, or an error code; open errors are returned by SwitchToPreloaded.
+ */
+NATIVEVIDEOPLAYER_API HRESULT PreloadMedia(VideoPlayerInstance* pInstance, const wchar_t* url);
+
+/**
+ * @brief Replaces the current media with the one opened by PreloadMedia, typically once IsEOF is set.
+ *
+ * Playback goes on from the start of the next media in the current play state and speed. The audio render
+ * stream (or mixer input) is kept when both media decode to the same format, so no new WASAPI stream is opened:
+ * the audio still queued from the current media plays out and the next media starts right after it.
+ * Waits for the preload to complete if it is still running.
+ * @param pInstance Handle to the instance.
+ * @return S_OK on success, OP_E_NOT_INITIALIZED if nothing was preloaded, or the error the preload failed with
+ *         (the current media is then left as it was).
+ */
+NATIVEVIDEOPLAYER_API HRESULT SwitchToPreloaded(VideoPlayerInstance* pInstance);
+
+/**
+ * @brief Releases the media opened by PreloadMedia, waiting for its preload to complete.
+ * @param pInstance Handle to the instance.
+ * @return S_OK on success, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT CancelPreload(VideoPlayerInstance* pInstance);
+
+/**
+ * @brief Opens a media from a byte stream provided by the application.
+ *
+ * The stream is read through a read-ahead cache (sized with SetStreamCache) shared by the audio and video
+ * readers, so it is read once even when both are open. Only the cache reads from the stream afterwards.
+ * @param pInstance Handle to the instance.
+ * @param pByteStream Readable byte stream (referenced until the media is closed).
+ * @param pOriginName Optional URL or file name of the content, used to pick the container handler.
+ * @param outputFormat Requested output format.
+ * @return S_OK on success, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT OpenMediaFromByteStream(VideoPlayerInstance* pInstance, IMFByteStream* pByteStream,
+                                                      const wchar_t* pOriginName, VideoOutputFormat outputFormat);
+
+/**
+ * @brief Sets the read-ahead cache of network media and byte streams (applied at the next open).
+ *
+ * Network URLs (http, https) are fetched once into a memory ring shared by the readers of the instance,
+ * with a background thread reading ahead of playback. By default, 32 MB with 8 MB ahead.
+ * @param pInstance Handle to the instance.
+ * @param memoryBytes Memory ring size; 0 reads network URLs directly, without the cache.
+ * @param readAheadBytes Bytes loaded ahead of the readers, at most half the ring.
+ * @return S_OK on success, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT SetStreamCache(VideoPlayerInstance* pInstance, UINT32 memoryBytes, UINT32 readAheadBytes);
+
+/**
+ * @brief Enables reading local files through a memory mapping (applied at the next open, enabled by default).
+ *
+ * The audio and video readers then copy out of the same mapped pages instead of issuing file reads; the
+ * container index and the pages ahead of playback or after a seek are prefetched. Paths given as file:// URLs,
+ * and files that cannot be mapped, are read through the default file stream.
+ * @param pInstance Handle to the instance.
+ * @param bEnable TRUE to map local files, FALSE to read them through the default file stream.
+ * @return S_OK on success, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT SetMemoryMappedIo(VideoPlayerInstance* pInstance, BOOL bEnable);
+
+/**
+ * @brief Keeps the data of cached network media in a directory, for all instances and later sessions.
+ *
+ * Media opened afterwards are read from the directory where already fetched, so replays do not download
+ * them again. Segments are matched on the URL and length; the least recently used go first beyond the cap.
+ * @param directory Existing directory, or nullptr to stop using the disk cache (files are kept).
+ * @param maxBytes Size cap of the directory content.
+ * @return S_OK on success, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT SetStreamDiskCache(const wchar_t* directory, UINT64 maxBytes);
+
+/**
+ * @brief Gets the byte counters of the stream cache of the open media.
+ *
+ * Mapped local files (see SetMemoryMappedIo) only report bytesRead.
+ * @param pInstance Handle to the instance.
+ * @param pStats Receives the counters.
+ * @return S_OK on success, S_FALSE (counters zeroed) if the media is not read through the cache or a mapping.
+ */
+NATIVEVIDEOPLAYER_API HRESULT GetStreamCacheStats(const VideoPlayerInstance* pInstance, StreamCacheStats* pStats);
+
+/**
+ * @brief Gets the latency histograms and performance counters of the pipeline stages.
+ * @param pInstance Handle to the instance.
+ * @param pStats Receives the statistics since the media was opened.
+ * @return S_OK on success, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT GetPlayerStats(const VideoPlayerInstance* pInstance, PlayerStats* pStats);
+
+/**
+ * @brief Gets the pixel format actually negotiated for the open media.
+ * @param pInstance Handle to the instance.
+ * @param pFormat Receives the output format.
+ * @return S_OK on success, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT GetVideoOutputFormat(const VideoPlayerInstance* pInstance, VideoOutputFormat* pFormat);
+
+/**
+ * @brief Lit la prochaine frame vidéo (RGB32 par défaut, voir OpenMediaEx) pour une instance spécifique.
  * @param pInstance Handle de l'instance.
  * @param pData Reçoit un pointeur sur les données de la frame (à ne pas libérer).
  * @param pDataSize Reçoit la taille en octets du tampon.
@@ -95,6 +392,312 @@ NATIVEVIDEOPLAYER_API HRESULT OpenMedia(VideoPlayerInstance* pInstance, const wc
  */
 NATIVEVIDEOPLAYER_API HRESULT ReadVideoFrame(VideoPlayerInstance* pInstance, BYTE** pData, DWORD* pDataSize);
 
+/**
+ * @brief Reads the next video frame like ReadVideoFrame, and returns it with its description and the playback state.
+ *
+ * Replaces ReadVideoFrame, GetVideoStride, GetMediaPosition, IsEOF and GetVideoQosStats for callers where each call
+ * costs a native transition. The previous frame is unlocked by the read, so UnlockVideoFrame is not needed between frames.
+ * @param pInstance Handle to the instance.
+ * @param pInfo Receives the frame and state (pData is null when no new frame is due).
+ * @return S_OK if a frame is read (pInfo->pData may be null if no frame is due), S_FALSE at end of stream, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT ReadVideoFrameEx(VideoPlayerInstance* pInstance, VideoFrameInfo* pInfo);
+
+/**
+ * @brief Calls ReadVideoFrameEx on several instances at once, for video walls.
+ *
+ * Instances in VIDEO_DECODE_MODE_SYNC wait for their frame in turn; use the decoding-ahead modes so that a batch
+ * only takes the frames that are due and never blocks.
+ * @param ppInstances Array of count instance handles.
+ * @param count Number of instances.
+ * @param pInfos Array of count entries receiving the frame and state of each instance.
+ * @param pResults Optional array of count entries receiving the result of each read.
+ * @return S_OK if at least one instance returned a new frame, S_FALSE otherwise, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT ReadVideoFramesBatch(VideoPlayerInstance** ppInstances, UINT32 count,
+                                                   VideoFrameInfo* pInfos, HRESULT* pResults);
+
+/**
+ * @brief Reads the next video frame without copying it to system memory.
+ *
+ * The frame is returned as the D3D11 texture produced by the hardware decoder, on the
+ * device the instance decodes on (see SetVideoAdapter and GetVideoDevice). The texture stays valid until
+ * the next read or UnlockVideoFrame; the caller must not release it.
+ * @param pInstance Handle to the instance.
+ * @param ppTexture Receives the texture (may be a texture array).
+ * @param pSubresource Receives the subresource index of the frame within the texture.
+ * @param pTimestamp Optional, receives the presentation time (in 100-ns).
+ * @return S_OK if a frame is read (*ppTexture may be null if no frame is due), S_FALSE at end of stream,
+ *         E_NOINTERFACE if the decoder does not output GPU surfaces, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT ReadVideoFrameTexture(VideoPlayerInstance* pInstance, ID3D11Texture2D** ppTexture,
+                                                    UINT* pSubresource, LONGLONG* pTimestamp);
+
+/**
+ * @brief Reads the next video frame into a texture shareable with another D3D device.
+ *
+ * The decoded surface is copied on the GPU into an instance-owned texture exposed through an
+ * NT handle, which can be opened with ID3D11Device1::OpenSharedResource1. The handle is owned by
+ * the instance and stays the same until the video size or format changes, the media is closed, or the
+ * device is lost (the media is then reopened on a new device at the current position).
+ *
+ * Access is synchronised with the texture's keyed mutex (IDXGIKeyedMutex): the instance acquires key 0, copies
+ * the frame and releases key 1. The consumer acquires key 1 before reading and releases key 0 once done, which
+ * lets the next frame be written; a newly created texture starts out at key 0.
+ * @param pInstance Handle to the instance.
+ * @param pSharedHandle Receives the NT handle (do not close it).
+ * @param pTimestamp Optional, receives the presentation time (in 100-ns).
+ * @return S_OK if a frame is read (*pSharedHandle may be null if no frame is due), S_FALSE at end of stream,
+ *         HRESULT_FROM_WIN32(WAIT_TIMEOUT) if the consumer still holds the texture (the frame is dropped),
+ *         or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT ReadVideoFrameSharedHandle(VideoPlayerInstance* pInstance, HANDLE* pSharedHandle, LONGLONG* pTimestamp);
+
+/**
+ * @brief Converts the frame last returned by ReadVideoFrameTexture into a caller-supplied texture.
+ *
+ * Uses the D3D11 video processor for colour conversion and scaling to the destination size. The
+ * destination must be created on the same device with D3D11_BIND_RENDER_TARGET, typically as
+ * DXGI_FORMAT_B8G8R8A8_UNORM, or DXGI_FORMAT_R10G10B10A2_UNORM / R16G16B16A16_FLOAT for HDR content.
+ * @param pInstance Handle to the instance.
+ * @param pDestTexture Destination texture.
+ * @return S_OK on success, S_FALSE if no frame is held, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT ConvertVideoFrameToTexture(VideoPlayerInstance* pInstance, ID3D11Texture2D* pDestTexture);
+
+/**
+ * @brief Selects how video is decoded for the next media opened on this instance.
+ *
+ * In VIDEO_DECODE_MODE_ASYNC the source reader decodes on a Media Foundation work queue into a queue of
+ * up to queueDepth frames; ReadVideoFrame and ReadVideoFrameTexture then never block and return the
+ * frame due at the presentation clock. VIDEO_DECODE_MODE_SCHEDULED behaves the same, with the frames decoded by
+ * a fixed pool of worker threads shared by every instance, ordered by the deadline of each instance's next frame.
+ * @param pInstance Handle to the instance.
+ * @param mode Decode mode.
+ * @param queueDepth Number of decoded frames kept ahead (0 for the default of 4, at most 64).
+ * @return S_OK on success, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT SetVideoDecodeMode(VideoPlayerInstance* pInstance, VideoDecodeMode mode, UINT32 queueDepth);
+
+/**
+ * @brief Sets how the decode scheduler treats this instance in VIDEO_DECODE_MODE_SCHEDULED.
+ *
+ * Can be called at any time; the setting is kept for the following media. Use a low priority and a frame rate
+ * cap for off-screen or thumbnail-sized players so that visible ones keep their deadlines.
+ * @param pInstance Handle to the instance.
+ * @param priority Scheduling class.
+ * @param maxFrameRate Maximum number of frames delivered per second of media, or 0 for every frame.
+ * @return S_OK on success, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT SetDecodePriority(VideoPlayerInstance* pInstance, DecodePriority priority, UINT32 maxFrameRate);
+
+/**
+ * @brief Selects what video frames are paced against, for the next media opened on this instance.
+ *
+ * PACING_MODE_UNPACED is meant for offline work (analysis, hashing, transcoding pre-passes): ReadVideoFrame returns
+ * every frame in order as fast as the decoder produces them, the audio stream is not opened, and the decoder runs
+ * in low-latency mode with a worker thread per logical processor. In the decoding-ahead modes the read does not
+ * block and returns no frame while the queue is empty.
+ * @param pInstance Handle to the instance.
+ * @param mode Pacing mode.
+ * @return S_OK on success, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT SetPacingMode(VideoPlayerInstance* pInstance, PacingMode mode);
+
+/**
+ * @brief Sets the time video frames are paced against in PACING_MODE_EXTERNAL.
+ * @param pInstance Handle to the instance.
+ * @param llPresentationTime Presentation time (in 100-ns) of the frame to display next.
+ * @return S_OK on success, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT SetPresentationTime(VideoPlayerInstance* pInstance, LONGLONG llPresentationTime);
+
+/**
+ * @brief Enables or disables decoder-side frame dropping when playback falls behind (enabled by default).
+ *
+ * While frames are handed out late the decoder is told to skip non-reference frames, or to decode keyframes only
+ * when far behind and the decoder supports it, instead of decoding and converting frames that are then dropped.
+ * Full decoding resumes once playback is on time again. Can be called at any time.
+ * @param pInstance Handle to the instance.
+ * @param bEnabled TRUE to let the decoder drop frames.
+ * @return S_OK on success, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT SetVideoQualityControl(VideoPlayerInstance* pInstance, BOOL bEnabled);
+
+/**
+ * @brief Gets the frame delivery counters of the open media.
+ * @param pInstance Handle to the instance.
+ * @param pStats Receives the counters.
+ * @return S_OK on success, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT GetVideoQosStats(const VideoPlayerInstance* pInstance, VideoQosStats* pStats);
+
+/**
+ * @brief Gets the number of hardware adapters that SetVideoAdapter can select.
+ * @param pCount Receives the number of adapters.
+ * @return S_OK on success, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT GetVideoAdapterCount(UINT32* pCount);
+
+/**
+ * @brief Describes a hardware adapter.
+ * @param adapterIndex Adapter index, below the count returned by GetVideoAdapterCount.
+ * @param pInfo Receives the description.
+ * @return S_OK on success, OP_E_INVALID_PARAMETER for an unknown index.
+ */
+NATIVEVIDEOPLAYER_API HRESULT GetVideoAdapterInfo(UINT32 adapterIndex, VideoAdapterInfo* pInfo);
+
+/**
+ * @brief Selects the GPU device the next media opened on this instance decodes on.
+ *
+ * With an adapter index or VIDEO_ADAPTER_AUTO the instance gets a D3D11 device and DXGI device manager of its own,
+ * so its decoder does not share a device lock with other instances; VIDEO_ADAPTER_AUTO picks the adapter with the
+ * fewest devices in use. VIDEO_ADAPTER_SHARED (the default) keeps the device shared by all instances. Textures
+ * returned by ReadVideoFrameTexture belong to the instance's device (see GetVideoDevice).
+ * @param pInstance Handle to the instance.
+ * @param adapter Adapter index, VIDEO_ADAPTER_AUTO or VIDEO_ADAPTER_SHARED.
+ * @return S_OK on success, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT SetVideoAdapter(VideoPlayerInstance* pInstance, INT32 adapter);
+
+/**
+ * @brief Gets the D3D11 device the instance decodes on.
+ *
+ * The device changes when it is lost (TDR, driver update, GPU switch): the next read reopens the media on a
+ * new device and returns no frame, after which the device should be queried again.
+ * @param pInstance Handle to the instance.
+ * @param ppDevice Receives the device with a reference the caller must release.
+ * @return S_OK on success, OP_E_NOT_INITIALIZED if no device is available.
+ */
+NATIVEVIDEOPLAYER_API HRESULT GetVideoDevice(const VideoPlayerInstance* pInstance, ID3D11Device** ppDevice);
+
+/**
+ * @brief Scales decoded frames to a given size inside the decoding pipeline.
+ *
+ * The source reader's video processor resizes the frames on the GPU, so smaller frames cost proportionally less to
+ * copy. Can be called while a media is open: the change applies from the next frame read, and GetVideoSize then
+ * reports the new size. The setting is kept for the following media.
+ * @param pInstance Handle to the instance.
+ * @param width Output width, or 0 to derive it from height and the aspect ratio.
+ * @param height Output height, or 0 to derive it from width and the aspect ratio (0 x 0 restores the source size).
+ * @return S_OK on success, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT SetOutputSize(VideoPlayerInstance* pInstance, UINT32 width, UINT32 height);
+
+/**
+ * @brief Makes the next media opened on this instance play its audio through the process-wide mixer.
+ *
+ * The mixer owns a single WASAPI render stream for every instance using it, instead of one audio session each;
+ * SetAudioVolume then sets the gain of this instance in the mix. If the decoded format cannot be mixed, the
+ * instance falls back to its own render stream.
+ * @param pInstance Handle to the instance.
+ * @param bShared TRUE to use the mixer.
+ * @return S_OK on success, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT SetSharedAudioMixer(VideoPlayerInstance* pInstance, BOOL bShared);
+
+/**
+ * @brief Selects the latency profile of the audio render stream for the next media opened on this instance.
+ *
+ * Low and exclusive modes run the audio thread under the "Pro Audio" MMCSS task. A mode the device or system
+ * does not support falls back to AUDIO_LATENCY_DEFAULT. The mode only applies to a dedicated render stream:
+ * instances on the shared mixer (SetSharedAudioMixer) play through its stream, whose buffering is fixed.
+ * @param pInstance Handle to the instance.
+ * @param mode Latency profile.
+ * @return S_OK on success, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT SetAudioLatencyMode(VideoPlayerInstance* pInstance, AudioLatencyMode mode);
+
+/**
+ * @brief Selects the master clock of an instance.
+ *
+ * In CLOCK_MODE_AUDIO video frames are paced against the samples actually played by the audio device, so
+ * audio and video cannot drift apart on long media. Media without audio, instances using the shared mixer,
+ * the moments right after a seek and the rest of a media whose audio ends first use the presentation clock.
+ * @param pInstance Handle to the instance.
+ * @param mode Clock mode.
+ * @return S_OK on success, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT SetClockMode(VideoPlayerInstance* pInstance, ClockMode mode);
+
+/**
+ * @brief Gets the output latency of the instance's audio render stream.
+ * @param pInstance Handle to the instance.
+ * @param pLatency Receives the buffer plus stream latency in 100-ns units.
+ * @return S_OK on success, OP_E_NOT_INITIALIZED without a dedicated render stream (no audio, or shared mixer).
+ */
+NATIVEVIDEOPLAYER_API HRESULT GetAudioLatency(const VideoPlayerInstance* pInstance, LONGLONG* pLatency);
+
+/**
+ * @brief Makes the next media opened on this instance use a single source reader for audio and video.
+ *
+ * The media is opened and demuxed once; a demux thread dispatches the samples of both streams to the
+ * video path and the audio thread, and seeks reposition a single reader. Ignored in VIDEO_DECODE_MODE_ASYNC.
+ * @param pInstance Handle to the instance.
+ * @param bShared TRUE to share the reader, FALSE to open a separate audio reader (default).
+ * @return S_OK on success, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT SetSharedSourceReader(VideoPlayerInstance* pInstance, BOOL bShared);
+
+/**
+ * @brief Returns the decoded frame due at a given presentation time without blocking (asynchronous and scheduled modes only).
+ *
+ * Frames older than the one due are discarded. The buffer stays valid until the next read or UnlockVideoFrame.
+ * @param pInstance Handle to the instance.
+ * @param llPresentationTime Presentation time (in 100-ns) to display.
+ * @param pData Receives a pointer to the frame data (do not free).
+ * @param pDataSize Receives the buffer size in bytes.
+ * @param pTimestamp Optional, receives the presentation time of the frame (in 100-ns).
+ * @return S_OK if a new frame is returned, S_FALSE if no new frame is due (see IsEOF),
+ *         MF_E_INVALIDREQUEST if the instance is not in asynchronous mode, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT TryAcquireFrame(VideoPlayerInstance* pInstance, LONGLONG llPresentationTime,
+                                              BYTE** pData, DWORD* pDataSize, LONGLONG* pTimestamp);
+
+/**
+ * @brief Registers caller-owned buffers that ReadVideoFrameToPool copies decoded frames into.
+ *
+ * Frames are written at the given row pitch; NV12 and P010 place the chroma plane right below the
+ * luma plane (pitch * height bytes in). The buffers stay registered across OpenMedia/CloseMedia
+ * until UnregisterFramePool or the instance is destroyed. A registered pool can only be replaced once
+ * every frame read into it has been returned with ReleasePoolFrame.
+ * @param pInstance Handle to the instance.
+ * @param ppBuffers Array of bufferCount buffer pointers (e.g. JVM direct ByteBuffers).
+ * @param bufferCount Number of buffers (1 to 64).
+ * @param bufferSize Size in bytes of every buffer.
+ * @param pitch Destination row pitch in bytes (at least width * bytes per pixel).
+ * @return S_OK on success, MF_E_INVALIDREQUEST while frames of the current pool are in flight, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT RegisterFramePool(VideoPlayerInstance* pInstance, BYTE** ppBuffers, UINT32 bufferCount,
+                                                DWORD bufferSize, UINT32 pitch);
+
+/**
+ * @brief Unregisters the frame pool buffers. No frame may be in flight.
+ * @param pInstance Handle to the instance.
+ * @return S_OK on success, MF_E_INVALIDREQUEST while frames are in flight, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT UnregisterFramePool(VideoPlayerInstance* pInstance);
+
+/**
+ * @brief Reads the next video frame into the next free frame pool buffer.
+ *
+ * The buffer stays reserved, and may be read by the caller, until ReleasePoolFrame is called with its index.
+ * @param pInstance Handle to the instance.
+ * @param pBufferIndex Receives the index of the buffer holding the frame, or UINT32_MAX if no frame is due.
+ * @param pTimestamp Optional, receives the presentation time of the frame (in 100-ns).
+ * @return S_OK if a frame is read (check *pBufferIndex), S_FALSE at end of stream,
+ *         MF_E_SAMPLEALLOCATOR_EMPTY if every buffer is in flight, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT ReadVideoFrameToPool(VideoPlayerInstance* pInstance, UINT32* pBufferIndex, LONGLONG* pTimestamp);
+
+/**
+ * @brief Returns a frame pool buffer filled by ReadVideoFrameToPool.
+ * @param pInstance Handle to the instance.
+ * @param bufferIndex Index of the buffer.
+ * @return S_OK on success, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT ReleasePoolFrame(VideoPlayerInstance* pInstance, UINT32 bufferIndex);
+
 /**
  * @brief Déverrouille le tampon de la frame vidéo précédemment verrouillé pour une instance spécifique.
  * @param pInstance Handle de l'instance.
@@ -132,6 +735,16 @@ NATIVEVIDEOPLAYER_API void GetVideoSize(const VideoPlayerInstance* pInstance, UI
  */
 NATIVEVIDEOPLAYER_API HRESULT GetVideoFrameRate(const VideoPlayerInstance* pInstance, UINT* pNum, UINT* pDenom);
 
+/**
+ * @brief Gets the row stride of the frames delivered by the read functions.
+ *
+ * Follows the output type the decoder negotiated, including changes in the middle of the stream.
+ * @param pInstance Handle to the instance.
+ * @param pStride Receives the stride in bytes (negative for bottom-up images).
+ * @return S_OK on success, MF_E_ATTRIBUTENOTFOUND if the output type does not define one, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT GetVideoStride(const VideoPlayerInstance* pInstance, LONG* pStride);
+
 /**
  * @brief Recherche une position spécifique dans le média pour une instance spécifique.
  * @param pInstance Handle de l'instance.
@@ -140,6 +753,40 @@ NATIVEVIDEOPLAYER_API HRESULT GetVideoFrameRate(const VideoPlayerInstance* pInst
  */
 NATIVEVIDEOPLAYER_API HRESULT SeekMedia(VideoPlayerInstance* pInstance, LONGLONG llPosition);
 
+/**
+ * @brief Seeks to a position with the given accuracy.
+ *
+ * The keyframes of a local file are indexed in the background from its first fast seek on; until the index
+ * covers the position, and always for network media, a fast seek behaves like SEEK_MODE_DEFAULT.
+ * Frames decoded forward by an accurate seek are dropped without being copied out.
+ * @param pInstance Handle to the instance.
+ * @param llPosition Position (in 100-ns) to seek to.
+ * @param mode Seek mode.
+ * @return S_OK on success, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT SeekMediaEx(VideoPlayerInstance* pInstance, LONGLONG llPosition, SeekMode mode);
+
+/**
+ * @brief Extracts thumbnails at a list of positions without creating a player instance.
+ *
+ * A single video-only source reader is opened (no audio, clock or WASAPI) and seeks from keyframe to keyframe in
+ * increasing time order, so each frame is the keyframe at or before its requested position.
+ * Frames are scaled on the GPU by the Media Foundation video processor and handed to the callback in batches.
+ * @param url Path or URL of the media.
+ * @param pTimestamps Array of count positions, in 100-ns units, in any order.
+ * @param count Number of positions.
+ * @param targetWidth Thumbnail width in pixels, or 0 to derive it from targetHeight and the aspect ratio.
+ * @param targetHeight Thumbnail height in pixels, or 0 to derive it from targetWidth and the aspect ratio.
+ * @param format VIDEO_OUTPUT_FORMAT_RGB32 or VIDEO_OUTPUT_FORMAT_NV12.
+ * @param batchSize Frames per callback (0 for the default of 16, at most 64).
+ * @param callback Receives the frames.
+ * @param pUserData Passed to the callback.
+ * @return S_OK on success, S_FALSE if the callback stopped the extraction, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT ExtractFrames(const wchar_t* url, const LONGLONG* pTimestamps, UINT32 count,
+                                            UINT32 targetWidth, UINT32 targetHeight, VideoOutputFormat format,
+                                            UINT32 batchSize, ExtractFramesCallback callback, void* pUserData);
+
 /**
  * @brief Obtient la durée totale du média pour une instance spécifique.
  * @param pInstance Handle de l'instance.
@@ -196,6 +843,18 @@ NATIVEVIDEOPLAYER_API HRESULT GetAudioVolume(const VideoPlayerInstance* pInstanc
  */
 NATIVEVIDEOPLAYER_API HRESULT GetAudioLevels(const VideoPlayerInstance* pInstance, float* pLeftLevel, float* pRightLevel);
 
+/**
+ * @brief Gets the peak and RMS levels of an instance's own audio output.
+ *
+ * Levels are metered by the instance's audio thread (or its input to the shared mixer) as it writes, so
+ * the call is a wait-free read and other instances do not affect it. Mono media reports the same levels
+ * on both sides; levels drop to zero while paused.
+ * @param pInstance Handle to the instance.
+ * @param pLevels Receives the levels.
+ * @return S_OK on success, or an error code.
+ */
+NATIVEVIDEOPLAYER_API HRESULT GetAudioLevelsEx(const VideoPlayerInstance* pInstance, AudioLevels* pLevels);
+
 /**
  * @brief Définit la vitesse de lecture pour une instance spécifique.
  * @param pInstance Handle de l'instance.
@@ -0,0 +1,183 @@
+#include "PlayerMetrics.h"
+#include "NativeVideoPlayer.h"
+#include <intrin.h>
+#include <algorithm>
+
+#ifdef NATIVEVIDEOPLAYER_TRACELOGGING
+#include <TraceLoggingProvider.h>
+
+// Name-hashed provider id of "NativeVideoPlayer", as tools derive it from the name
+TRACELOGGING_DEFINE_PROVIDER(g_hTraceProvider, "NativeVideoPlayer",
+    (0x67dbb31d, 0xcd98, 0x533d, 0x3f, 0x51, 0x53, 0x23, 0x11, 0x78, 0xe6, 0xe6));
+#endif
+
+namespace {
+
+const char* const kStageNames[PlayerMetrics::kStageCount] = {
+    "VideoDecode", "VideoLock", "ColorConversion", "PacingError", "AudioDecode", "AudioDrift"
+};
+const char* const kCounterNames[PlayerMetrics::kCounterCount] = {
+    "VideoFrames", "AudioUnderruns", "AudioSamplesDropped", "AudioSamplesDelayed"
+};
+
+LONGLONG QpcFrequency()
+{
+    static const LONGLONG frequency = [] {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        return f.QuadPart;
+    }();
+    return frequency;
+}
+
+UINT32 ClampToUInt32(UINT64 value)
+{
+    return static_cast<UINT32>(std::min<UINT64>(value, UINT32_MAX));
+}
+
+} // namespace
+
+int LatencyHistogram::BucketOf(UINT64 microseconds)
+{
+    microseconds = std::min<UINT64>(microseconds, UINT32_MAX);
+    if (microseconds < kSubBuckets)
+        return static_cast<int>(microseconds);
+
+    // The top kSubBucketBits + 1 bits select the bucket: the power of two, then the linear step within it
+    unsigned long msb = 0;
+    _BitScanReverse64(&msb, microseconds);
+    const int shift = static_cast<int>(msb) - kSubBucketBits;
+    return (shift + 1) * kSubBuckets + static_cast<int>((microseconds >> shift) - kSubBuckets);
+}
+
+UINT64 LatencyHistogram::HighestValueOf(int bucket)
+{
+    if (bucket < kSubBuckets)
+        return static_cast<UINT64>(bucket);
+    const int shift = bucket / kSubBuckets - 1;
+    const UINT64 lowest = static_cast<UINT64>(kSubBuckets + bucket % kSubBuckets) << shift;
+    return lowest + (1ULL << shift) - 1;
+}
+
+void LatencyHistogram::Record(UINT64 microseconds)
+{
+    m_buckets[BucketOf(microseconds)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(microseconds, std::memory_order_relaxed);
+    UINT64 max = m_max.load(std::memory_order_relaxed);
+    while (microseconds > max && !m_max.compare_exchange_weak(max, microseconds, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::Reset()
+{
+    for (auto& bucket : m_buckets)
+        bucket.store(0, std::memory_order_relaxed);
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::GetStats(LatencyStats* pStats) const
+{
+    // Concurrent records may land between the loads; the percentiles use the bucket total so they stay consistent
+    UINT64 counts[kBucketCount];
+    UINT64 total = 0;
+    for (int i = 0; i < kBucketCount; ++i) {
+        counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    *pStats = {};
+    pStats->count = total;
+    if (!total)
+        return;
+    pStats->meanUs = ClampToUInt32(m_sum.load(std::memory_order_relaxed) / std::max<UINT64>(m_count.load(std::memory_order_relaxed), 1));
+    pStats->maxUs = ClampToUInt32(m_max.load(std::memory_order_relaxed));
+
+    auto percentile = [&](UINT64 perThousand) -> UINT32 {
+        const UINT64 rank = std::max<UINT64>((total * perThousand + 999) / 1000, 1);
+        UINT64 seen = 0;
+        for (int i = 0; i < kBucketCount; ++i) {
+            seen += counts[i];
+            if (seen >= rank)
+                return ClampToUInt32(std::min(HighestValueOf(i), static_cast<UINT64>(pStats->maxUs)));
+        }
+        return pStats->maxUs;
+    };
+    pStats->p50Us = percentile(500);
+    pStats->p90Us = percentile(900);
+    pStats->p99Us = percentile(990);
+}
+
+void PlayerMetrics::Record(Stage stage, UINT64 microseconds)
+{
+    m_stages[stage].Record(microseconds);
+#ifdef NATIVEVIDEOPLAYER_TRACELOGGING
+    TraceLoggingWrite(g_hTraceProvider, "StageLatency",
+                      TraceLoggingPointer(this, "Instance"),
+                      TraceLoggingString(kStageNames[stage], "Stage"),
+                      TraceLoggingUInt64(microseconds, "Microseconds"));
+#endif
+}
+
+void PlayerMetrics::Increment(Counter counter)
+{
+    m_counters[counter].fetch_add(1, std::memory_order_relaxed);
+#ifdef NATIVEVIDEOPLAYER_TRACELOGGING
+    // Frames are already traced through their stages
+    if (counter != kVideoFrames)
+        TraceLoggingWrite(g_hTraceProvider, "Counter",
+                          TraceLoggingPointer(this, "Instance"),
+                          TraceLoggingString(kCounterNames[counter], "Counter"));
+#endif
+}
+
+void PlayerMetrics::Reset()
+{
+    for (auto& histogram : m_stages)
+        histogram.Reset();
+    for (auto& counter : m_counters)
+        counter.store(0, std::memory_order_relaxed);
+}
+
+void PlayerMetrics::GetStats(PlayerStats* pStats) const
+{
+    m_stages[kVideoDecode].GetStats(&pStats->videoDecode);
+    m_stages[kVideoLock].GetStats(&pStats->videoLock);
+    m_stages[kColorConversion].GetStats(&pStats->colorConversion);
+    m_stages[kPacingError].GetStats(&pStats->pacingError);
+    m_stages[kAudioDecode].GetStats(&pStats->audioDecode);
+    m_stages[kAudioDrift].GetStats(&pStats->audioDrift);
+    pStats->videoFrames = m_counters[kVideoFrames].load(std::memory_order_relaxed);
+    pStats->audioUnderruns = m_counters[kAudioUnderruns].load(std::memory_order_relaxed);
+    pStats->audioSamplesDropped = m_counters[kAudioSamplesDropped].load(std::memory_order_relaxed);
+    pStats->audioSamplesDelayed = m_counters[kAudioSamplesDelayed].load(std::memory_order_relaxed);
+}
+
+LONGLONG PlayerMetrics::Now()
+{
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return now.QuadPart;
+}
+
+UINT64 PlayerMetrics::MicrosecondsSince(LONGLONG start)
+{
+    const LONGLONG elapsed = Now() - start;
+    return elapsed > 0 ? static_cast<UINT64>(elapsed) * 1'000'000 / static_cast<UINT64>(QpcFrequency()) : 0;
+}
+
+void PlayerMetrics::RegisterTraceProvider()
+{
+#ifdef NATIVEVIDEOPLAYER_TRACELOGGING
+    TraceLoggingRegister(g_hTraceProvider);
+#endif
+}
+
+void PlayerMetrics::UnregisterTraceProvider()
+{
+#ifdef NATIVEVIDEOPLAYER_TRACELOGGING
+    TraceLoggingUnregister(g_hTraceProvider);
+#endif
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <windows.h>
+#include <atomic>
+
+struct LatencyStats;
+struct PlayerStats;
+
+/**
+ * @brief Lock-free latency histogram with logarithmic buckets, in the manner of HDR histograms.
+ *
+ * Values are microseconds, kept exactly below kSubBuckets and in kSubBuckets linear sub-buckets per power of
+ * two above, so percentiles are within 1 / kSubBuckets of the recorded value. Recording is a few relaxed
+ * atomic increments; any thread can record or read at the same time.
+ */
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 3;
+    static constexpr int kSubBuckets = 1 << kSubBucketBits;
+    static constexpr int kBucketCount = (32 - kSubBucketBits + 1) * kSubBuckets;    // Up to 2^32 us
+
+    void Record(UINT64 microseconds);
+    void Reset();
+    void GetStats(LatencyStats* pStats) const;
+
+private:
+    static int BucketOf(UINT64 microseconds);
+    static UINT64 HighestValueOf(int bucket);
+
+    std::atomic<UINT64> m_buckets[kBucketCount] = {};
+    std::atomic<UINT64> m_count{0};
+    std::atomic<UINT64> m_sum{0};
+    std::atomic<UINT64> m_max{0};
+};
+
+/**
+ * @brief Performance counters and per-stage latency histograms of one instance (see GetPlayerStats).
+ *
+ * When built with NATIVEVIDEOPLAYER_TRACELOGGING, every sample and counted event is also written as a
+ * TraceLogging event of the "NativeVideoPlayer" provider while a session listens to it.
+ */
+class PlayerMetrics {
+public:
+    enum Stage {
+        kVideoDecode,           // ReadSample of a video frame, decoded ahead or not
+        kVideoLock,             // Contiguous buffer conversion and Lock
+        kColorConversion,       // D3D11 video processor blit
+        kPacingError,           // Lateness of the wakeup of a pacing wait
+        kAudioDecode,           // ReadSample of an audio sample
+        kAudioDrift,            // Distance between the audio heard and the presentation clock
+        kStageCount
+    };
+
+    enum Counter {
+        kVideoFrames,           // Frames handed out
+        kAudioUnderruns,        // Output found empty while playing
+        kAudioSamplesDropped,   // Skipped to catch up with the clock
+        kAudioSamplesDelayed,   // Held back to let the clock catch up
+        kCounterCount
+    };
+
+    PlayerMetrics() = default;
+    PlayerMetrics(const PlayerMetrics&) = delete;
+    PlayerMetrics& operator=(const PlayerMetrics&) = delete;
+
+    void Record(Stage stage, UINT64 microseconds);
+    void Increment(Counter counter);
+    void Reset();
+    void GetStats(PlayerStats* pStats) const;
+
+    /**
+     * @brief Gets a timestamp for MicrosecondsSince (performance counter ticks).
+     */
+    static LONGLONG Now();
+    static UINT64 MicrosecondsSince(LONGLONG start);
+
+    /**
+     * @brief Registers and unregisters the TraceLogging provider (no-ops without NATIVEVIDEOPLAYER_TRACELOGGING).
+     */
+    static void RegisterTraceProvider();
+    static void UnregisterTraceProvider();
+
+private:
+    LatencyHistogram m_stages[kStageCount];
+    std::atomic<UINT64> m_counters[kCounterCount] = {};
+};
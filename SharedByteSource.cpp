@@ -0,0 +1,284 @@
+#include "SharedByteSource.h"
+#include <mfapi.h>
+
+namespace {
+
+// State of a BeginRead, carried to the work item and back to the caller in EndRead
+class ReadRequest : public IUnknown {
+public:
+    ReadRequest(BYTE* pBuffer, ULONG cb, QWORD offset)
+        : m_pBuffer(pBuffer), m_cb(cb), m_offset(offset) {}
+
+    STDMETHODIMP QueryInterface(REFIID riid, void** ppv) override
+    {
+        if (!ppv) return E_POINTER;
+        if (riid == __uuidof(IUnknown)) {
+            *ppv = static_cast<IUnknown*>(this);
+            AddRef();
+            return S_OK;
+        }
+        *ppv = nullptr;
+        return E_NOINTERFACE;
+    }
+    STDMETHODIMP_(ULONG) AddRef() override { return ++m_refCount; }
+    STDMETHODIMP_(ULONG) Release() override
+    {
+        ULONG count = --m_refCount;
+        if (count == 0) delete this;
+        return count;
+    }
+
+    /**
+     * @brief Completes the caller's result, which holds this request as its object.
+     */
+    void Complete(HRESULT hr)
+    {
+        // The result references this request: drop ours before invoking to break the cycle
+        IMFAsyncResult* pResult = m_pCallerResult;
+        m_pCallerResult = nullptr;
+        pResult->SetStatus(hr);
+        MFInvokeCallback(pResult);
+        pResult->Release();
+    }
+
+    BYTE* m_pBuffer;
+    ULONG m_cb;
+    QWORD m_offset;
+    ULONG m_cbRead = 0;
+    IMFAsyncResult* m_pCallerResult = nullptr;
+
+private:
+    ~ReadRequest() { if (m_pCallerResult) m_pCallerResult->Release(); }
+
+    std::atomic<ULONG> m_refCount{1};
+};
+
+// View handed to one source reader. Reads complete on the Media Foundation I/O work queue.
+class ByteStreamView : public IMFByteStream, public IMFAttributes, public IMFAsyncCallback {
+public:
+    ByteStreamView(SharedByteSource* pSource, IMFAttributes* pAttributes)
+        : m_pSource(pSource), m_pAttributes(pAttributes)
+    {
+        m_pSource->AddRef();
+    }
+
+    // IUnknown
+    STDMETHODIMP QueryInterface(REFIID riid, void** ppv) override
+    {
+        if (!ppv) return E_POINTER;
+        if (riid == __uuidof(IUnknown) || riid == __uuidof(IMFByteStream)) {
+            *ppv = static_cast<IMFByteStream*>(this);
+        } else if (riid == __uuidof(IMFAttributes)) {
+            *ppv = static_cast<IMFAttributes*>(this);
+        } else if (riid == __uuidof(IMFAsyncCallback)) {
+            *ppv = static_cast<IMFAsyncCallback*>(this);
+        } else {
+            *ppv = nullptr;
+            return E_NOINTERFACE;
+        }
+        AddRef();
+        return S_OK;
+    }
+    STDMETHODIMP_(ULONG) AddRef() override { return ++m_refCount; }
+    STDMETHODIMP_(ULONG) Release() override
+    {
+        ULONG count = --m_refCount;
+        if (count == 0) delete this;
+        return count;
+    }
+
+    // IMFByteStream
+    STDMETHODIMP GetCapabilities(DWORD* pdwCapabilities) override
+    {
+        if (!pdwCapabilities) return E_POINTER;
+        *pdwCapabilities = m_pSource->GetCapabilities() & (MFBYTESTREAM_IS_READABLE | MFBYTESTREAM_IS_SEEKABLE |
+                                                          MFBYTESTREAM_IS_REMOTE | MFBYTESTREAM_HAS_SLOW_SEEK);
+        return S_OK;
+    }
+    STDMETHODIMP GetLength(QWORD* pqwLength) override
+    {
+        if (!pqwLength) return E_POINTER;
+        *pqwLength = m_pSource->GetLength();
+        return S_OK;
+    }
+    STDMETHODIMP SetLength(QWORD) override { return E_NOTIMPL; }
+    STDMETHODIMP GetCurrentPosition(QWORD* pqwPosition) override
+    {
+        if (!pqwPosition) return E_POINTER;
+        *pqwPosition = m_position.load(std::memory_order_acquire);
+        return S_OK;
+    }
+    STDMETHODIMP SetCurrentPosition(QWORD qwPosition) override
+    {
+        const QWORD length = m_pSource->GetLength();
+        if (length != static_cast<QWORD>(-1) && qwPosition > length)
+            return E_INVALIDARG;
+        const QWORD previous = m_position.exchange(qwPosition, std::memory_order_acq_rel);
+        if (qwPosition != previous)
+            m_pSource->OnSeek(previous, qwPosition);
+        return S_OK;
+    }
+    STDMETHODIMP IsEndOfStream(BOOL* pfEndOfStream) override
+    {
+        if (!pfEndOfStream) return E_POINTER;
+        const QWORD length = m_pSource->GetLength();
+        *pfEndOfStream = length != static_cast<QWORD>(-1) && m_position.load(std::memory_order_acquire) >= length;
+        return S_OK;
+    }
+    STDMETHODIMP Read(BYTE* pb, ULONG cb, ULONG* pcbRead) override
+    {
+        if (!pb || !pcbRead) return E_POINTER;
+        const QWORD offset = m_position.load(std::memory_order_acquire);
+        HRESULT hr = m_pSource->Read(offset, pb, cb, pcbRead);
+        if (SUCCEEDED(hr))
+            m_position.store(offset + *pcbRead, std::memory_order_release);
+        return hr;
+    }
+    STDMETHODIMP BeginRead(BYTE* pb, ULONG cb, IMFAsyncCallback* pCallback, IUnknown* punkState) override
+    {
+        if (!pb || !pCallback) return E_POINTER;
+
+        // The position moves on at once, as sources may issue the next read before this one completes
+        const QWORD offset = m_position.fetch_add(cb, std::memory_order_acq_rel);
+        auto* pRequest = new (std::nothrow) ReadRequest(pb, cb, offset);
+        if (!pRequest)
+            return E_OUTOFMEMORY;
+        HRESULT hr = MFCreateAsyncResult(pRequest, pCallback, punkState, &pRequest->m_pCallerResult);
+        if (SUCCEEDED(hr))
+            hr = MFPutWorkItem(MFASYNC_CALLBACK_QUEUE_IO, this, pRequest);
+        if (FAILED(hr)) {
+            if (pRequest->m_pCallerResult) pRequest->m_pCallerResult->Release();
+            pRequest->m_pCallerResult = nullptr;
+            m_position.store(offset, std::memory_order_release);
+        }
+        pRequest->Release();
+        return hr;
+    }
+    STDMETHODIMP EndRead(IMFAsyncResult* pResult, ULONG* pcbRead) override
+    {
+        if (!pResult || !pcbRead) return E_POINTER;
+        IUnknown* pObject = nullptr;
+        HRESULT hr = pResult->GetObject(&pObject);
+        if (FAILED(hr))
+            return hr;
+        *pcbRead = static_cast<ReadRequest*>(pObject)->m_cbRead;
+        pObject->Release();
+        return pResult->GetStatus();
+    }
+    STDMETHODIMP Write(const BYTE*, ULONG, ULONG*) override { return E_NOTIMPL; }
+    STDMETHODIMP BeginWrite(const BYTE*, ULONG, IMFAsyncCallback*, IUnknown*) override { return E_NOTIMPL; }
+    STDMETHODIMP EndWrite(IMFAsyncResult*, ULONG*) override { return E_NOTIMPL; }
+    STDMETHODIMP Seek(MFBYTESTREAM_SEEK_ORIGIN origin, LONGLONG llSeekOffset, DWORD, QWORD* pqwCurrentPosition) override
+    {
+        const LONGLONG base = origin == msoCurrent ? static_cast<LONGLONG>(m_position.load(std::memory_order_acquire)) : 0;
+        if (base + llSeekOffset < 0)
+            return E_INVALIDARG;
+        HRESULT hr = SetCurrentPosition(static_cast<QWORD>(base + llSeekOffset));
+        if (SUCCEEDED(hr) && pqwCurrentPosition)
+            *pqwCurrentPosition = m_position.load(std::memory_order_acquire);
+        return hr;
+    }
+    STDMETHODIMP Flush() override { return S_OK; }
+    STDMETHODIMP Close() override { return S_OK; }
+
+    // IMFAsyncCallback: completes a BeginRead on the I/O work queue
+    STDMETHODIMP GetParameters(DWORD*, DWORD*) override { return E_NOTIMPL; }
+    STDMETHODIMP Invoke(IMFAsyncResult* pWorkResult) override
+    {
+        IUnknown* pState = nullptr;
+        HRESULT hr = pWorkResult->GetState(&pState);
+        if (FAILED(hr))
+            return hr;
+        auto* pRequest = static_cast<ReadRequest*>(pState);
+        hr = m_pSource->Read(pRequest->m_offset, pRequest->m_pBuffer, pRequest->m_cb, &pRequest->m_cbRead);
+        // A short read leaves the position at the end of the data actually read
+        if (SUCCEEDED(hr) && pRequest->m_cbRead < pRequest->m_cb) {
+            QWORD expected = pRequest->m_offset + pRequest->m_cb;
+            m_position.compare_exchange_strong(expected, pRequest->m_offset + pRequest->m_cbRead, std::memory_order_acq_rel);
+        }
+        pRequest->Complete(hr);
+        pState->Release();
+        return S_OK;
+    }
+
+    // IMFAttributes, so that the source resolver sees the content type and origin name of the upstream stream
+    STDMETHODIMP GetItem(REFGUID guidKey, PROPVARIANT* pValue) override { return m_pAttributes->GetItem(guidKey, pValue); }
+    STDMETHODIMP GetItemType(REFGUID guidKey, MF_ATTRIBUTE_TYPE* pType) override { return m_pAttributes->GetItemType(guidKey, pType); }
+    STDMETHODIMP CompareItem(REFGUID guidKey, REFPROPVARIANT value, BOOL* pbResult) override { return m_pAttributes->CompareItem(guidKey, value, pbResult); }
+    STDMETHODIMP Compare(IMFAttributes* pTheirs, MF_ATTRIBUTES_MATCH_TYPE matchType, BOOL* pbResult) override { return m_pAttributes->Compare(pTheirs, matchType, pbResult); }
+    STDMETHODIMP GetUINT32(REFGUID guidKey, UINT32* punValue) override { return m_pAttributes->GetUINT32(guidKey, punValue); }
+    STDMETHODIMP GetUINT64(REFGUID guidKey, UINT64* punValue) override { return m_pAttributes->GetUINT64(guidKey, punValue); }
+    STDMETHODIMP GetDouble(REFGUID guidKey, double* pfValue) override { return m_pAttributes->GetDouble(guidKey, pfValue); }
+    STDMETHODIMP GetGUID(REFGUID guidKey, GUID* pguidValue) override { return m_pAttributes->GetGUID(guidKey, pguidValue); }
+    STDMETHODIMP GetStringLength(REFGUID guidKey, UINT32* pcchLength) override { return m_pAttributes->GetStringLength(guidKey, pcchLength); }
+    STDMETHODIMP GetString(REFGUID guidKey, LPWSTR pwszValue, UINT32 cchBufSize, UINT32* pcchLength) override { return m_pAttributes->GetString(guidKey, pwszValue, cchBufSize, pcchLength); }
+    STDMETHODIMP GetAllocatedString(REFGUID guidKey, LPWSTR* ppwszValue, UINT32* pcchLength) override { return m_pAttributes->GetAllocatedString(guidKey, ppwszValue, pcchLength); }
+    STDMETHODIMP GetBlobSize(REFGUID guidKey, UINT32* pcbBlobSize) override { return m_pAttributes->GetBlobSize(guidKey, pcbBlobSize); }
+    STDMETHODIMP GetBlob(REFGUID guidKey, UINT8* pBuf, UINT32 cbBufSize, UINT32* pcbBlobSize) override { return m_pAttributes->GetBlob(guidKey, pBuf, cbBufSize, pcbBlobSize); }
+    STDMETHODIMP GetAllocatedBlob(REFGUID guidKey, UINT8** ppBuf, UINT32* pcbSize) override { return m_pAttributes->GetAllocatedBlob(guidKey, ppBuf, pcbSize); }
+    STDMETHODIMP GetUnknown(REFGUID guidKey, REFIID riid, LPVOID* ppv) override { return m_pAttributes->GetUnknown(guidKey, riid, ppv); }
+    STDMETHODIMP SetItem(REFGUID guidKey, REFPROPVARIANT value) override { return m_pAttributes->SetItem(guidKey, value); }
+    STDMETHODIMP DeleteItem(REFGUID guidKey) override { return m_pAttributes->DeleteItem(guidKey); }
+    STDMETHODIMP DeleteAllItems() override { return m_pAttributes->DeleteAllItems(); }
+    STDMETHODIMP SetUINT32(REFGUID guidKey, UINT32 unValue) override { return m_pAttributes->SetUINT32(guidKey, unValue); }
+    STDMETHODIMP SetUINT64(REFGUID guidKey, UINT64 unValue) override { return m_pAttributes->SetUINT64(guidKey, unValue); }
+    STDMETHODIMP SetDouble(REFGUID guidKey, double fValue) override { return m_pAttributes->SetDouble(guidKey, fValue); }
+    STDMETHODIMP SetGUID(REFGUID guidKey, REFGUID guidValue) override { return m_pAttributes->SetGUID(guidKey, guidValue); }
+    STDMETHODIMP SetString(REFGUID guidKey, LPCWSTR wszValue) override { return m_pAttributes->SetString(guidKey, wszValue); }
+    STDMETHODIMP SetBlob(REFGUID guidKey, const UINT8* pBuf, UINT32 cbBufSize) override { return m_pAttributes->SetBlob(guidKey, pBuf, cbBufSize); }
+    STDMETHODIMP SetUnknown(REFGUID guidKey, IUnknown* pUnknown) override { return m_pAttributes->SetUnknown(guidKey, pUnknown); }
+    STDMETHODIMP LockStore() override { return m_pAttributes->LockStore(); }
+    STDMETHODIMP UnlockStore() override { return m_pAttributes->UnlockStore(); }
+    STDMETHODIMP GetCount(UINT32* pcItems) override { return m_pAttributes->GetCount(pcItems); }
+    STDMETHODIMP GetItemByIndex(UINT32 unIndex, GUID* pguidKey, PROPVARIANT* pValue) override { return m_pAttributes->GetItemByIndex(unIndex, pguidKey, pValue); }
+    STDMETHODIMP CopyAllItems(IMFAttributes* pDest) override { return m_pAttributes->CopyAllItems(pDest); }
+
+private:
+    ~ByteStreamView()
+    {
+        m_pAttributes->Release();
+        m_pSource->Release();
+    }
+
+    std::atomic<ULONG> m_refCount{1};
+    SharedByteSource* m_pSource;
+    IMFAttributes* m_pAttributes;
+    std::atomic<QWORD> m_position{0};
+};
+
+} // namespace
+
+ULONG SharedByteSource::AddRef()
+{
+    return ++m_refCount;
+}
+
+ULONG SharedByteSource::Release()
+{
+    ULONG count = --m_refCount;
+    if (count == 0) delete this;
+    return count;
+}
+
+HRESULT SharedByteSource::CreateView(IMFByteStream** ppStream)
+{
+    if (!ppStream)
+        return E_POINTER;
+    *ppStream = nullptr;
+
+    IMFAttributes* pAttributes = nullptr;
+    HRESULT hr = MFCreateAttributes(&pAttributes, 2);
+    if (FAILED(hr))
+        return hr;
+    CopyAttributes(pAttributes);
+    if (!m_originName.empty())
+        pAttributes->SetString(MF_BYTESTREAM_ORIGIN_NAME, m_originName.c_str());
+
+    auto* pView = new (std::nothrow) ByteStreamView(this, pAttributes);
+    if (!pView) {
+        pAttributes->Release();
+        return E_OUTOFMEMORY;
+    }
+    *ppStream = pView;
+    return S_OK;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <windows.h>
+#include <mfidl.h>
+#include <atomic>
+#include <string>
+
+struct StreamCacheStats;
+
+/**
+ * @brief Content of one media read by several source readers at once (the audio and video readers of an instance).
+ *
+ * Each reader gets its own IMFByteStream view through CreateView, with an independent position; the views
+ * forward positioned reads to the source, which is thread safe. Implemented by ByteStreamCache (network media and
+ * application byte streams) and MappedFileSource (local files). Reference counted.
+ */
+class SharedByteSource {
+public:
+    SharedByteSource(const SharedByteSource&) = delete;
+    SharedByteSource& operator=(const SharedByteSource&) = delete;
+
+    ULONG AddRef();
+    ULONG Release();
+
+    /**
+     * @brief Creates a byte stream reading from this source, with an independent position.
+     * @param ppStream Receives the stream.
+     * @return S_OK on success, or an error code.
+     */
+    HRESULT CreateView(IMFByteStream** ppStream);
+
+    /**
+     * @brief Copies bytes at an offset.
+     * @param pcbRead Receives the number of bytes copied, short at the end of the stream.
+     * @return S_OK on success, or an error code.
+     */
+    virtual HRESULT Read(QWORD offset, BYTE* pBuffer, ULONG cb, ULONG* pcbRead) = 0;
+
+    /**
+     * @brief Gets the stream length.
+     * @return Length in bytes, or -1 while unknown.
+     */
+    virtual QWORD GetLength() const = 0;
+
+    /**
+     * @brief Gets the MFBYTESTREAM_* capabilities reported by the views.
+     */
+    virtual DWORD GetCapabilities() const = 0;
+
+    /**
+     * @brief Called when a view is moved elsewhere than where its last read ended (the source seeks).
+     */
+    virtual void OnSeek(QWORD /*previousPosition*/, QWORD /*position*/) {}
+
+    virtual void GetStats(StreamCacheStats* pStats) const = 0;
+
+protected:
+    /**
+     * @param originName URL or file name reported to the source resolver to pick the container handler, or empty.
+     */
+    explicit SharedByteSource(const std::wstring& originName) : m_originName(originName) {}
+    virtual ~SharedByteSource() = default;
+
+    /**
+     * @brief Adds the attributes of the underlying stream (content type...) to those of a new view.
+     */
+    virtual void CopyAttributes(IMFAttributes* /*pDest*/) const {}
+
+private:
+    std::atomic<ULONG> m_refCount{1};
+    std::wstring m_originName;
+};
@@ -0,0 +1,246 @@
+#include "StreamDemuxer.h"
+#include <mfapi.h>
+#include <mferror.h>
+
+// Read-ahead limits per stream: a few decoded frames, about one second of audio packets.
+// A queue may grow up to its hard limit while the other stream's consumer is starving,
+// since the samples it waits for can be interleaved behind. Past the hard limit (its consumer
+// is parked, e.g. the audio thread during a pause) the queue drops its oldest packets rather than
+// stalling the starving stream.
+constexpr size_t kMaxQueued[StreamDemuxer::kStreamCount]     = { 3, 50 };
+constexpr size_t kHardMaxQueued[StreamDemuxer::kStreamCount] = { 16, 400 };
+constexpr DWORD  kStopTimeoutMs = 2000;
+
+StreamDemuxer::StreamDemuxer(IMFSourceReader* pReader)
+    : m_pReader(pReader)
+{
+    InitializeCriticalSection(&m_cs);
+    InitializeConditionVariable(&m_cvData);
+    InitializeConditionVariable(&m_cvSpace);
+    if (m_pReader) m_pReader->AddRef();
+
+    // Map the first selected stream of each major type onto its reader index
+    for (DWORD i = 0; m_pReader; ++i) {
+        BOOL selected = FALSE;
+        if (FAILED(m_pReader->GetStreamSelection(i, &selected)))
+            break;
+        if (!selected)
+            continue;
+        IMFMediaType* pType = nullptr;
+        if (SUCCEEDED(m_pReader->GetCurrentMediaType(i, &pType))) {
+            GUID major = GUID_NULL;
+            pType->GetGUID(MF_MT_MAJOR_TYPE, &major);
+            if (major == MFMediaType_Video && m_streamIndex[kVideo] == kNoStream)
+                m_streamIndex[kVideo] = i;
+            else if (major == MFMediaType_Audio && m_streamIndex[kAudio] == kNoStream)
+                m_streamIndex[kAudio] = i;
+            pType->Release();
+        }
+    }
+
+    for (int s = 0; s < kStreamCount; ++s)
+        m_queues[s].bEndOfStream = (m_streamIndex[s] == kNoStream);
+}
+
+StreamDemuxer::~StreamDemuxer()
+{
+    Stop();
+    ClearQueues();
+    if (m_pReader) m_pReader->Release();
+    DeleteCriticalSection(&m_cs);
+}
+
+HRESULT StreamDemuxer::Start()
+{
+    if (!m_pReader) return E_UNEXPECTED;
+    if (m_hThread) return S_OK;
+
+    m_bStopped = false;
+    m_hThread = CreateThread(nullptr, 0, ThreadProc, this, 0, nullptr);
+    return m_hThread ? S_OK : HRESULT_FROM_WIN32(GetLastError());
+}
+
+void StreamDemuxer::Stop()
+{
+    EnterCriticalSection(&m_cs);
+    m_bStopped = true;
+    WakeAllConditionVariable(&m_cvData);
+    WakeAllConditionVariable(&m_cvSpace);
+    LeaveCriticalSection(&m_cs);
+
+    if (m_hThread) {
+        // A ReadSample blocked on the source (a stalled network read) is cancelled by flushing the reader
+        if (WaitForSingleObject(m_hThread, kStopTimeoutMs) == WAIT_TIMEOUT) {
+            m_pReader->Flush(MF_SOURCE_READER_ALL_STREAMS);
+            WaitForSingleObject(m_hThread, INFINITE);
+        }
+        CloseHandle(m_hThread);
+        m_hThread = nullptr;
+    }
+}
+
+void StreamDemuxer::Flush()
+{
+    EnterCriticalSection(&m_cs);
+    m_bPaused = true;
+    m_flushStream = kStreamCount;
+    while (m_bInRead)
+        SleepConditionVariableCS(&m_cvSpace, &m_cs, INFINITE);
+    ClearQueues();
+    for (int s = 0; s < kStreamCount; ++s)
+        m_queues[s].bEndOfStream = (m_streamIndex[s] == kNoStream);
+    m_hrStatus = S_OK;
+    LeaveCriticalSection(&m_cs);
+}
+
+void StreamDemuxer::FlushStream(Stream stream)
+{
+    EnterCriticalSection(&m_cs);
+    m_bPaused = true;
+    m_flushStream = stream;
+    while (m_bInRead)
+        SleepConditionVariableCS(&m_cvSpace, &m_cs, INFINITE);
+    ClearQueue(stream);
+    LeaveCriticalSection(&m_cs);
+}
+
+void StreamDemuxer::Resume()
+{
+    EnterCriticalSection(&m_cs);
+    m_bPaused = false;
+    WakeAllConditionVariable(&m_cvSpace);
+    LeaveCriticalSection(&m_cs);
+}
+
+HRESULT StreamDemuxer::Read(Stream stream, DWORD* pFlags, LONGLONG* pTimestamp, IMFSample** ppSample, DWORD timeoutMs)
+{
+    *pFlags = 0;
+    *pTimestamp = 0;
+    *ppSample = nullptr;
+
+    EnterCriticalSection(&m_cs);
+    StreamQueue& queue = m_queues[stream];
+    HRESULT hr = S_OK;
+    for (;;) {
+        if (m_bStopped) { hr = MF_E_SHUTDOWN; break; }
+        if (!queue.packets.empty()) {
+            Packet packet = queue.packets.front();
+            queue.packets.pop_front();
+            *pFlags = packet.flags;
+            *pTimestamp = packet.timestamp;
+            *ppSample = packet.pSample;
+            break;
+        }
+        if (queue.bEndOfStream) { *pFlags = MF_SOURCE_READERF_ENDOFSTREAM; break; }
+        if (FAILED(m_hrStatus)) { hr = m_hrStatus; break; }
+
+        queue.bConsumerWaiting = true;
+        WakeAllConditionVariable(&m_cvSpace);
+        if (!SleepConditionVariableCS(&m_cvData, &m_cs, timeoutMs) && GetLastError() == ERROR_TIMEOUT)
+            break;  // S_OK without a sample, as a starved decoder would return
+    }
+    queue.bConsumerWaiting = false;
+    WakeAllConditionVariable(&m_cvSpace);
+    LeaveCriticalSection(&m_cs);
+    return hr;
+}
+
+DWORD WINAPI StreamDemuxer::ThreadProc(LPVOID lpParam)
+{
+    static_cast<StreamDemuxer*>(lpParam)->Run();
+    return 0;
+}
+
+bool StreamDemuxer::CanReadAhead() const
+{
+    bool bAllEnded = true;
+    bool bStarving = false;
+    bool bBelowTarget = false;
+    bool bAtHardLimit = false;
+    for (int s = 0; s < kStreamCount; ++s) {
+        const StreamQueue& queue = m_queues[s];
+        if (queue.bEndOfStream) continue;
+        bAllEnded = false;
+        if (queue.packets.empty() && queue.bConsumerWaiting) bStarving = true;
+        if (queue.packets.size() < kMaxQueued[s]) bBelowTarget = true;
+        if (queue.packets.size() >= kHardMaxQueued[s]) bAtHardLimit = true;
+    }
+    if (bAllEnded) return false;
+    if (bStarving) return true;
+    return bBelowTarget && !bAtHardLimit;
+}
+
+void StreamDemuxer::Run()
+{
+    EnterCriticalSection(&m_cs);
+    while (!m_bStopped) {
+        if (m_bPaused || FAILED(m_hrStatus) || !CanReadAhead()) {
+            SleepConditionVariableCS(&m_cvSpace, &m_cs, INFINITE);
+            continue;
+        }
+
+        m_bInRead = true;
+        LeaveCriticalSection(&m_cs);
+
+        DWORD streamIndex = 0, flags = 0;
+        LONGLONG timestamp = 0;
+        IMFSample* pSample = nullptr;
+        HRESULT hr = m_pReader->ReadSample(MF_SOURCE_READER_ANY_STREAM, 0, &streamIndex, &flags, &timestamp, &pSample);
+
+        EnterCriticalSection(&m_cs);
+        m_bInRead = false;
+        WakeAllConditionVariable(&m_cvSpace); // Flush may be waiting for the read to finish
+
+        int target = -1;
+        for (int s = 0; s < kStreamCount; ++s)
+            if (m_streamIndex[s] == streamIndex) target = s;
+
+        if (FAILED(hr) || (flags & MF_SOURCE_READERF_ERROR)) {
+            m_hrStatus = FAILED(hr) ? hr : E_FAIL;
+            if (pSample) pSample->Release();
+        } else if (m_bPaused && (m_flushStream == kStreamCount || m_flushStream == target)) {
+            // A flush started while reading: the sample belongs to the old position (or output type)
+            if (pSample) pSample->Release();
+        } else {
+            if (target >= 0) {
+                Packet packet;
+                packet.pSample = pSample;
+                packet.flags = flags & ~MF_SOURCE_READERF_ENDOFSTREAM;
+                packet.timestamp = timestamp;
+                std::deque<Packet>& packets = m_queues[target].packets;
+                if (pSample || packet.flags) {
+                    if (packets.size() >= kHardMaxQueued[target]) {
+                        if (packets.front().pSample) packets.front().pSample->Release();
+                        packets.pop_front();
+                    }
+                    packets.push_back(packet);
+                }
+                if (flags & MF_SOURCE_READERF_ENDOFSTREAM)
+                    m_queues[target].bEndOfStream = true;
+            } else if (pSample) {
+                pSample->Release();
+            }
+            if ((flags & MF_SOURCE_READERF_ENDOFSTREAM) && target < 0) {
+                // MF_SOURCE_READER_ANY_STREAM reports the end of all streams without a stream index
+                for (int s = 0; s < kStreamCount; ++s)
+                    m_queues[s].bEndOfStream = true;
+            }
+        }
+        WakeAllConditionVariable(&m_cvData);
+    }
+    LeaveCriticalSection(&m_cs);
+}
+
+void StreamDemuxer::ClearQueue(int stream)
+{
+    for (Packet& packet : m_queues[stream].packets) {
+        if (packet.pSample) packet.pSample->Release();
+    }
+    m_queues[stream].packets.clear();
+}
+
+void StreamDemuxer::ClearQueues()
+{
+    for (int s = 0; s < kStreamCount; ++s)
+        ClearQueue(s);
+}
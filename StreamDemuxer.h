@@ -0,0 +1,104 @@
+#pragma once
+
+#include <windows.h>
+#include <mfidl.h>
+#include <mfreadwrite.h>
+#include <deque>
+
+/**
+ * @brief Pulls samples for every selected stream of a single source reader on a dedicated thread
+ *        and dispatches them into per-stream queues.
+ *
+ * Used when audio and video share one reader, so the media source is opened and demuxed once.
+ * Read() has the blocking semantics of IMFSourceReader::ReadSample for the requested stream.
+ */
+class StreamDemuxer {
+public:
+    enum Stream { kVideo = 0, kAudio = 1, kStreamCount = 2 };
+
+    /**
+     * @brief Creates the demuxer for the video and audio streams currently selected on the reader.
+     * @param pReader Source reader (referenced for the lifetime of the demuxer).
+     */
+    explicit StreamDemuxer(IMFSourceReader* pReader);
+    ~StreamDemuxer();
+
+    StreamDemuxer(const StreamDemuxer&) = delete;
+    StreamDemuxer& operator=(const StreamDemuxer&) = delete;
+
+    /**
+     * @brief Starts the demux thread.
+     * @return S_OK on success, or an error code.
+     */
+    HRESULT Start();
+
+    /**
+     * @brief Stops the demux thread and wakes every blocked reader (which returns MF_E_SHUTDOWN).
+     *        A ReadSample still blocked on the source after a grace period is cancelled with a reader flush.
+     */
+    void Stop();
+
+    /**
+     * @brief Waits until the demux thread is outside ReadSample, then discards every queued sample.
+     *        The reader can then be repositioned; call Resume afterwards.
+     */
+    void Flush();
+
+    /**
+     * @brief Like Flush, but only discards the samples queued for one stream; the others keep theirs.
+     *        Used to renegotiate the stream's output type without repositioning. Call Resume afterwards.
+     * @param stream Stream to flush.
+     */
+    void FlushStream(Stream stream);
+
+    /**
+     * @brief Resumes demuxing after Flush or FlushStream.
+     */
+    void Resume();
+
+    /**
+     * @brief Blocks until a sample (or end of stream) is available for the given stream.
+     * @param stream Stream to read.
+     * @param pFlags Receives MF_SOURCE_READER_FLAG values.
+     * @param pTimestamp Receives the presentation time in 100-ns.
+     * @param ppSample Receives the sample (may be null with a flag set).
+     * @param timeoutMs Longest wait; on timeout the call succeeds with neither a sample nor a flag.
+     * @return S_OK on success, MF_E_SHUTDOWN once stopped, or the reader error.
+     */
+    HRESULT Read(Stream stream, DWORD* pFlags, LONGLONG* pTimestamp, IMFSample** ppSample, DWORD timeoutMs = INFINITE);
+
+private:
+    struct Packet {
+        IMFSample* pSample = nullptr;
+        DWORD flags = 0;
+        LONGLONG timestamp = 0;
+    };
+
+    struct StreamQueue {
+        std::deque<Packet> packets;
+        bool bEndOfStream = false;
+        bool bConsumerWaiting = false;
+    };
+
+    static constexpr DWORD kNoStream = 0xFFFFFFFF;
+
+    static DWORD WINAPI ThreadProc(LPVOID lpParam);
+    void Run();
+    bool CanReadAhead() const;
+    void ClearQueue(int stream);
+    void ClearQueues();
+
+    IMFSourceReader* m_pReader = nullptr;
+    DWORD m_streamIndex[kStreamCount] = { kNoStream, kNoStream };
+    StreamQueue m_queues[kStreamCount];
+
+    CRITICAL_SECTION m_cs{};
+    CONDITION_VARIABLE m_cvData{};     // signalled when a packet is queued or the state changes
+    CONDITION_VARIABLE m_cvSpace{};    // signalled when a packet is consumed or the state changes
+    HANDLE m_hThread = nullptr;
+    bool m_bStopped = false;
+    bool m_bPaused = false;
+    int m_flushStream = kStreamCount; // Stream discarded by the pending flush, kStreamCount for all of them
+    bool m_bInRead = false;
+    HRESULT m_hrStatus = S_OK;
+};
@@ -0,0 +1,230 @@
+#include "ThumbnailExtractor.h"
+#include "MediaFoundationManager.h"
+#include "FramePool.h"
+#include "Utils.h"
+#include <mfapi.h>
+#include <mfreadwrite.h>
+#include <mferror.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace ThumbnailExtractor {
+
+namespace {
+
+constexpr UINT32 kDefaultBatchSize = 16;
+
+struct Request {
+    LONGLONG time;
+    UINT32 index;
+};
+
+// Opens a reader on the first video stream only, decoding and scaling on the shared D3D11 device
+HRESULT CreateVideoReader(const wchar_t* url, IMFSourceReader** ppReader) {
+    IMFAttributes* pAttributes = nullptr;
+    HRESULT hr = MFCreateAttributes(&pAttributes, 4);
+    if (FAILED(hr))
+        return hr;
+
+    pAttributes->SetUINT32(MF_READWRITE_ENABLE_HARDWARE_TRANSFORMS, TRUE);
+    pAttributes->SetUINT32(MF_SOURCE_READER_DISABLE_DXVA, FALSE);
+    pAttributes->SetUnknown(MF_SOURCE_READER_D3D_MANAGER, MediaFoundation::GetDXGIDeviceManager());
+    // The video processor also performs the resize to MF_MT_FRAME_SIZE
+    pAttributes->SetUINT32(MF_SOURCE_READER_ENABLE_ADVANCED_VIDEO_PROCESSING, TRUE);
+
+    hr = MFCreateSourceReaderFromURL(url, pAttributes, ppReader);
+    pAttributes->Release();
+    if (FAILED(hr))
+        return hr;
+
+    hr = (*ppReader)->SetStreamSelection(MF_SOURCE_READER_ALL_STREAMS, FALSE);
+    if (SUCCEEDED(hr))
+        hr = (*ppReader)->SetStreamSelection(MF_SOURCE_READER_FIRST_VIDEO_STREAM, TRUE);
+    if (FAILED(hr)) {
+        (*ppReader)->Release();
+        *ppReader = nullptr;
+    }
+    return hr;
+}
+
+// Requests the output format at the target size and returns the size the reader actually delivers
+HRESULT ConfigureOutput(IMFSourceReader* pReader, VideoOutputFormat format, UINT32 reqWidth, UINT32 reqHeight,
+                        UINT32* pWidth, UINT32* pHeight) {
+    IMFMediaType* pNative = nullptr;
+    HRESULT hr = pReader->GetNativeMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, 0, &pNative);
+    if (FAILED(hr))
+        return hr;
+    UINT32 srcWidth = 0, srcHeight = 0;
+    hr = MFGetAttributeSize(pNative, MF_MT_FRAME_SIZE, &srcWidth, &srcHeight);
+    pNative->Release();
+    if (FAILED(hr))
+        return hr;
+    if (!srcWidth || !srcHeight)
+        return MF_E_INVALIDMEDIATYPE;
+
+    UINT32 width = 0, height = 0;
+    VideoPlayerUtils::ResolveOutputSize(srcWidth, srcHeight, reqWidth, reqHeight, &width, &height);
+
+    IMFMediaType* pType = nullptr;
+    hr = MFCreateMediaType(&pType);
+    if (SUCCEEDED(hr)) {
+        hr = pType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video);
+        if (SUCCEEDED(hr))
+            hr = pType->SetGUID(MF_MT_SUBTYPE, format == VIDEO_OUTPUT_FORMAT_NV12 ? MFVideoFormat_NV12 : MFVideoFormat_RGB32);
+        if (SUCCEEDED(hr))
+            hr = MFSetAttributeSize(pType, MF_MT_FRAME_SIZE, width, height);
+        if (SUCCEEDED(hr))
+            hr = MFSetAttributeRatio(pType, MF_MT_PIXEL_ASPECT_RATIO, 1, 1);
+        if (SUCCEEDED(hr))
+            hr = pReader->SetCurrentMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, nullptr, pType);
+        pType->Release();
+    }
+    if (FAILED(hr))
+        return hr;
+
+    IMFMediaType* pCurrent = nullptr;
+    hr = pReader->GetCurrentMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, &pCurrent);
+    if (SUCCEEDED(hr)) {
+        hr = MFGetAttributeSize(pCurrent, MF_MT_FRAME_SIZE, pWidth, pHeight);
+        pCurrent->Release();
+    }
+    return hr;
+}
+
+// Seeks to a position and reads the first frame decoded from the keyframe at or before it.
+// Returns S_FALSE (and no sample) if the position is past the end of the stream.
+HRESULT ReadKeyframeAt(IMFSourceReader* pReader, LONGLONG llTime, IMFSample** ppSample, LONGLONG* pTimestamp) {
+    *ppSample = nullptr;
+
+    PROPVARIANT var;
+    PropVariantInit(&var);
+    var.vt = VT_I8;
+    var.hVal.QuadPart = llTime;
+    HRESULT hr = pReader->SetCurrentPosition(GUID_NULL, var);
+    PropVariantClear(&var);
+    if (FAILED(hr))
+        return hr;
+
+    while (!*ppSample) {
+        DWORD streamIndex = 0, dwFlags = 0;
+        hr = pReader->ReadSample(MF_SOURCE_READER_FIRST_VIDEO_STREAM, 0, &streamIndex, &dwFlags, pTimestamp, ppSample);
+        if (FAILED(hr))
+            return hr;
+        if (dwFlags & MF_SOURCE_READERF_ENDOFSTREAM) {
+            if (*ppSample) {
+                (*ppSample)->Release();
+                *ppSample = nullptr;
+            }
+            return S_FALSE;
+        }
+    }
+    return S_OK;
+}
+
+} // namespace
+
+HRESULT Extract(const wchar_t* url, const LONGLONG* pTimestamps, UINT32 count,
+                UINT32 targetWidth, UINT32 targetHeight, VideoOutputFormat format,
+                UINT32 batchSize, ExtractFramesCallback callback, void* pUserData) {
+    if (!url || !pTimestamps || !count || !callback)
+        return OP_E_INVALID_PARAMETER;
+    if (format != VIDEO_OUTPUT_FORMAT_RGB32 && format != VIDEO_OUTPUT_FORMAT_NV12)
+        return OP_E_INVALID_PARAMETER;
+    if (!MediaFoundation::IsInitialized())
+        return OP_E_NOT_INITIALIZED;
+
+    // Visiting the positions in order lets each seek move forward from one keyframe to the next
+    std::vector<Request> requests(count);
+    for (UINT32 i = 0; i < count; ++i)
+        requests[i] = { pTimestamps[i], i };
+    std::stable_sort(requests.begin(), requests.end(),
+                     [](const Request& a, const Request& b) { return a.time < b.time; });
+
+    IMFSourceReader* pReader = nullptr;
+    HRESULT hr = CreateVideoReader(url, &pReader);
+    if (FAILED(hr))
+        return hr;
+
+    UINT32 width = 0, height = 0;
+    hr = ConfigureOutput(pReader, format, targetWidth, targetHeight, &width, &height);
+    if (FAILED(hr)) {
+        pReader->Release();
+        return hr;
+    }
+
+    // One tightly packed buffer per batch slot
+    batchSize = std::min(batchSize ? batchSize : kDefaultBatchSize, FramePool::kMaxBuffers);
+    const UINT32 pitch = format == VIDEO_OUTPUT_FORMAT_RGB32 ? width * 4 : width;
+    const DWORD frameSize = pitch * (format == VIDEO_OUTPUT_FORMAT_RGB32 ? height : height + (height + 1) / 2);
+    std::unique_ptr<BYTE[]> storage(new (std::nothrow) BYTE[static_cast<size_t>(frameSize) * batchSize]);
+    if (!storage) {
+        pReader->Release();
+        return E_OUTOFMEMORY;
+    }
+    BYTE* buffers[FramePool::kMaxBuffers] = {};
+    for (UINT32 i = 0; i < batchSize; ++i)
+        buffers[i] = storage.get() + static_cast<size_t>(frameSize) * i;
+    FramePool pool(buffers, batchSize, frameSize, pitch);
+
+    std::vector<ExtractedFrame> batch;
+    batch.reserve(batchSize);
+    auto flushBatch = [&]() -> bool {
+        if (batch.empty())
+            return true;
+        const BOOL bContinue = callback(batch.data(), static_cast<UINT32>(batch.size()), pUserData);
+        for (UINT32 i = 0; i < batchSize; ++i)
+            pool.Release(i);
+        batch.clear();
+        return bContinue != FALSE;
+    };
+
+    bool bEndOfStream = false;
+    bool bStopped = false;
+    for (const Request& request : requests) {
+        ExtractedFrame frame = {};
+        frame.index = request.index;
+        frame.requestedTime = request.time;
+        frame.width = width;
+        frame.height = height;
+        frame.pitch = pitch;
+        frame.format = format;
+        frame.hr = MF_E_END_OF_STREAM;
+
+        // Positions are sorted: once one is past the end, so are the rest
+        if (!bEndOfStream) {
+            IMFSample* pSample = nullptr;
+            hr = ReadKeyframeAt(pReader, request.time, &pSample, &frame.timestamp);
+            if (FAILED(hr))
+                break;
+            if (hr == S_FALSE) {
+                bEndOfStream = true;
+            } else {
+                UINT32 slot = 0;
+                pool.Acquire(&slot);
+                frame.hr = pool.CopySample(slot, pSample, width, height, format);
+                if (SUCCEEDED(frame.hr)) {
+                    frame.pData = pool.Buffer(slot);
+                    frame.dataSize = frameSize;
+                }
+                pSample->Release();
+            }
+        }
+
+        batch.push_back(frame);
+        if (batch.size() == batchSize && !flushBatch()) {
+            bStopped = true;
+            break;
+        }
+    }
+
+    if (SUCCEEDED(hr) && !bStopped)
+        bStopped = !flushBatch();
+
+    pReader->Release();
+    if (FAILED(hr))
+        return hr;
+    return bStopped ? S_FALSE : S_OK;
+}
+
+} // namespace ThumbnailExtractor
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <windows.h>
+#include "NativeVideoPlayer.h"
+
+namespace ThumbnailExtractor {
+
+/**
+ * @brief Decodes the keyframes nearest to a list of timestamps with a single video-only source reader.
+ *
+ * Frames are scaled to the target size by the GPU video processor and delivered to the callback in batches.
+ * See ExtractFrames in NativeVideoPlayer.h for the parameter contract.
+ * @return S_OK on success, S_FALSE if the callback stopped the extraction, or an error code.
+ */
+HRESULT Extract(const wchar_t* url, const LONGLONG* pTimestamps, UINT32 count,
+                UINT32 targetWidth, UINT32 targetHeight, VideoOutputFormat format,
+                UINT32 batchSize, ExtractFramesCallback callback, void* pUserData);
+
+} // namespace ThumbnailExtractor
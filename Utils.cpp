@@ -1,24 +1,104 @@
 #include "Utils.h"
 #include <thread>
 #include <algorithm>
+#include <cwchar>
 
 namespace VideoPlayerUtils {
 
-void PreciseSleepHighRes(double ms) {
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+namespace {
+
+// Part of the sleep spun instead of waited: covers the wake-up latency of each kind of timer
+constexpr double kHighResSpinMs = 0.3;
+constexpr double kLegacySpinMs = 1.5;
+
+// Timer of the calling thread; a shared one would have its due time overwritten by concurrent sleepers
+struct ThreadTimer {
+    HANDLE hTimer = nullptr;
+    bool bHighResolution = false;
+
+    ThreadTimer() {
+        hTimer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+        bHighResolution = hTimer != nullptr;
+        if (!hTimer)
+            hTimer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+    }
+    ~ThreadTimer() {
+        if (hTimer) CloseHandle(hTimer);
+    }
+    ThreadTimer(const ThreadTimer&) = delete;
+    ThreadTimer& operator=(const ThreadTimer&) = delete;
+};
+
+LONGLONG QpcFrequency() {
+    static const LONGLONG frequency = [] {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        return f.QuadPart;
+    }();
+    return frequency;
+}
+
+LONGLONG QpcNow() {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return now.QuadPart;
+}
+
+} // namespace
+
+double PreciseSleepHighRes(double ms) {
     if (ms <= 0.1)
-        return;
+        return 0.0;
+
+    const LONGLONG frequency = QpcFrequency();
+    const LONGLONG deadline = QpcNow() + static_cast<LONGLONG>(ms * frequency / 1000.0);
 
-    // Use a single static timer for all sleep operations
-    static HANDLE hTimer = CreateWaitableTimer(nullptr, TRUE, nullptr);
-    if (!hTimer) {
-        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(ms));
-        return;
+    thread_local ThreadTimer timer;
+    const double spinMs = timer.bHighResolution ? kHighResSpinMs : kLegacySpinMs;
+    if (ms > spinMs) {
+        if (timer.hTimer) {
+            LARGE_INTEGER liDueTime;
+            liDueTime.QuadPart = -static_cast<LONGLONG>((ms - spinMs) * 10000.0);
+            if (SetWaitableTimer(timer.hTimer, &liDueTime, 0, nullptr, nullptr, FALSE))
+                WaitForSingleObject(timer.hTimer, INFINITE);
+        } else {
+            std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(ms - spinMs));
+        }
     }
 
-    LARGE_INTEGER liDueTime;
-    liDueTime.QuadPart = -static_cast<LONGLONG>(ms * 10000.0);
-    SetWaitableTimer(hTimer, &liDueTime, 0, nullptr, nullptr, FALSE);
-    WaitForSingleObject(hTimer, INFINITE);
+    // Spin tail
+    LONGLONG now = QpcNow();
+    while (now < deadline) {
+        YieldProcessor();
+        now = QpcNow();
+    }
+    return static_cast<double>(now - deadline) * 1000.0 / frequency;
+}
+
+bool IsLocalPath(const wchar_t* url) {
+    if (!url)
+        return false;
+    if (_wcsnicmp(url, L"file://", 7) == 0)
+        return true;
+    return wcsstr(url, L"://") == nullptr;
+}
+
+void ResolveOutputSize(UINT32 srcWidth, UINT32 srcHeight, UINT32 reqWidth, UINT32 reqHeight,
+                       UINT32* pWidth, UINT32* pHeight) {
+    if (!reqWidth && !reqHeight) {
+        reqWidth = srcWidth;
+        reqHeight = srcHeight;
+    } else if (!reqWidth && srcHeight) {
+        reqWidth = static_cast<UINT32>(static_cast<UINT64>(srcWidth) * reqHeight / srcHeight);
+    } else if (!reqHeight && srcWidth) {
+        reqHeight = static_cast<UINT32>(static_cast<UINT64>(srcHeight) * reqWidth / srcWidth);
+    }
+    *pWidth = std::max(2u, reqWidth & ~1u);
+    *pHeight = std::max(2u, reqHeight & ~1u);
 }
 
 } // namespace VideoPlayerUtils
\ No newline at end of file
@@ -16,8 +16,34 @@ inline ULONGLONG GetCurrentTimeMs() {
 
 /**
  * @brief Performs a high-resolution sleep for the specified duration.
+ *
+ * Each calling thread owns its waitable timer (high resolution where the system supports it), which wakes
+ * slightly early; the remainder is spun so that the wake lands within a few microseconds of the target.
  * @param ms Sleep duration in milliseconds.
+ * @return How late the wake was relative to the target, in milliseconds (0 for durations too short to sleep).
  */
-void PreciseSleepHighRes(double ms);
+double PreciseSleepHighRes(double ms);
+
+/**
+ * @brief Tells whether a media location is a local file path rather than a network URL.
+ * @param url Path or URL.
+ * @return True for plain paths and file:// URLs.
+ */
+bool IsLocalPath(const wchar_t* url);
+
+/**
+ * @brief Resolves a requested output frame size against the source size.
+ *
+ * A zero dimension is derived from the other one and the source aspect ratio (both zero keeps the source size).
+ * The result is rounded down to even values, as required by 4:2:0 formats.
+ * @param srcWidth Source width in pixels.
+ * @param srcHeight Source height in pixels.
+ * @param reqWidth Requested width, or 0.
+ * @param reqHeight Requested height, or 0.
+ * @param pWidth Receives the output width.
+ * @param pHeight Receives the output height.
+ */
+void ResolveOutputSize(UINT32 srcWidth, UINT32 srcHeight, UINT32 reqWidth, UINT32 reqHeight,
+                       UINT32* pWidth, UINT32* pHeight);
 
 } // namespace VideoPlayerUtils
\ No newline at end of file
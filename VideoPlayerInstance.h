@@ -7,6 +7,23 @@
 #include <audioclient.h>
 #include <mmdeviceapi.h>
 #include <endpointvolume.h>
+#include <d3d11.h>
+#include <atomic>
+#include <string>
+#include "NativeVideoPlayer.h"
+#include "AudioLevelMeter.h"
+#include "VideoQualityControl.h"
+#include "ByteStreamCache.h"
+#include "PlayerMetrics.h"
+
+class AsyncFrameReader;
+class FrameProducer;
+class DecodeJob;
+class FramePool;
+class StreamDemuxer;
+class KeyframeIndex;
+struct AudioMixerSource;
+namespace MediaFoundation { struct VideoDevice; }
 
 /**
  * @brief Structure to encapsulate the state of a video player instance.
@@ -18,15 +35,82 @@ struct VideoPlayerInstance {
     BYTE* pLockedBytes = nullptr;
     DWORD lockedMaxSize = 0;
     DWORD lockedCurrSize = 0;
-    UINT32 videoWidth = 0;
+    UINT32 videoWidth = 0;            // Size of the delivered frames
     UINT32 videoHeight = 0;
-    BOOL bEOF = FALSE;
+    UINT32 sourceWidth = 0;           // Coded size of the video stream
+    UINT32 sourceHeight = 0;
+    std::atomic<BOOL> bEOF{FALSE};    // Read without a lock by IsEOF and ReadVideoFrameEx
+
+    // Output size requested with SetOutputSize (0 x 0 for the source size), applied by the reading thread
+    std::atomic<UINT32> requestedOutputWidth{0};
+    std::atomic<UINT32> requestedOutputHeight{0};
+    volatile LONG bOutputSizeChanged = FALSE;
+
+    // Negotiated output format and colour description of the video stream
+    VideoOutputFormat requestedOutputFormat = VIDEO_OUTPUT_FORMAT_RGB32;
+    VideoOutputFormat actualOutputFormat = VIDEO_OUTPUT_FORMAT_RGB32;
+    UINT32 videoTransferFunction = 0; // MFVideoTransferFunction
+    UINT32 videoPrimaries = 0;        // MFVideoPrimaries
+
+    // Stream info cached at open for the per-frame paths, refreshed with the video size when the
+    // reader reports MF_SOURCE_READERF_CURRENTMEDIATYPECHANGED
+    UINT32 frameRateNum = 0;          // 0 when the stream does not declare a frame rate
+    UINT32 frameRateDenom = 1;
+    LONG videoStride = 0;             // Default stride of the output type in bytes (negative when bottom-up)
+    LONGLONG llMediaDuration = -1;    // 100-ns, -1 when the source does not report one
+
+    // Decode mode (applied at the next OpenMedia)
+    VideoDecodeMode decodeMode = VIDEO_DECODE_MODE_SYNC;
+    UINT32 frameQueueDepth = 4;
+    AsyncFrameReader* pAsyncReader = nullptr;
+    DecodeJob* pDecodeJob = nullptr;
+    FrameProducer* pFrameProducer = nullptr;   // pAsyncReader or pDecodeJob while decoding ahead
+
+    // Frame pacing (applied at the next OpenMedia); the external time is set by SetPresentationTime at any time
+    std::atomic<PacingMode> pacingMode{PACING_MODE_CLOCK};
+    PacingMode mediaPacingMode = PACING_MODE_CLOCK;   // Mode the current media was opened with
+    volatile LONGLONG llExternalTime = 0;
+
+    // Decode scheduler settings (VIDEO_DECODE_MODE_SCHEDULED)
+    DecodePriority decodePriority = DECODE_PRIORITY_NORMAL;
+    UINT32 maxDecodeFrameRate = 0;
+
+    // Lateness feedback to the decoder and frame delivery counters
+    VideoQualityControl qualityControl;
+
+    // Single reader shared by audio and video (applied at the next OpenMedia)
+    BOOL bSharedSourceReader = FALSE;
+    StreamDemuxer* pDemuxer = nullptr;
+
+    // GPU device (adapter applied at the next OpenMedia); null while on the shared device
+    INT32 videoAdapter = VIDEO_ADAPTER_SHARED;
+    MediaFoundation::VideoDevice* pGpuDevice = nullptr;
+    LONG deviceGeneration = 0;          // Shared device generation the reader was created at
+
+    // Zero-copy output (sample kept alive while its texture is handed out)
+    IMFSample* pTextureSample = nullptr;
+    ID3D11Texture2D* pSharedTexture = nullptr;
+    HANDLE hSharedTextureHandle = nullptr;
+
+    // Caller-owned destination buffers (kept across OpenMedia/CloseMedia)
+    FramePool* pFramePool = nullptr;
+
+    // D3D11 video processor used for GPU colour conversion
+    ID3D11VideoDevice* pVideoDevice = nullptr;
+    ID3D11VideoContext* pVideoContext = nullptr;
+    ID3D11VideoProcessorEnumerator* pVideoProcessorEnum = nullptr;
+    ID3D11VideoProcessor* pVideoProcessor = nullptr;
+    UINT vpInputWidth = 0;
+    UINT vpInputHeight = 0;
+    UINT vpOutputWidth = 0;
+    UINT vpOutputHeight = 0;
 
     // Audio related members
     IMFSourceReader* pSourceReaderAudio = nullptr;
     BOOL bHasAudio = FALSE;
     BOOL bAudioInitialized = FALSE;
     IAudioClient* pAudioClient = nullptr;
+    BOOL bExclusiveAudio = FALSE;       // pAudioClient was opened in exclusive mode (written one period at a time)
     IAudioRenderClient* pRenderClient = nullptr;
     IMMDevice* pDevice = nullptr;
     WAVEFORMATEX* pSourceAudioFormat = nullptr;
@@ -34,21 +118,79 @@ struct VideoPlayerInstance {
     HANDLE hAudioThread = nullptr;
     BOOL bAudioThreadRunning = FALSE;
     HANDLE hAudioReadyEvent = nullptr;
+    // Wakes the audio thread when pause, seek or stop change what it may do (auto-reset)
+    HANDLE hAudioStateEvent = nullptr;
+    // Held by the audio thread while it writes a chunk, exclusively while the output is reset
+    SRWLOCK audioOutputLock = SRWLOCK_INIT;
     IAudioEndpointVolume* pAudioEndpointVolume = nullptr;
 
+    // Shared audio mixer input (applied at the next OpenMedia)
+    BOOL bUseAudioMixer = FALSE;
+    AudioMixerSource* pMixerSource = nullptr;
+
+    // Output levels, written by the audio path and read by GetAudioLevels
+    AudioLevelMeter audioLevels;
+
+    // Render stream profile (applied at the next OpenMedia)
+    AudioLatencyMode audioLatencyMode = AUDIO_LATENCY_DEFAULT;
+
+    // Audio master clock: media time of the last frame written to the render stream (-1 after a seek)
+    ClockMode clockMode = CLOCK_MODE_SYSTEM;
+    IAudioClock* pAudioClock = nullptr;
+    UINT64 audioClockFrequency = 0;
+    SRWLOCK audioClockLock = SRWLOCK_INIT;
+    UINT64 audioClockWrittenFrames = 0;
+    LONGLONG llAudioClockWrittenEnd = -1;
+    double audioClockTempo = 1.0;
+    UINT64 audioContinuedFrames = 0;  // Written by the previous media to a render stream kept across a switch
+
     // Media Foundation clock for synchronization
     IMFPresentationClock* pPresentationClock = nullptr;
     IMFMediaSource* pMediaSource = nullptr;
 
-    // Timing and synchronization
-    LONGLONG llCurrentPosition = 0;
-    ULONGLONG llPlaybackStartTime = 0;
-    ULONGLONG llTotalPauseTime = 0;
-    ULONGLONG llPauseStart = 0;
+    // Timing and synchronization. The playback state is published through atomics so that GetMediaPosition,
+    // IsEOF and the audio thread read it without taking csClockSync, which only orders the writers.
+    // A seek raises bSeekInProgress before it increments seekCount: a reader that loads seekCount first
+    // and sees the new count also sees the seek in progress (or already finished).
+    std::atomic<LONGLONG> llCurrentPosition{0};
+    std::atomic<ULONGLONG> llPlaybackStartTime{0};
+    std::atomic<ULONGLONG> llTotalPauseTime{0};
+    std::atomic<ULONGLONG> llPauseStart{0};
     CRITICAL_SECTION csClockSync{};
-    BOOL bSeekInProgress = FALSE;
+    std::atomic<BOOL> bSeekInProgress{FALSE};
+    std::atomic<LONG> seekCount{0};   // Incremented by every seek, under csClockSync
+
+    // Content shared by the readers: read-ahead cache (network media and byte streams) or file mapping (local files),
+    // set up at the next open
+    SharedByteSource* pByteSource = nullptr;
+    UINT32 streamCacheBytes = ByteStreamCache::kDefaultMemoryBytes;
+    UINT32 streamReadAheadBytes = ByteStreamCache::kDefaultReadAheadBytes;
+    BOOL bMemoryMappedIo = TRUE;
+
+    // Seeking
+    std::wstring mediaUrl;
+    KeyframeIndex* pKeyframeIndex = nullptr;
+    LONGLONG llAccurateSeekTarget = -1; // Frames before this position are dropped after an accurate seek
+
+    // Deferred open (audio and metadata finished on a background thread)
+    HANDLE hOpenThread = nullptr;
+    HANDLE hMediaReadyEvent = nullptr;
+    volatile BOOL bOpenCancelled = FALSE;
+    HRESULT hrOpenStatus = S_OK;
+    VideoMetadata cachedMetadata{};
+    BOOL bMetadataCached = FALSE;
+
+    // Next media, opened on a staging instance by PreloadMedia and swapped in by SwitchToPreloaded
+    VideoPlayerInstance* pPreloaded = nullptr;
+    HANDLE hPreloadThread = nullptr;
+    BOOL bPreloading = FALSE;           // Set on the staging instance, which has no audio output of its own
+    IMFSample* pPrerollSample = nullptr; // First frame decoded ahead by the preload (synchronous mode)
+    LONGLONG llPrerollTimestamp = 0;
 
     // Playback control
-    float instanceVolume = 1.0f; // Volume specific to this instance (1.0 = 100%)
-    float playbackSpeed = 1.0f;  // Playback speed (1.0 = 100%)
+    std::atomic<float> instanceVolume{1.0f}; // Volume specific to this instance (1.0 = 100%)
+    std::atomic<float> playbackSpeed{1.0f};  // Playback speed (1.0 = 100%)
+
+    // Stage latencies and counters since the media was opened (see GetPlayerStats)
+    PlayerMetrics metrics;
 };
@@ -0,0 +1,169 @@
+#include "VideoProcessorManager.h"
+#include "VideoPlayerInstance.h"
+#include <mfapi.h>
+#include <mferror.h>
+
+namespace VideoProcessor {
+
+// Picks the colour space of the decoded stream from the negotiated format and its transfer function
+static DXGI_COLOR_SPACE_TYPE GetInputColorSpace(const VideoPlayerInstance* inst)
+{
+    if (inst->actualOutputFormat == VIDEO_OUTPUT_FORMAT_RGB32)
+        return DXGI_COLOR_SPACE_RGB_FULL_G22_NONE_P709;
+    if (inst->videoTransferFunction == MFVideoTransFunc_2084)
+        return DXGI_COLOR_SPACE_YCBCR_STUDIO_G2084_LEFT_P2020;
+    if (inst->videoPrimaries == MFVideoPrimaries_BT2020)
+        return DXGI_COLOR_SPACE_YCBCR_STUDIO_G22_LEFT_P2020;
+    return inst->sourceHeight >= 720 ? DXGI_COLOR_SPACE_YCBCR_STUDIO_G22_LEFT_P709
+                                    : DXGI_COLOR_SPACE_YCBCR_STUDIO_G22_LEFT_P601;
+}
+
+// Keeps PQ content in PQ when the destination can hold 10 bits, linear for FP16, sRGB otherwise
+static DXGI_COLOR_SPACE_TYPE GetOutputColorSpace(const VideoPlayerInstance* inst, DXGI_FORMAT destFormat)
+{
+    if (destFormat == DXGI_FORMAT_R16G16B16A16_FLOAT)
+        return DXGI_COLOR_SPACE_RGB_FULL_G10_NONE_P709;
+    if (destFormat == DXGI_FORMAT_R10G10B10A2_UNORM && inst->videoTransferFunction == MFVideoTransFunc_2084)
+        return DXGI_COLOR_SPACE_RGB_FULL_G2084_NONE_P2020;
+    return DXGI_COLOR_SPACE_RGB_FULL_G22_NONE_P709;
+}
+
+static HRESULT EnsureProcessor(VideoPlayerInstance* inst, ID3D11Device* device, UINT inW, UINT inH, UINT outW, UINT outH)
+{
+    if (inst->pVideoProcessor && inst->vpInputWidth == inW && inst->vpInputHeight == inH &&
+        inst->vpOutputWidth == outW && inst->vpOutputHeight == outH)
+        return S_OK;
+
+    if (inst->pVideoProcessor)     { inst->pVideoProcessor->Release();     inst->pVideoProcessor = nullptr; }
+    if (inst->pVideoProcessorEnum) { inst->pVideoProcessorEnum->Release(); inst->pVideoProcessorEnum = nullptr; }
+
+    HRESULT hr = S_OK;
+    if (!inst->pVideoDevice) {
+        hr = device->QueryInterface(IID_PPV_ARGS(&inst->pVideoDevice));
+        if (FAILED(hr)) return hr;
+    }
+    if (!inst->pVideoContext) {
+        ID3D11DeviceContext* context = nullptr;
+        device->GetImmediateContext(&context);
+        hr = context->QueryInterface(IID_PPV_ARGS(&inst->pVideoContext));
+        context->Release();
+        if (FAILED(hr)) return hr;
+    }
+
+    D3D11_VIDEO_PROCESSOR_CONTENT_DESC desc = {};
+    desc.InputFrameFormat = D3D11_VIDEO_FRAME_FORMAT_PROGRESSIVE;
+    desc.InputWidth  = inW;
+    desc.InputHeight = inH;
+    desc.OutputWidth  = outW;
+    desc.OutputHeight = outH;
+    desc.Usage = D3D11_VIDEO_USAGE_PLAYBACK_NORMAL;
+
+    hr = inst->pVideoDevice->CreateVideoProcessorEnumerator(&desc, &inst->pVideoProcessorEnum);
+    if (FAILED(hr)) return hr;
+
+    hr = inst->pVideoDevice->CreateVideoProcessor(inst->pVideoProcessorEnum, 0, &inst->pVideoProcessor);
+    if (FAILED(hr)) {
+        inst->pVideoProcessorEnum->Release();
+        inst->pVideoProcessorEnum = nullptr;
+        return hr;
+    }
+
+    inst->vpInputWidth  = inW;
+    inst->vpInputHeight = inH;
+    inst->vpOutputWidth  = outW;
+    inst->vpOutputHeight = outH;
+    return S_OK;
+}
+
+HRESULT Blit(VideoPlayerInstance* inst, ID3D11Texture2D* src, UINT subresource, ID3D11Texture2D* dst)
+{
+    if (!inst || !src || !dst) return E_INVALIDARG;
+
+    D3D11_TEXTURE2D_DESC srcDesc = {}, dstDesc = {};
+    src->GetDesc(&srcDesc);
+    dst->GetDesc(&dstDesc);
+    if (!(dstDesc.BindFlags & D3D11_BIND_RENDER_TARGET)) return E_INVALIDARG;
+
+    // Decoder surfaces are often padded (e.g. 1088 lines), only the visible area is processed
+    UINT inW = inst->videoWidth  ? inst->videoWidth  : srcDesc.Width;
+    UINT inH = inst->videoHeight ? inst->videoHeight : srcDesc.Height;
+
+    ID3D11Device* device = nullptr;
+    src->GetDevice(&device);
+    HRESULT hr = EnsureProcessor(inst, device, inW, inH, dstDesc.Width, dstDesc.Height);
+    if (FAILED(hr)) {
+        device->Release();
+        return hr;
+    }
+
+    UINT support = 0;
+    hr = inst->pVideoProcessorEnum->CheckVideoProcessorFormat(dstDesc.Format, &support);
+    if (FAILED(hr) || !(support & D3D11_VIDEO_PROCESSOR_FORMAT_SUPPORT_OUTPUT)) {
+        device->Release();
+        return FAILED(hr) ? hr : MF_E_UNSUPPORTED_D3D_TYPE;
+    }
+
+    D3D11_VIDEO_PROCESSOR_INPUT_VIEW_DESC inDesc = {};
+    inDesc.ViewDimension = D3D11_VPIV_DIMENSION_TEXTURE2D;
+    inDesc.Texture2D.ArraySlice = subresource / (srcDesc.MipLevels ? srcDesc.MipLevels : 1);
+
+    D3D11_VIDEO_PROCESSOR_OUTPUT_VIEW_DESC outDesc = {};
+    outDesc.ViewDimension = D3D11_VPOV_DIMENSION_TEXTURE2D;
+
+    ID3D11VideoProcessorInputView* inView = nullptr;
+    ID3D11VideoProcessorOutputView* outView = nullptr;
+    hr = inst->pVideoDevice->CreateVideoProcessorInputView(src, inst->pVideoProcessorEnum, &inDesc, &inView);
+    if (SUCCEEDED(hr))
+        hr = inst->pVideoDevice->CreateVideoProcessorOutputView(dst, inst->pVideoProcessorEnum, &outDesc, &outView);
+
+    if (SUCCEEDED(hr)) {
+        RECT srcRect = { 0, 0, static_cast<LONG>(inW), static_cast<LONG>(inH) };
+        RECT dstRect = { 0, 0, static_cast<LONG>(dstDesc.Width), static_cast<LONG>(dstDesc.Height) };
+        ID3D11VideoContext* ctx = inst->pVideoContext;
+        ctx->VideoProcessorSetStreamFrameFormat(inst->pVideoProcessor, 0, D3D11_VIDEO_FRAME_FORMAT_PROGRESSIVE);
+        ctx->VideoProcessorSetStreamSourceRect(inst->pVideoProcessor, 0, TRUE, &srcRect);
+        ctx->VideoProcessorSetStreamDestRect(inst->pVideoProcessor, 0, TRUE, &dstRect);
+        ctx->VideoProcessorSetOutputTargetRect(inst->pVideoProcessor, TRUE, &dstRect);
+
+        ID3D11VideoContext1* ctx1 = nullptr;
+        if (SUCCEEDED(ctx->QueryInterface(IID_PPV_ARGS(&ctx1)))) {
+            ctx1->VideoProcessorSetStreamColorSpace1(inst->pVideoProcessor, 0, GetInputColorSpace(inst));
+            ctx1->VideoProcessorSetOutputColorSpace1(inst->pVideoProcessor, GetOutputColorSpace(inst, dstDesc.Format));
+            ctx1->Release();
+        } else {
+            D3D11_VIDEO_PROCESSOR_COLOR_SPACE inCs = {};
+            inCs.YCbCr_Matrix = inst->sourceHeight >= 720 ? 1 : 0;
+            inCs.Nominal_Range = D3D11_VIDEO_PROCESSOR_NOMINAL_RANGE_16_235;
+            D3D11_VIDEO_PROCESSOR_COLOR_SPACE outCs = {};
+            outCs.Nominal_Range = D3D11_VIDEO_PROCESSOR_NOMINAL_RANGE_0_255;
+            ctx->VideoProcessorSetStreamColorSpace(inst->pVideoProcessor, 0, &inCs);
+            ctx->VideoProcessorSetOutputColorSpace(inst->pVideoProcessor, &outCs);
+        }
+
+        D3D11_VIDEO_PROCESSOR_STREAM stream = {};
+        stream.Enable = TRUE;
+        stream.pInputSurface = inView;
+        // CPU side of the conversion; the GPU work itself runs asynchronously
+        const LONGLONG bltStart = PlayerMetrics::Now();
+        hr = ctx->VideoProcessorBlt(inst->pVideoProcessor, outView, 0, 1, &stream);
+        if (SUCCEEDED(hr))
+            inst->metrics.Record(PlayerMetrics::kColorConversion, PlayerMetrics::MicrosecondsSince(bltStart));
+    }
+
+    if (outView) outView->Release();
+    if (inView)  inView->Release();
+    device->Release();
+    return hr;
+}
+
+void Release(VideoPlayerInstance* inst)
+{
+    if (!inst) return;
+    if (inst->pVideoProcessor)     { inst->pVideoProcessor->Release();     inst->pVideoProcessor = nullptr; }
+    if (inst->pVideoProcessorEnum) { inst->pVideoProcessorEnum->Release(); inst->pVideoProcessorEnum = nullptr; }
+    if (inst->pVideoContext)       { inst->pVideoContext->Release();       inst->pVideoContext = nullptr; }
+    if (inst->pVideoDevice)        { inst->pVideoDevice->Release();        inst->pVideoDevice = nullptr; }
+    inst->vpInputWidth = inst->vpInputHeight = inst->vpOutputWidth = inst->vpOutputHeight = 0;
+}
+
+} // namespace VideoProcessor
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <windows.h>
+#include <d3d11.h>
+
+// Forward declarations
+struct VideoPlayerInstance;
+
+namespace VideoProcessor {
+
+/**
+ * @brief Converts (and scales) a decoded surface into a destination texture with the D3D11 video processor.
+ * @param pInstance Pointer to the video player instance owning the processor state.
+ * @param pSource Decoded texture (NV12, P010 or RGB32), possibly a texture array.
+ * @param subresource Array slice of the frame within pSource.
+ * @param pDest Destination texture, which must be created with D3D11_BIND_RENDER_TARGET on the same device.
+ * @return S_OK on success, or an error code.
+ */
+HRESULT Blit(VideoPlayerInstance* pInstance, ID3D11Texture2D* pSource, UINT subresource, ID3D11Texture2D* pDest);
+
+/**
+ * @brief Releases the video processor objects held by an instance.
+ * @param pInstance Pointer to the video player instance.
+ */
+void Release(VideoPlayerInstance* pInstance);
+
+} // namespace VideoProcessor
@@ -0,0 +1,175 @@
+#include "VideoQualityControl.h"
+#include "NativeVideoPlayer.h"
+#include <mftransform.h>
+
+// Lateness, in frame durations, that raises the drop level
+constexpr LONGLONG kModerateLateFrames = 2;
+constexpr LONGLONG kSevereLateFrames = 8;
+
+// Consecutive frames within half a frame of the clock before stepping back down one level
+constexpr UINT32 kRecoveryFrames = 15;
+
+VideoQualityControl::~VideoQualityControl()
+{
+    Detach();
+}
+
+void VideoQualityControl::Attach(IMFSourceReader* pReader)
+{
+    AcquireSRWLockExclusive(&m_lock);
+    ReleaseDecoder();
+    if (pReader)
+        FindDecoder(pReader);
+    ReleaseSRWLockExclusive(&m_lock);
+}
+
+void VideoQualityControl::FindDecoder(IMFSourceReader* pReader)
+{
+    IMFSourceReaderEx* pReaderEx = nullptr;
+    if (FAILED(pReader->QueryInterface(IID_PPV_ARGS(&pReaderEx))))
+        return;
+
+    // The decoder is one of the transforms the reader inserted, next to the video processor
+    for (DWORD index = 0; !m_pAdvise; ++index) {
+        GUID category = GUID_NULL;
+        IMFTransform* pTransform = nullptr;
+        if (FAILED(pReaderEx->GetTransformForStream(MF_SOURCE_READER_FIRST_VIDEO_STREAM, index, &category, &pTransform)))
+            break;
+        if (category == MFT_CATEGORY_VIDEO_DECODER)
+            pTransform->QueryInterface(IID_PPV_ARGS(&m_pAdvise));
+        pTransform->Release();
+    }
+    pReaderEx->Release();
+
+    // Find the deepest drop mode this decoder supports, for playback far behind
+    if (m_pAdvise) {
+        for (int mode = MF_DROP_MODE_5; mode > MF_DROP_MODE_1; --mode) {
+            if (SUCCEEDED(m_pAdvise->SetDropMode(static_cast<MF_QUALITY_DROP_MODE>(mode)))) {
+                m_severeMode = static_cast<MF_QUALITY_DROP_MODE>(mode);
+                break;
+            }
+        }
+        m_pAdvise->SetDropMode(MF_DROP_MODE_NONE);
+    }
+}
+
+void VideoQualityControl::Detach()
+{
+    AcquireSRWLockExclusive(&m_lock);
+    ReleaseDecoder();
+    ReleaseSRWLockExclusive(&m_lock);
+    m_framesPresented = 0;
+    m_framesLate = 0;
+    m_framesDropped = 0;
+    m_framesSkipped = 0;
+}
+
+void VideoQualityControl::ReleaseDecoder()
+{
+    ResetLevel();
+    if (m_pAdvise) {
+        m_pAdvise->Release();
+        m_pAdvise = nullptr;
+    }
+    m_severeMode = MF_DROP_MODE_NONE;
+}
+
+void VideoQualityControl::SetEnabled(bool bEnabled)
+{
+    m_bEnabled.store(bEnabled, std::memory_order_relaxed);
+}
+
+void VideoQualityControl::Reset()
+{
+    AcquireSRWLockExclusive(&m_lock);
+    ResetLevel();
+    ReleaseSRWLockExclusive(&m_lock);
+}
+
+void VideoQualityControl::ResetLevel()
+{
+    ApplyLevel(0);
+    m_onTimeFrames = 0;
+    m_llLastTimestamp = -1;
+}
+
+void VideoQualityControl::OnFramePresented(LONGLONG llTimestamp, LONGLONG llLateness, LONGLONG llFrameDuration)
+{
+    ++m_framesPresented;
+    if (llLateness > llFrameDuration)
+        ++m_framesLate;
+    AcquireSRWLockExclusive(&m_lock);
+    CountDecoderSkips(llTimestamp, llFrameDuration);
+    Evaluate(llLateness, llFrameDuration);
+    ReleaseSRWLockExclusive(&m_lock);
+}
+
+void VideoQualityControl::OnFrameDropped(LONGLONG llTimestamp, LONGLONG llLateness, LONGLONG llFrameDuration)
+{
+    ++m_framesDropped;
+    AcquireSRWLockExclusive(&m_lock);
+    CountDecoderSkips(llTimestamp, llFrameDuration);
+    Evaluate(llLateness, llFrameDuration);
+    ReleaseSRWLockExclusive(&m_lock);
+}
+
+void VideoQualityControl::GetStats(VideoQosStats* pStats) const
+{
+    pStats->framesPresented = m_framesPresented.load(std::memory_order_relaxed);
+    pStats->framesLate = m_framesLate.load(std::memory_order_relaxed);
+    pStats->framesDropped = m_framesDropped.load(std::memory_order_relaxed);
+    pStats->framesSkipped = m_framesSkipped.load(std::memory_order_relaxed);
+    pStats->dropMode = m_dropMode.load(std::memory_order_relaxed);
+}
+
+void VideoQualityControl::CountDecoderSkips(LONGLONG llTimestamp, LONGLONG llFrameDuration)
+{
+    // The decoder does not report what it skipped: count the gaps it leaves in the timestamps
+    if (m_llLastTimestamp >= 0 && llFrameDuration > 0 && m_dropMode.load(std::memory_order_relaxed) != MF_DROP_MODE_NONE) {
+        const LONGLONG gap = llTimestamp - m_llLastTimestamp;
+        const LONGLONG missing = (gap + llFrameDuration / 2) / llFrameDuration - 1;
+        if (missing > 0)
+            m_framesSkipped += static_cast<UINT64>(missing);
+    }
+    m_llLastTimestamp = llTimestamp;
+}
+
+void VideoQualityControl::Evaluate(LONGLONG llLateness, LONGLONG llFrameDuration)
+{
+    if (!m_pAdvise || llFrameDuration <= 0 || !m_bEnabled.load(std::memory_order_relaxed)) {
+        if (m_level) ApplyLevel(0);
+        return;
+    }
+
+    UINT32 target = 0;
+    if (llLateness > kSevereLateFrames * llFrameDuration && m_severeMode != MF_DROP_MODE_NONE)
+        target = 2;
+    else if (llLateness > kModerateLateFrames * llFrameDuration)
+        target = 1;
+
+    if (target > m_level) {
+        m_onTimeFrames = 0;
+        ApplyLevel(target);
+    } else if (m_level && llLateness < llFrameDuration / 2) {
+        // Step down gradually so that a single on-time frame does not bring the whole load back
+        if (++m_onTimeFrames >= kRecoveryFrames) {
+            m_onTimeFrames = 0;
+            ApplyLevel(m_level - 1);
+        }
+    } else {
+        m_onTimeFrames = 0;
+    }
+}
+
+void VideoQualityControl::ApplyLevel(UINT32 level)
+{
+    const MF_QUALITY_DROP_MODE mode = level == 2 ? m_severeMode : level == 1 ? MF_DROP_MODE_1 : MF_DROP_MODE_NONE;
+    m_level = level;
+    if (m_pAdvise && static_cast<UINT32>(mode) != m_dropMode.load(std::memory_order_relaxed)) {
+        if (FAILED(m_pAdvise->SetDropMode(mode))) {
+            m_level = 0;
+            return;
+        }
+    }
+    m_dropMode.store(static_cast<UINT32>(mode), std::memory_order_relaxed);
+}
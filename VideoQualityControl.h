@@ -0,0 +1,90 @@
+#pragma once
+
+#include <windows.h>
+#include <mfidl.h>
+#include <mfreadwrite.h>
+#include <atomic>
+
+struct VideoQosStats;
+
+/**
+ * @brief Quality-of-service loop of one instance: turns the lateness of the frames handed out into decoder
+ * drop modes, so that frames which would be thrown away are not decoded in the first place.
+ *
+ * The decoder MFT of the source reader is driven through IMFQualityAdvise: moderately late playback drops
+ * non-reference frames (MF_DROP_MODE_1), playback far behind uses the decoder's most aggressive mode, down to
+ * keyframes only where supported. Full decoding resumes once frames are on time again. Decoders without
+ * IMFQualityAdvise keep decoding every frame; lateness is still counted.
+ * Reported from the thread that reads frames; Attach, Reset and GetStats can be called from any thread.
+ */
+class VideoQualityControl {
+public:
+    VideoQualityControl() = default;
+    ~VideoQualityControl();
+
+    VideoQualityControl(const VideoQualityControl&) = delete;
+    VideoQualityControl& operator=(const VideoQualityControl&) = delete;
+
+    /**
+     * @brief Looks up the video decoder of a source reader, again after its output type changed.
+     * @param pReader Source reader (not referenced).
+     */
+    void Attach(IMFSourceReader* pReader);
+
+    /**
+     * @brief Restores full decoding, releases the decoder and clears the counters (media closed).
+     */
+    void Detach();
+
+    /**
+     * @brief Enables or disables the drop modes (counters are kept either way).
+     */
+    void SetEnabled(bool bEnabled);
+    bool IsEnabled() const { return m_bEnabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Restores full decoding after a discontinuity (seek, output change); counters are kept.
+     */
+    void Reset();
+
+    /**
+     * @brief Reports a frame handed out to the caller.
+     * @param llTimestamp Frame timestamp in 100-ns.
+     * @param llLateness Clock time minus the frame timestamp in 100-ns (negative when early).
+     * @param llFrameDuration Nominal frame duration in 100-ns.
+     */
+    void OnFramePresented(LONGLONG llTimestamp, LONGLONG llLateness, LONGLONG llFrameDuration);
+
+    /**
+     * @brief Reports a frame decoded but discarded because it was too late.
+     */
+    void OnFrameDropped(LONGLONG llTimestamp, LONGLONG llLateness, LONGLONG llFrameDuration);
+
+    void GetStats(VideoQosStats* pStats) const;
+
+private:
+    // Called with m_lock held
+    void FindDecoder(IMFSourceReader* pReader);
+    void ReleaseDecoder();
+    void ResetLevel();
+    void CountDecoderSkips(LONGLONG llTimestamp, LONGLONG llFrameDuration);
+    void Evaluate(LONGLONG llLateness, LONGLONG llFrameDuration);
+    void ApplyLevel(UINT32 level);
+
+    std::atomic<bool> m_bEnabled{true};
+
+    // Decoder and drop level, guarded by m_lock: seeks reset them on the caller's thread while the reading
+    // thread reports frames
+    SRWLOCK m_lock = SRWLOCK_INIT;
+    IMFQualityAdvise* m_pAdvise = nullptr;
+    UINT32 m_level = 0;                 // 0 full decode, 1 non-reference frames dropped, 2 most aggressive
+    MF_QUALITY_DROP_MODE m_severeMode = MF_DROP_MODE_NONE;  // Deepest mode the decoder accepted
+    UINT32 m_onTimeFrames = 0;          // Consecutive on-time frames, to step back down
+    LONGLONG m_llLastTimestamp = -1;
+
+    std::atomic<UINT64> m_framesPresented{0};
+    std::atomic<UINT64> m_framesLate{0};
+    std::atomic<UINT64> m_framesDropped{0};
+    std::atomic<UINT64> m_framesSkipped{0};
+    std::atomic<UINT32> m_dropMode{MF_DROP_MODE_NONE};
+};
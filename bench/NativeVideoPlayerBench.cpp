@@ -0,0 +1,346 @@
+// NativeVideoPlayerBench – headless benchmark of the exported NativeVideoPlayer API
+// -----------------------------------------------------------------------------
+//  * Opens each clip on N concurrent instances, reads every frame, then runs a storm of random seeks.
+//  * Reports decoded frames per second, time to first frame (open included), seek-to-frame latency
+//    percentiles, the instances' own decode and lock latencies, process CPU time and peak private memory.
+//  * Instances are unpaced (PACING_MODE_UNPACED): ReadVideoFrame returns every frame as soon as it is
+//    decoded, in every decode mode, and no audio is played.
+//
+//  Usage: NativeVideoPlayerBench [options] <clip> [<clip> ...]
+//    --mode sync|async|scheduled|all   Decode modes to run (default all)
+//    --format rgb32|nv12               Output format (default rgb32)
+//    --instances N                     Concurrent instances per run (default 1)
+//    --frames N                        Frames read per instance, 0 for the whole clip (default 0)
+//    --seeks N                         Seeks per instance after the read (default 20)
+// -----------------------------------------------------------------------------
+
+#include "NativeVideoPlayer.h"
+#include <mferror.h>
+#include <psapi.h>
+#include <algorithm>
+#include <cwchar>
+#include <string>
+#include <vector>
+
+namespace {
+
+// A frame not delivered within this time ends the run of the instance
+constexpr double kStallTimeoutMs = 10'000.0;
+
+struct Options {
+    std::vector<VideoDecodeMode> modes;
+    VideoOutputFormat format = VIDEO_OUTPUT_FORMAT_RGB32;
+    UINT32 instances = 1;
+    UINT32 maxFrames = 0;
+    UINT32 seeks = 20;
+    std::vector<std::wstring> clips;
+};
+
+// One instance of a run, filled by its thread
+struct Worker {
+    const wchar_t* clip = nullptr;
+    const Options* pOptions = nullptr;
+    VideoDecodeMode mode = VIDEO_DECODE_MODE_SYNC;
+    UINT32 index = 0;
+
+    VideoPlayerInstance* pInstance = nullptr;
+
+    HRESULT hr = S_OK;
+    double firstFrameMs = 0.0;
+    UINT64 frames = 0;
+    double decodeSeconds = 0.0;
+    std::vector<double> seekMs;
+    UINT32 failedSeeks = 0;
+    PlayerStats stats{};
+};
+
+LONGLONG QpcNow()
+{
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return now.QuadPart;
+}
+
+double MsSince(LONGLONG start)
+{
+    static const double ticksPerMs = [] {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        return static_cast<double>(f.QuadPart) / 1000.0;
+    }();
+    return static_cast<double>(QpcNow() - start) / ticksPerMs;
+}
+
+UINT64 FileTimeTo100ns(const FILETIME& ft)
+{
+    return (static_cast<UINT64>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+}
+
+UINT64 ProcessCpuTime100ns()
+{
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+        return 0;
+    return FileTimeTo100ns(kernel) + FileTimeTo100ns(user);
+}
+
+SIZE_T ProcessPrivateBytes()
+{
+    PROCESS_MEMORY_COUNTERS_EX counters = {};
+    counters.cb = sizeof(counters);
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters), sizeof(counters)))
+        return 0;
+    return counters.PrivateUsage;
+}
+
+double Percentile(const std::vector<double>& sorted, double fraction)
+{
+    if (sorted.empty())
+        return 0.0;
+    const size_t rank = static_cast<size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+const wchar_t* ModeName(VideoDecodeMode mode)
+{
+    switch (mode) {
+        case VIDEO_DECODE_MODE_ASYNC:     return L"async";
+        case VIDEO_DECODE_MODE_SCHEDULED: return L"scheduled";
+        default:                          return L"sync";
+    }
+}
+
+// Reads the next frame: S_OK with a frame, S_FALSE at the end of the clip. The decoding-ahead modes return
+// no frame while their queue is empty; they are polled without spinning a core.
+HRESULT WaitFrame(Worker* w)
+{
+    const LONGLONG start = QpcNow();
+    for (UINT32 polls = 0;; ++polls) {
+        BYTE* pData = nullptr;
+        DWORD cbData = 0;
+        HRESULT hr = ReadVideoFrame(w->pInstance, &pData, &cbData);
+        if (hr != S_OK)
+            return hr;
+        if (pData) {
+            UnlockVideoFrame(w->pInstance);
+            return S_OK;
+        }
+        if (MsSince(start) > kStallTimeoutMs)
+            return HRESULT_FROM_WIN32(ERROR_TIMEOUT);
+        if (polls < 64)
+            SwitchToThread();
+        else
+            Sleep(1);
+    }
+}
+
+DWORD WINAPI WorkerThreadProc(LPVOID lpParam)
+{
+    auto* w = static_cast<Worker*>(lpParam);
+    const Options& options = *w->pOptions;
+
+    w->hr = CreateVideoPlayerInstance(&w->pInstance);
+    if (FAILED(w->hr))
+        return 0;
+    SetVideoDecodeMode(w->pInstance, w->mode, 0);
+    SetPacingMode(w->pInstance, PACING_MODE_UNPACED);
+
+    const LONGLONG openStart = QpcNow();
+    w->hr = OpenMediaEx(w->pInstance, w->clip, options.format);
+    if (SUCCEEDED(w->hr))
+        w->hr = WaitFrame(w);
+    if (w->hr != S_OK) {
+        if (w->hr == S_FALSE)
+            w->hr = MF_E_END_OF_STREAM;     // Not a single frame
+        DestroyVideoPlayerInstance(w->pInstance);
+        return 0;
+    }
+    w->firstFrameMs = MsSince(openStart);
+
+    // Throughput: every frame of the clip, or the first maxFrames
+    const LONGLONG decodeStart = QpcNow();
+    w->frames = 1;
+    while (!options.maxFrames || w->frames < options.maxFrames) {
+        HRESULT hr = WaitFrame(w);
+        if (hr == S_FALSE)
+            break;
+        if (FAILED(hr)) {
+            w->hr = hr;
+            break;
+        }
+        ++w->frames;
+    }
+    w->decodeSeconds = MsSince(decodeStart) / 1000.0;
+    GetPlayerStats(w->pInstance, &w->stats);
+
+    // Seek storm: positions spread over the clip, the same for every run
+    LONGLONG duration = 0;
+    GetMediaDuration(w->pInstance, &duration);
+    UINT32 seed = 0x9e3779b9u * (w->index + 1);
+    for (UINT32 i = 0; i < options.seeks && duration > 0 && SUCCEEDED(w->hr); ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        const LONGLONG position = static_cast<LONGLONG>(static_cast<double>(seed) / 4294967296.0 * 0.9 * static_cast<double>(duration));
+        const LONGLONG seekStart = QpcNow();
+        HRESULT hr = SeekMedia(w->pInstance, position);
+        if (SUCCEEDED(hr))
+            hr = WaitFrame(w);
+        if (hr == S_OK)
+            w->seekMs.push_back(MsSince(seekStart));
+        else
+            ++w->failedSeeks;
+    }
+
+    DestroyVideoPlayerInstance(w->pInstance);
+    w->pInstance = nullptr;
+    return 0;
+}
+
+// Runs one clip in one mode on the configured number of instances and prints a result line
+bool RunBenchmark(const Options& options, const std::wstring& clip, VideoDecodeMode mode)
+{
+    std::vector<Worker> workers(options.instances);
+    std::vector<HANDLE> threads;
+    const UINT64 cpuStart = ProcessCpuTime100ns();
+    const LONGLONG wallStart = QpcNow();
+    SIZE_T peakPrivateBytes = ProcessPrivateBytes();
+
+    for (UINT32 i = 0; i < options.instances; ++i) {
+        workers[i].clip = clip.c_str();
+        workers[i].pOptions = &options;
+        workers[i].mode = mode;
+        workers[i].index = i;
+        HANDLE hThread = CreateThread(nullptr, 0, WorkerThreadProc, &workers[i], 0, nullptr);
+        if (!hThread) {
+            workers[i].hr = HRESULT_FROM_WIN32(GetLastError());
+            continue;
+        }
+        threads.push_back(hThread);
+    }
+
+    // Sample memory while the instances run; WaitForMultipleObjects takes at most 64 handles
+    for (size_t done = 0; done < threads.size();) {
+        const DWORD count = static_cast<DWORD>(std::min<size_t>(threads.size() - done, MAXIMUM_WAIT_OBJECTS));
+        if (WaitForMultipleObjects(count, threads.data() + done, TRUE, 100) != WAIT_TIMEOUT)
+            done += count;
+        peakPrivateBytes = std::max(peakPrivateBytes, ProcessPrivateBytes());
+    }
+    for (HANDLE hThread : threads)
+        CloseHandle(hThread);
+
+    const double wallSeconds = MsSince(wallStart) / 1000.0;
+    const double cpuSeconds = static_cast<double>(ProcessCpuTime100ns() - cpuStart) / 10'000'000.0;
+
+    double fps = 0.0, firstFrameMs = 0.0, decodeP99Ms = 0.0, lockP99Ms = 0.0;
+    UINT64 frames = 0;
+    UINT32 failed = 0, failedSeeks = 0;
+    std::vector<double> seekMs;
+    for (const Worker& w : workers) {
+        if (FAILED(w.hr)) {
+            ++failed;
+            fwprintf(stderr, L"  %ls [%ls #%u]: error 0x%08lX\n", clip.c_str(), ModeName(mode), w.index,
+                     static_cast<unsigned long>(w.hr));
+        }
+        if (!w.frames)
+            continue;
+        frames += w.frames;
+        if (w.decodeSeconds > 0.0)
+            fps += static_cast<double>(w.frames) / w.decodeSeconds;
+        firstFrameMs = std::max(firstFrameMs, w.firstFrameMs);
+        decodeP99Ms = std::max(decodeP99Ms, w.stats.videoDecode.p99Us / 1000.0);
+        lockP99Ms = std::max(lockP99Ms, w.stats.videoLock.p99Us / 1000.0);
+        seekMs.insert(seekMs.end(), w.seekMs.begin(), w.seekMs.end());
+        failedSeeks += w.failedSeeks;
+    }
+    std::sort(seekMs.begin(), seekMs.end());
+
+    const wchar_t* name = wcsrchr(clip.c_str(), L'\\');
+    name = name ? name + 1 : clip.c_str();
+    wprintf(L"%-28.28ls %-9ls %4u %8llu %9.1f %8.1f %7.1f %7.1f %7.1f %5u %8.2f %7.2f %7.1f %8.1f\n",
+            name, ModeName(mode), options.instances, static_cast<unsigned long long>(frames), fps, firstFrameMs,
+            Percentile(seekMs, 0.5), Percentile(seekMs, 0.9), Percentile(seekMs, 0.99), failedSeeks,
+            decodeP99Ms, lockP99Ms, wallSeconds > 0.0 ? cpuSeconds / wallSeconds * 100.0 : 0.0,
+            static_cast<double>(peakPrivateBytes) / (1024.0 * 1024.0));
+    return failed == 0;
+}
+
+bool ParseOptions(int argc, wchar_t** argv, Options* pOptions)
+{
+    bool bAllModes = true;
+    for (int i = 1; i < argc; ++i) {
+        const std::wstring arg = argv[i];
+        const wchar_t* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg.rfind(L"--", 0) != 0) {
+            pOptions->clips.push_back(arg);
+            continue;
+        }
+        if (!value)
+            return false;
+        ++i;
+        if (arg == L"--mode") {
+            const std::wstring mode = value;
+            bAllModes = mode == L"all";
+            if (mode == L"sync")
+                pOptions->modes.push_back(VIDEO_DECODE_MODE_SYNC);
+            else if (mode == L"async")
+                pOptions->modes.push_back(VIDEO_DECODE_MODE_ASYNC);
+            else if (mode == L"scheduled")
+                pOptions->modes.push_back(VIDEO_DECODE_MODE_SCHEDULED);
+            else if (!bAllModes)
+                return false;
+        } else if (arg == L"--format") {
+            const std::wstring format = value;
+            if (format == L"rgb32")
+                pOptions->format = VIDEO_OUTPUT_FORMAT_RGB32;
+            else if (format == L"nv12")
+                pOptions->format = VIDEO_OUTPUT_FORMAT_NV12;
+            else
+                return false;
+        } else if (arg == L"--instances") {
+            pOptions->instances = static_cast<UINT32>(wcstoul(value, nullptr, 10));
+        } else if (arg == L"--frames") {
+            pOptions->maxFrames = static_cast<UINT32>(wcstoul(value, nullptr, 10));
+        } else if (arg == L"--seeks") {
+            pOptions->seeks = static_cast<UINT32>(wcstoul(value, nullptr, 10));
+        } else {
+            return false;
+        }
+    }
+    if (bAllModes)
+        pOptions->modes = { VIDEO_DECODE_MODE_SYNC, VIDEO_DECODE_MODE_ASYNC, VIDEO_DECODE_MODE_SCHEDULED };
+    return !pOptions->clips.empty() && pOptions->instances > 0;
+}
+
+} // namespace
+
+int wmain(int argc, wchar_t** argv)
+{
+    Options options;
+    if (!ParseOptions(argc, argv, &options)) {
+        fwprintf(stderr, L"Usage: NativeVideoPlayerBench [--mode sync|async|scheduled|all] [--format rgb32|nv12]\n"
+                         L"                              [--instances N] [--frames N] [--seeks N] <clip> [<clip> ...]\n");
+        return 2;
+    }
+
+    HRESULT hr = InitMediaFoundation();
+    if (FAILED(hr)) {
+        fwprintf(stderr, L"InitMediaFoundation failed: 0x%08lX\n", static_cast<unsigned long>(hr));
+        return 1;
+    }
+
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    wprintf(L"%u logical processors; cpu %% is of one processor, seek latency is to the first frame\n\n",
+            systemInfo.dwNumberOfProcessors);
+    wprintf(L"%-28ls %-9ls %4ls %8ls %9ls %8ls %7ls %7ls %7ls %5ls %8ls %7ls %7ls %8ls\n",
+            L"clip", L"mode", L"inst", L"frames", L"fps", L"ttff ms", L"seek50", L"seek90", L"seek99", L"fail",
+            L"dec99 ms", L"lock99", L"cpu %", L"mem MB");
+
+    bool bSucceeded = true;
+    for (const std::wstring& clip : options.clips) {
+        for (VideoDecodeMode mode : options.modes)
+            bSucceeded &= RunBenchmark(options, clip, mode);
+    }
+
+    ShutdownMediaFoundation();
+    return bSucceeded ? 0 : 1;
+}